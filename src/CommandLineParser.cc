@@ -14,6 +14,8 @@
 #include "EnumSetting.hh"
 #include "XMLException.hh"
 #include "StringOp.hh"
+#include "TclObject.hh"
+#include "Timer.hh"
 #include "xrange.hh"
 #include "GLUtil.hh"
 #include "Reactor.hh"
@@ -71,6 +73,8 @@ CommandLineParser::CommandLineParser(Reactor& reactor_)
 	registerOption("-script",     scriptOption,  PHASE_BEFORE_SETTINGS, 1); // correct phase?
 	registerOption("-command",    commandOption, PHASE_BEFORE_SETTINGS, 1); // same phase as -script
 	registerOption("-testconfig", testConfigOption, PHASE_BEFORE_SETTINGS, 1);
+	registerOption("-batch",      batchOption,   PHASE_BEFORE_SETTINGS);
+	registerOption("-dump",       dumpOption,    PHASE_BEFORE_SETTINGS);
 
 	registerOption("-machine",    machineOption, PHASE_LOAD_MACHINE);
 
@@ -163,6 +167,7 @@ CLIFileType* CommandLineParser::getFileTypeHandlerForFileName(string_view filena
 void CommandLineParser::parse(int argc, char** argv)
 {
 	parseStatus = RUN;
+	startTime = Timer::getTime();
 
 	auto cmdLineBuf = to_vector(view::transform(xrange(1, argc), [&](auto i) {
 		return FileOperations::getConventionalPath(argv[i]);
@@ -188,6 +193,12 @@ void CommandLineParser::parse(int argc, char** argv)
 				auto& cliComm = reactor.getGlobalCliComm();
 				cliComm.addListener(std::make_unique<StdioMessages>());
 			}
+			if (parseStatus == BATCH) {
+				// don't load (nor save) the user's settings.xml,
+				// the result of a batch run should not depend on it
+				loadBatchSettings();
+				haveSettings = true;
+			}
 			if (!haveSettings) {
 				auto& settingsConfig =
 					reactor.getGlobalCommandController().getSettingsConfig();
@@ -281,9 +292,31 @@ void CommandLineParser::parse(int argc, char** argv)
 	}
 }
 
+void CommandLineParser::loadBatchSettings()
+{
+	// Settings that already exist are changed directly, the others get
+	// their value from the settings XML element when they're created
+	// (e.g. the sound_driver setting is only created together with the
+	// first machine).
+	static constexpr std::pair<string_view, string_view> batchSettings[] = {
+		{"throttle",     "off"},
+		{"sound_driver", "null"},
+	};
+	auto& settingsConfig = reactor.getGlobalCommandController().getSettingsConfig();
+	auto& manager = settingsConfig.getSettingsManager();
+	auto& xml = settingsConfig.getXMLElement().getCreateChild("settings");
+	for (auto [name, value] : batchSettings) {
+		if (auto* setting = manager.findSetting(name)) {
+			setting->setValue(TclObject(value));
+		} else {
+			xml.getCreateChildWithAttribute("setting", "id", name).setData(value);
+		}
+	}
+}
+
 bool CommandLineParser::isHiddenStartup() const
 {
-	return parseStatus == one_of(CONTROL, TEST);
+	return parseStatus == one_of(CONTROL, TEST, BATCH);
 }
 
 CommandLineParser::ParseStatus CommandLineParser::getParseStatus() const
@@ -574,6 +607,41 @@ string_view CommandLineParser::TestConfigOption::optionHelp() const
 	return "Test if the specified config works and exit";
 }
 
+// class BatchOption
+
+void CommandLineParser::BatchOption::parseOption(
+	const string& option, span<string>& cmdLine)
+{
+	auto& parser = OUTER(CommandLineParser, batchOption);
+	auto arg = getArgument(option, cmdLine);
+	auto d = TclObject(arg).getDouble(parser.getInterpreter());
+	if (d <= 0.0) {
+		throw FatalError("Invalid batch duration: ", arg);
+	}
+	duration = d;
+	parser.parseStatus = CommandLineParser::BATCH;
+}
+
+string_view CommandLineParser::BatchOption::optionHelp() const
+{
+	return "Run the machine without video, sound or user settings for the "
+	       "given number of emulated seconds as fast as possible, then exit";
+}
+
+// class DumpOption
+
+void CommandLineParser::DumpOption::parseOption(
+	const string& option, span<string>& cmdLine)
+{
+	debuggables.push_back(getArgument(option, cmdLine));
+}
+
+string_view CommandLineParser::DumpOption::optionHelp() const
+{
+	return "Print the content of the given debuggable at the end of a "
+	       "batch run (see -batch)";
+}
+
 // class BashOption
 
 void CommandLineParser::BashOption::parseOption(
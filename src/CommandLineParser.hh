@@ -13,6 +13,7 @@
 #include "InfoTopic.hh"
 #include "span.hh"
 #include "components.hh"
+#include <cstdint>
 #include <memory>
 #include <initializer_list>
 #include <string>
@@ -34,7 +35,7 @@ class Interpreter;
 class CommandLineParser
 {
 public:
-	enum ParseStatus { UNPARSED, RUN, CONTROL, TEST, EXIT };
+	enum ParseStatus { UNPARSED, RUN, CONTROL, TEST, BATCH, EXIT };
 	enum ParsePhase {
 		PHASE_BEFORE_INIT,       // --help, --version, -bash
 		PHASE_INIT,              // calls Reactor::init()
@@ -61,6 +62,18 @@ public:
 		return commandOption.commands;
 	}
 
+	/** Only meaningful in batch mode (see -batch option).
+	  * The amount of emulated time (in seconds) to run. */
+	[[nodiscard]] double getBatchDuration() const {
+		return batchOption.duration;
+	}
+	/** Names of the debuggables that must be dumped after a batch run. */
+	[[nodiscard]] const std::vector<std::string>& getBatchDumps() const {
+		return dumpOption.debuggables;
+	}
+	/** Time (see Timer::getTime()) when parsing the command line started. */
+	[[nodiscard]] uint64_t getStartTime() const { return startTime; }
+
 	[[nodiscard]] MSXMotherBoard* getMotherBoard() const;
 	[[nodiscard]] GlobalCommandController& getGlobalCommandController() const;
 	[[nodiscard]] Interpreter& getInterpreter() const;
@@ -82,6 +95,7 @@ private:
 	[[nodiscard]] bool parseOption(const std::string& arg,
 	                 span<std::string>& cmdLine, ParsePhase phase);
 	void createMachineSetting();
+	void loadBatchSettings();
 
 private:
 	std::vector<std::pair<std::string_view, OptionData>> options;
@@ -137,6 +151,20 @@ private:
 		[[nodiscard]] std::string_view optionHelp() const override;
 	} testConfigOption;
 
+	struct BatchOption final : CLIOption {
+		void parseOption(const std::string& option, span<std::string>& cmdLine) override;
+		[[nodiscard]] std::string_view optionHelp() const override;
+
+		double duration = 0.0;
+	} batchOption;
+
+	struct DumpOption final : CLIOption {
+		void parseOption(const std::string& option, span<std::string>& cmdLine) override;
+		[[nodiscard]] std::string_view optionHelp() const override;
+
+		std::vector<std::string> debuggables;
+	} dumpOption;
+
 	struct BashOption final : CLIOption {
 		void parseOption(const std::string& option, span<std::string>& cmdLine) override;
 		[[nodiscard]] std::string_view optionHelp() const override;
@@ -163,6 +191,7 @@ private:
 	HDImageCLI hdImageCLI;
 	CDImageCLI cdImageCLI;
 	ParseStatus parseStatus;
+	uint64_t startTime = 0;
 	bool haveConfig;
 	bool haveSettings;
 };
@@ -537,6 +537,11 @@ void MSXMotherBoard::fastForward(EmuTime::param time, bool fast)
 	msxMixer->unmute();
 }
 
+void MSXMotherBoard::exitCPULoopAt(EmuTime::param time)
+{
+	fastForwardHelper->setTarget(time);
+}
+
 void MSXMotherBoard::pause()
 {
 	if (getMachineConfig()) {
@@ -644,6 +649,9 @@ void MSXMotherBoard::activate(bool active_)
 	auto event = std::make_shared<SimpleEvent>(
 		active ? OPENMSX_MACHINE_ACTIVATED : OPENMSX_MACHINE_DEACTIVATED);
 	msxEventDistributor->distributeEvent(event, scheduler->getCurrentTime());
+	if (getMachineConfig()) {
+		getCPUInterface().updateBreakBlock();
+	}
 	if (active) {
 		realTime->resync();
 	}
@@ -79,6 +79,11 @@ public:
 	 */
 	void fastForward(EmuTime::param time, bool fast);
 
+	/** Make execute() return (at the latest) at the given time. Useful
+	  * to run emulation for an exact amount of time.
+	  */
+	void exitCPULoopAt(EmuTime::param time);
+
 	/** See CPU::exitCPULoopAsync(). */
 	void exitCPULoopAsync();
 	void exitCPULoopSync();
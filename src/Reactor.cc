@@ -21,6 +21,8 @@
 #include "CommandException.hh"
 #include "GlobalCliComm.hh"
 #include "InfoTopic.hh"
+#include "Debuggable.hh"
+#include "Debugger.hh"
 #include "Display.hh"
 #include "Mixer.hh"
 #include "AviRecorder.hh"
@@ -37,16 +39,22 @@
 #include "foreach_file.hh"
 #include "Thread.hh"
 #include "Timer.hh"
+#include "WorkerPool.hh"
 #include "serialize.hh"
 #include "checked_cast.hh"
 #include "ranges.hh"
 #include "statp.hh"
 #include "stl.hh"
 #include "StringOp.hh"
+#include "one_of.hh"
+#include "strCat.hh"
 #include "unreachable.hh"
 #include "view.hh"
+#include "xrange.hh"
 #include "build-info.hh"
+#include <algorithm>
 #include <cassert>
+#include <iostream>
 #include <memory>
 
 using std::make_shared;
@@ -211,6 +219,7 @@ Reactor::Reactor() = default;
 
 void Reactor::init()
 {
+	workerPool = make_unique<WorkerPool>();
 	rtScheduler = make_unique<RTScheduler>();
 	eventDistributor = make_unique<EventDistributor>(*this);
 	globalCliComm = make_unique<GlobalCliComm>();
@@ -507,13 +516,17 @@ void Reactor::enterMainLoop()
 void Reactor::run(CommandLineParser& parser)
 {
 	auto& commandController = *globalCommandController;
+	bool batch = parser.getParseStatus() == CommandLineParser::BATCH;
 
-	// execute init.tcl
-	try {
-		commandController.source(
-			preferSystemFileContext().resolve("init.tcl"));
-	} catch (FileException&) {
-		// no init.tcl, ignore
+	// execute init.tcl (this loads all the scripts in share/scripts, a
+	// batch run only executes the explicitly given scripts)
+	if (!batch) {
+		try {
+			commandController.source(
+				preferSystemFileContext().resolve("init.tcl"));
+		} catch (FileException&) {
+			// no init.tcl, ignore
+		}
 	}
 
 	// execute startup scripts
@@ -539,7 +552,7 @@ void Reactor::run(CommandLineParser& parser)
 	getGlobalCliComm().setAllowExternalCommands();
 
 	// Run
-	if (parser.getParseStatus() == CommandLineParser::RUN) {
+	if (parser.getParseStatus() == one_of(CommandLineParser::RUN, CommandLineParser::BATCH)) {
 		// don't use Tcl to power up the machine, we cannot pass
 		// exceptions through Tcl and ADVRAM might throw in its
 		// powerUp() method. Solution is to implement dependencies
@@ -551,11 +564,63 @@ void Reactor::run(CommandLineParser& parser)
 		}
 	}
 
+	if (batch) {
+		runBatch(parser);
+		return;
+	}
 	while (doOneIteration()) {
 		// nothing
 	}
 }
 
+void Reactor::runBatch(CommandLineParser& parser)
+{
+	if (!activeBoard) {
+		throw FatalError("No machine to run in batch mode");
+	}
+	// Keep running the same machine, even if e.g. a script switches
+	// to another one.
+	auto board = activeBoard;
+	auto startTime = board->getCurrentTime();
+	auto endTime = startTime + EmuDuration(parser.getBatchDuration());
+	board->exitCPULoopAt(endTime);
+
+	auto runStart = Timer::getTime();
+	globalCliComm->printInfo(
+		"Batch: startup took ",
+		(runStart - parser.getStartTime()) / 1000, "ms");
+	auto& powerSetting = getGlobalSettings().getPowerSetting();
+	while ((board->getCurrentTime() < endTime) && powerSetting.getBoolean() &&
+	       doOneIteration()) {
+		// nothing
+	}
+	auto realDuration = double(Timer::getTime() - runStart) / 1000000.0;
+	auto emuDuration = (board->getCurrentTime() - startTime).toDouble();
+	globalCliComm->printInfo(
+		"Batch: emulated ", emuDuration, "s in ", realDuration, "s (",
+		emuDuration / std::max(realDuration, 1e-6), " emulated seconds per second)");
+
+	auto& debugger = board->getDebugger();
+	for (const auto& name : parser.getBatchDumps()) {
+		auto* debuggable = debugger.findDebuggable(name);
+		if (!debuggable) {
+			globalCliComm->printWarning("Batch: no such debuggable: ", name);
+			exitCode = 1;
+			continue;
+		}
+		std::cout << name << ":\n";
+		unsigned size = debuggable->getSize();
+		for (unsigned addr = 0; addr < size; addr += 16) {
+			auto line = strCat(hex_string<8>(addr), ':');
+			for (auto i : xrange(std::min(16u, size - addr))) {
+				strAppend(line, ' ', hex_string<2>(debuggable->read(addr + i)));
+			}
+			std::cout << line << '\n';
+		}
+	}
+	std::cout << std::flush;
+}
+
 bool Reactor::doOneIteration()
 {
 	eventDistributor->deliverEvents();
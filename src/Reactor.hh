@@ -28,6 +28,7 @@ class DiskFactory;
 class DiskManipulator;
 class DiskChanger;
 class FilePool;
+class WorkerPool;
 class UserSettings;
 class RomDatabase;
 class TclCallbackMessages;
@@ -88,6 +89,7 @@ public:
 	[[nodiscard]] DiskManipulator& getDiskManipulator() { return *diskManipulator; }
 	[[nodiscard]] EnumSetting<int>& getMachineSetting() { return *machineSetting; }
 	[[nodiscard]] FilePool& getFilePool() { return *filePool; }
+	[[nodiscard]] WorkerPool& getWorkerPool() { return *workerPool; }
 
 	[[nodiscard]] RomDatabase& getSoftwareDatabase();
 
@@ -130,6 +132,9 @@ private:
 	// running.
 	[[nodiscard]] bool doOneIteration();
 
+	// Main loop for batch mode (see -batch command line option).
+	void runBatch(CommandLineParser& parser);
+
 	void unpause();
 	void pause();
 
@@ -138,6 +143,7 @@ private:
 	                    // the destructors of the unique_ptr below
 
 	// note: order of unique_ptr's is important
+	std::unique_ptr<WorkerPool> workerPool; // shared by all background work
 	std::unique_ptr<RTScheduler> rtScheduler;
 	std::unique_ptr<EventDistributor> eventDistributor;
 	std::unique_ptr<GlobalCliComm> globalCliComm;
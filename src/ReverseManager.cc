@@ -143,6 +143,7 @@ ReverseManager::ReverseManager(MSXMotherBoard& motherBoard_)
 	, reverseCmd(motherBoard.getCommandController())
 	, keyboard(nullptr)
 	, eventDelay(nullptr)
+	, history(motherBoard.getReactor().getWorkerPool())
 	, replayIndex(0)
 	, collecting(false)
 	, pendingTakeSnapshot(false)
@@ -21,6 +21,7 @@ class MSXMotherBoard;
 class Keyboard;
 class EventDelay;
 class EventDistributor;
+class WorkerPool;
 class TclObject;
 class Interpreter;
 
@@ -70,6 +71,9 @@ private:
 	using Events = std::vector<std::shared_ptr<StateChange>>;
 
 	struct ReverseHistory {
+		explicit ReverseHistory(WorkerPool& workerPool)
+			: lastDeltaBlocks(workerPool) {}
+
 		void swap(ReverseHistory& other);
 		void clear();
 		[[nodiscard]] unsigned getNextSeqNum(EmuTime::param time) const;
@@ -2,6 +2,7 @@
 #define SCHEDULABLE_HH
 
 #include "EmuTime.hh"
+#include "Scheduler.hh"
 #include "serialize.hh"
 #include "serialize_meta.hh"
 #include "serialize_stl.hh"
@@ -10,8 +11,6 @@
 
 namespace openmsx {
 
-class Scheduler;
-
 // For backwards-compatible savestates
 struct SyncPointBW
 {
@@ -99,6 +98,10 @@ protected:
 
 private:
 	Scheduler& scheduler;
+#if SCHEDULER_HEAP
+	friend class Scheduler;
+	SchedulerHeap<SynchronizationPoint>::List syncPoints;
+#endif
 };
 REGISTER_BASE_CLASS(Schedulable, "Schedulable");
 
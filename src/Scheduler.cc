@@ -23,7 +23,12 @@ struct EqualSchedulable {
 Scheduler::~Scheduler()
 {
 	assert(!cpu);
+#if SCHEDULER_HEAP
+	SyncPoints copy;
+	queue.for_each([&](const SynchronizationPoint& sp) { copy.push_back(sp); });
+#else
 	auto copy = to_vector(queue);
+#endif
 	for (auto& s : copy) {
 		s.getDevice()->schedulerDeleted();
 	}
@@ -37,10 +42,14 @@ void Scheduler::setSyncPoint(EmuTime::param time, Schedulable& device)
 	assert(time >= scheduleTime);
 
 	// Push sync point into queue.
+#if SCHEDULER_HEAP
+	queue.insert(SynchronizationPoint(time, &device), device.syncPoints);
+#else
 	queue.insert(SynchronizationPoint(time, &device),
 	             [](SynchronizationPoint& sp) { sp.setTime(EmuTime::infinity()); },
 	             [](const SynchronizationPoint& x, const SynchronizationPoint& y) {
 	                     return x.getTime() < y.getTime(); });
+#endif
 
 	if (!scheduleInProgress && cpu) {
 		// only when scheduleHelper() is not being executed
@@ -53,32 +62,54 @@ void Scheduler::setSyncPoint(EmuTime::param time, Schedulable& device)
 Scheduler::SyncPoints Scheduler::getSyncPoints(const Schedulable& device) const
 {
 	SyncPoints result;
+#if SCHEDULER_HEAP
+	queue.for_each(device.syncPoints, [&](const SynchronizationPoint& sp) {
+		result.push_back(sp);
+	});
+#else
 	ranges::copy_if(queue, back_inserter(result), EqualSchedulable(device));
+#endif
 	return result;
 }
 
 bool Scheduler::removeSyncPoint(Schedulable& device)
 {
 	assert(Thread::isMainThread());
+#if SCHEDULER_HEAP
+	return queue.remove(device.syncPoints);
+#else
 	return queue.remove(EqualSchedulable(device));
+#endif
 }
 
 void Scheduler::removeSyncPoints(Schedulable& device)
 {
 	assert(Thread::isMainThread());
+#if SCHEDULER_HEAP
+	queue.remove_all(device.syncPoints);
+#else
 	queue.remove_all(EqualSchedulable(device));
+#endif
 }
 
 bool Scheduler::pendingSyncPoint(const Schedulable& device,
                                  EmuTime& result) const
 {
 	assert(Thread::isMainThread());
+#if SCHEDULER_HEAP
+	if (const auto* sp = queue.find(device.syncPoints)) {
+		result = sp->getTime();
+		return true;
+	}
+	return false;
+#else
 	if (auto it = ranges::find_if(queue, EqualSchedulable(device));
 	    it != std::end(queue)) {
 		result = it->getTime();
 		return true;
 	}
 	return false;
+#endif
 }
 
 EmuTime::param Scheduler::getCurrentTime() const
@@ -2,10 +2,20 @@
 #define SCHEDULER_HH
 
 #include "EmuTime.hh"
+#include "SchedulerHeap.hh"
 #include "SchedulerQueue.hh"
 #include "likely.hh"
 #include <vector>
 
+// Set to 1 to use SchedulerHeap instead of SchedulerQueue for the
+// syncpoints. The heap scales better for machines with many devices, see
+// SchedulerHeap.hh for details. In the benchmark in SchedulerQueue_test.cc
+// the heap is only faster from a few hundred pending syncpoints, a typical
+// machine has far less.
+#ifndef SCHEDULER_HEAP
+#define SCHEDULER_HEAP 0
+#endif
+
 namespace openmsx {
 
 class Schedulable;
@@ -112,7 +122,12 @@ private:
 	/** Vector used as heap, not a priority queue because that
 	  * doesn't allow removal of non-top element.
 	  */
+#if SCHEDULER_HEAP
+	SchedulerHeap<SynchronizationPoint> queue{
+		SynchronizationPoint(EmuTime::infinity(), nullptr)};
+#else
 	SchedulerQueue<SynchronizationPoint> queue;
+#endif
 	EmuTime scheduleTime = EmuTime::zero();
 	MSXCPU* cpu = nullptr;
 	bool scheduleInProgress = false;
@@ -0,0 +1,286 @@
+#ifndef SCHEDULERHEAP_HH
+#define SCHEDULERHEAP_HH
+
+#include "xrange.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace openmsx {
+
+// Alternative for SchedulerQueue, based on an indexed d-ary (4-ary) min-heap.
+//
+// SchedulerQueue is a sorted array: inserting (and removing a non-front
+// element) is O(N), and finding the element to remove is a linear search.
+// That's the best choice for a typical machine with only a handful of
+// syncpoints, but it scales badly for machines with many devices
+// (cartridges, FDCs, serial ports, timers, sound chips, ...).
+//
+// In this heap every element belongs to a 'List', a handle that is owned by
+// the user of the heap (the Scheduler gives each Schedulable one). Via that
+// handle the elements of one owner are found without searching the heap.
+// So insert(), remove_front() and remove() are all O(log N).
+//
+// The elements are ordered on their getTime() value. Just like
+// SchedulerQueue, elements with the same time are returned in insertion
+// order (this is needed to keep emulation deterministic), and remove()
+// removes the earliest element of the owner. For this each element gets a
+// sequence number.
+//
+// The heap itself only contains the time, the sequence number and the index
+// of the slot that holds the actual element. That keeps the heap compact
+// and the comparisons cheap (and branch free).
+template<typename T> class SchedulerHeap
+{
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+	using Time = std::decay_t<decltype(std::declval<T>().getTime())>;
+
+public:
+	// The elements that belong to one owner. The heap keeps a pointer to
+	// it while it's not empty, so it must not move in the mean time.
+	class List {
+	public:
+		List() = default;
+		List(const List&) = delete;
+		List& operator=(const List&) = delete;
+		~List() { assert(first == NONE); }
+
+		[[nodiscard]] bool empty() const { return first == NONE; }
+
+	private:
+		uint32_t first = NONE; // index in 'slots'
+		friend class SchedulerHeap;
+	};
+
+	static constexpr size_t D = 4; // arity of the heap
+	static constexpr size_t CAPACITY = 32; // initial capacity
+
+	// The sentinel must have a time that's bigger than the time of any
+	// other element.
+	explicit SchedulerHeap(const T& sentinel)
+	{
+		heap.reserve(CAPACITY + 1); // one extra for sentinel
+		slots.reserve(CAPACITY + 1);
+		slots.push_back(Slot{sentinel, nullptr, NONE, NONE, 0});
+		heap.push_back(Entry{sentinel.getTime(), std::numeric_limits<uint64_t>::max(), 0});
+	}
+
+	[[nodiscard]] size_t size()  const { return heap.size() - 1; }
+	[[nodiscard]] bool   empty() const { return heap.size() == 1; }
+
+	// Returns reference to the smallest element. When the heap is empty
+	// this returns the sentinel.
+	[[nodiscard]] const T& front() const { return slots[heap.front().slot].value; }
+
+	// Insert new element, owned by the given list.
+	void insert(const T& t, List& list)
+	{
+		assert(nextSeq != std::numeric_limits<uint64_t>::max());
+		auto s = allocSlot();
+		auto& slot = slots[s];
+		slot.value = t;
+		slot.list = &list;
+		slot.prev = NONE;
+		slot.next = list.first;
+		if (list.first != NONE) slots[list.first].prev = s;
+		list.first = s;
+
+		heap.push_back(heap.back()); // move sentinel one position up
+		auto n = size() - 1;
+		Entry e{t.getTime(), nextSeq++, s};
+		assert(less(e, heap.back()));
+		siftUp(n, e);
+	}
+
+	// Remove the smallest element.
+	void remove_front()
+	{
+		assert(!empty());
+		releaseSlot(heap[0].slot);
+		auto n = size() - 1;
+		Entry last = heap[n];
+		heap[n] = heap.back(); // sentinel
+		heap.pop_back();
+		if (n == 0) return;
+
+		siftDown(0, last);
+	}
+
+	// Returns the smallest element of the given list, or nullptr if the
+	// list is empty.
+	[[nodiscard]] const T* find(const List& list) const
+	{
+		auto best = findEntry(list);
+		return (best == NONE) ? nullptr : &slots[heap[best].slot].value;
+	}
+
+	// Remove the smallest element of the given list.
+	// Returns false if the list was empty.
+	bool remove(List& list)
+	{
+		auto best = findEntry(list);
+		if (best == NONE) return false;
+		removeAt(best);
+		return true;
+	}
+
+	// Remove all elements of the given list.
+	void remove_all(List& list)
+	{
+		while (list.first != NONE) {
+			removeAt(slots[list.first].pos);
+		}
+	}
+
+	// Call 'op' for all elements of the given list, from small to big.
+	template<typename OP> void for_each(const List& list, OP op) const
+	{
+		std::vector<uint32_t> tmp;
+		for (auto s = list.first; s != NONE; s = slots[s].next) {
+			tmp.push_back(slots[s].pos);
+		}
+		std::sort(tmp.begin(), tmp.end(), [&](uint32_t x, uint32_t y) {
+			return less(heap[x], heap[y]);
+		});
+		for (auto i : tmp) op(slots[heap[i].slot].value);
+	}
+
+	// Call 'op' for all elements, in an unspecified order.
+	template<typename OP> void for_each(OP op) const
+	{
+		for (auto i : xrange(size())) op(slots[heap[i].slot].value);
+	}
+
+private:
+	struct Entry {
+		Time time;
+		uint64_t seq; // to keep equal times in insertion order
+		uint32_t slot; // index in 'slots'
+	};
+	struct Slot {
+		T value;
+		List* list; // owner of this element (when in use)
+		uint32_t prev, next; // doubly linked list of the owner's elements,
+		                     // 'next' also links the unused slots
+		uint32_t pos; // index in 'heap'
+	};
+
+	[[nodiscard]] static bool less(const Entry& x, const Entry& y)
+	{
+		return (x.time < y.time) | ((x.time == y.time) & (x.seq < y.seq));
+	}
+
+	[[nodiscard]] size_t smallestChild(size_t first, size_t last) const
+	{
+		auto best = first;
+		for (auto c = first + 1; c < last; ++c) {
+			best = less(heap[c], heap[best]) ? c : best;
+		}
+		return best;
+	}
+
+	[[nodiscard]] uint32_t findEntry(const List& list) const
+	{
+		auto best = NONE;
+		for (auto s = list.first; s != NONE; s = slots[s].next) {
+			auto pos = slots[s].pos;
+			if ((best == NONE) || less(heap[pos], heap[best])) {
+				best = pos;
+			}
+		}
+		return best;
+	}
+
+	[[nodiscard]] uint32_t allocSlot()
+	{
+		if (freeSlots != NONE) {
+			auto s = freeSlots;
+			freeSlots = slots[s].next;
+			return s;
+		}
+		slots.emplace_back(slots.front()); // any value will do
+		return uint32_t(slots.size() - 1);
+	}
+
+	void releaseSlot(uint32_t s)
+	{
+		auto& slot = slots[s];
+		if (slot.prev != NONE) {
+			slots[slot.prev].next = slot.next;
+		} else {
+			slot.list->first = slot.next;
+		}
+		if (slot.next != NONE) slots[slot.next].prev = slot.prev;
+		slot.next = freeSlots;
+		freeSlots = s;
+	}
+
+	void removeAt(size_t i)
+	{
+		if (i == 0) {
+			remove_front();
+			return;
+		}
+		releaseSlot(heap[i].slot);
+		auto n = size() - 1;
+		Entry last = heap[n];
+		heap[n] = heap.back(); // sentinel
+		heap.pop_back();
+		if (i == n) return;
+
+		if (less(last, heap[(i - 1) / D])) {
+			siftUp(i, last);
+		} else {
+			siftDown(i, last);
+		}
+	}
+
+	void place(size_t i, const Entry& e)
+	{
+		heap[i] = e;
+		slots[e.slot].pos = uint32_t(i);
+	}
+
+	// Put 'e' at position 'i' or at one of its ancestors.
+	void siftUp(size_t i, const Entry& e)
+	{
+		while (i != 0) {
+			auto parent = (i - 1) / D;
+			if (!less(e, heap[parent])) break;
+			place(i, heap[parent]);
+			i = parent;
+		}
+		place(i, e);
+	}
+
+	// Put 'e' at position 'i' or at one of its descendants.
+	void siftDown(size_t i, const Entry& e)
+	{
+		auto n = size();
+		while (true) {
+			auto first = D * i + 1;
+			if (first >= n) break;
+			auto best = smallestChild(first, std::min(first + D, n));
+			if (!less(heap[best], e)) break;
+			place(i, heap[best]);
+			i = best;
+		}
+		place(i, e);
+	}
+
+private:
+	// Invariant: heap.size() >= 1 and heap.back() is the sentinel, which
+	// refers to slots[0].
+	std::vector<Entry> heap;
+	std::vector<Slot> slots;
+	uint64_t nextSeq = 0;
+	uint32_t freeSlots = NONE;
+};
+
+} // namespace openmsx
+
+#endif // SCHEDULERHEAP_HH
@@ -6,7 +6,6 @@
 #include "MSXMotherBoard.hh"
 #include "Setting.hh"
 #include "InterpreterOutput.hh"
-#include "MSXCPUInterface.hh"
 #include "FileOperations.hh"
 #include "ranges.hh"
 #include "span.hh"
@@ -105,9 +104,6 @@ Interpreter::Interpreter()
 
 Interpreter::~Interpreter()
 {
-	// see comment in MSXCPUInterface::cleanup()
-	MSXCPUInterface::cleanup();
-
 	if (!Tcl_InterpDeleted(interp)) {
 		Tcl_DeleteInterp(interp);
 	}
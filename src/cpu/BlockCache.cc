@@ -0,0 +1,193 @@
+#include "BlockCache.hh"
+#include "CacheLine.hh"
+#include "xrange.hh"
+#include <cstdint>
+
+namespace openmsx {
+
+struct OpInfo {
+	byte length; // 0 -> can't be part of a block
+	BlockCache::Read read;
+};
+
+// Classify the main (non-prefixed) opcodes. Only instructions that don't
+// write to memory or IO ports and that don't influence the interrupt or
+// halt state are allowed.
+static constexpr OpInfo classify(unsigned op)
+{
+	using Read = BlockCache::Read;
+	if ((0x40 <= op) && (op < 0x80)) {
+		// ld r,r'  (but not 'ld (hl),r' or 'halt')
+		if ((op & 0xF8) == 0x70) return {0, Read::NONE};
+		return {1, ((op & 7) == 6) ? Read::HL : Read::NONE};
+	}
+	if ((0x80 <= op) && (op < 0xC0)) {
+		// add/adc/sub/sbc/and/xor/or/cp
+		return {1, ((op & 7) == 6) ? Read::HL : Read::NONE};
+	}
+	switch (op) {
+	case 0x00: // nop
+	case 0x03: case 0x13: case 0x23: case 0x33: // inc ss
+	case 0x0B: case 0x1B: case 0x2B: case 0x3B: // dec ss
+	case 0x04: case 0x0C: case 0x14: case 0x1C: case 0x24: case 0x2C: case 0x3C: // inc r
+	case 0x05: case 0x0D: case 0x15: case 0x1D: case 0x25: case 0x2D: case 0x3D: // dec r
+	case 0x07: case 0x0F: case 0x17: case 0x1F: // rlca/rrca/rla/rra
+	case 0x08: // ex af,af'
+	case 0x09: case 0x19: case 0x29: case 0x39: // add hl,ss
+	case 0x27: case 0x2F: case 0x37: case 0x3F: // daa/cpl/scf/ccf
+	case 0xD9: // exx
+	case 0xEB: // ex de,hl
+	case 0xF9: // ld sp,hl
+		return {1, Read::NONE};
+	case 0x0A: // ld a,(bc)
+		return {1, Read::BC};
+	case 0x1A: // ld a,(de)
+		return {1, Read::DE};
+	case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x3E: // ld r,n
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE: // alu n
+	case 0x10: // djnz
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // jr (cc,)e
+		return {2, Read::NONE};
+	case 0x01: case 0x11: case 0x21: case 0x31: // ld ss,nn
+	case 0xC3: // jp nn
+	case 0xC2: case 0xCA: case 0xD2: case 0xDA: case 0xE2: case 0xEA: case 0xF2: case 0xFA: // jp cc,nn
+		return {3, Read::NONE};
+	case 0x2A: // ld hl,(nn)
+		return {3, Read::NN_WORD};
+	case 0x3A: // ld a,(nn)
+		return {3, Read::NN};
+	default:
+		return {0, Read::NONE};
+	}
+}
+
+struct OpTable {
+	OpInfo info[256];
+};
+static constexpr OpTable initOpTable()
+{
+	OpTable table = {};
+	for (auto op : xrange(256)) {
+		table.info[op] = classify(op);
+	}
+	return table;
+}
+static constexpr OpTable opTable = initOpTable();
+
+static inline int fetch(unsigned address, const byte* const* readLines)
+{
+	address &= 0xFFFF;
+	const byte* line = readLines[address >> CacheLine::BITS];
+	if (uintptr_t(line) <= 1) return -1; // not cached
+	return line[address];
+}
+
+
+const BlockCache::Instr* BlockCache::Block::find(unsigned address) const
+{
+	for (auto i : xrange(numInstrs)) {
+		if (instrs[i].address == address) return &instrs[i];
+	}
+	return nullptr;
+}
+
+bool BlockCache::decode(unsigned address, const byte* const* readLines, Instr& instr)
+{
+	int op = fetch(address, readLines);
+	if (op < 0) return false;
+	instr.address = address;
+	instr.operand = 0;
+	if (op == 0xCB) {
+		int op2 = fetch(address + 1, readLines);
+		if (op2 < 0) return false;
+		instr.length = 2;
+		instr.read = Read::NONE;
+		if ((op2 & 7) == 6) {
+			// (hl) operand: only 'bit n,(hl)' doesn't write to memory
+			if ((op2 & 0xC0) != 0x40) return false;
+			instr.read = Read::HL;
+		}
+		return true;
+	}
+	auto [length, read] = opTable.info[op];
+	if (length == 0) return false;
+	instr.length = length;
+	instr.read = read;
+	if (length == 3) {
+		int lo = fetch(address + 1, readLines);
+		int hi = fetch(address + 2, readLines);
+		if ((lo < 0) || (hi < 0)) return false;
+		instr.operand = lo + 256 * hi;
+	} else if (length == 2) {
+		if (fetch(address + 1, readLines) < 0) return false;
+	}
+	return true;
+}
+
+bool BlockCache::isValid(const Block& block, const byte* const* readLines)
+{
+	for (auto i : xrange(block.end - block.begin)) {
+		if (fetch(block.begin + i, readLines) != block.code[i]) return false;
+	}
+	return true;
+}
+
+const BlockCache::Block* BlockCache::lookup(
+	unsigned address, const byte* const* readLines) const
+{
+	for (auto i : xrange(numBlocks)) {
+		const auto& block = blocks[i];
+		if ((block.begin <= address) && (address < block.end) &&
+		    block.find(address) && isValid(block, readLines)) {
+			return &block;
+		}
+	}
+	return nullptr;
+}
+
+const BlockCache::Block* BlockCache::insert(
+	unsigned begin, unsigned branch, const byte* const* readLines)
+{
+	if ((branch < begin) || ((branch - begin) >= MAX_BYTES)) return nullptr;
+
+	Block block;
+	block.numInstrs = 0;
+	unsigned address = begin;
+	while (true) {
+		if (block.numInstrs == MAX_INSTRS) return nullptr;
+		auto& instr = block.instrs[block.numInstrs];
+		if (!decode(address, readLines, instr)) return nullptr;
+		++block.numInstrs;
+		address += instr.length;
+		if (instr.address == branch) break;
+		if (address > branch) return nullptr; // not on an instruction boundary
+	}
+	// don't wrap around at the end of the address space
+	if (((address - begin) > MAX_BYTES) || (address >= 0x10000)) return nullptr;
+	block.begin = begin;
+	block.end = address;
+	for (auto i : xrange(address - begin)) {
+		block.code[i] = fetch(begin + i, readLines);
+	}
+
+	// replace a block with the same start address, otherwise round-robin
+	unsigned idx = [&] {
+		for (auto i : xrange(numBlocks)) {
+			if (blocks[i].begin == begin) return unsigned(i);
+		}
+		if (numBlocks < blocks.size()) return numBlocks++;
+		unsigned v = victim;
+		victim = (victim + 1) % blocks.size();
+		return v;
+	}();
+	blocks[idx] = block;
+	return &blocks[idx];
+}
+
+void BlockCache::clear()
+{
+	numBlocks = 0;
+	victim = 0;
+}
+
+} // namespace openmsx
@@ -0,0 +1,98 @@
+#ifndef BLOCKCACHE_HH
+#define BLOCKCACHE_HH
+
+#include "openmsx.hh"
+#include <array>
+
+namespace openmsx {
+
+/** Cache of pre-decoded Z80 code blocks.
+  *
+  * A block is a short stretch of straight-line code, read from cacheable
+  * memory, that ends in a backwards jump to its own start. In other words
+  * a (small) loop. Only instructions that have no side effects other than
+  * changing CPU registers (plus reading from cacheable memory) can be part
+  * of a block. Typical examples are loops that poll a RAM location that
+  * gets changed by an interrupt routine.
+  *
+  * CPUCore uses these blocks as a second execution tier: when such a loop
+  * reaches a steady state (all registers unchanged after one iteration),
+  * then all remaining iterations until the next synchronization point can
+  * be skipped at once, with exactly the same end result (time, R register)
+  * as when they would have been interpreted one by one.
+  *
+  * Blocks are validated against the current memory content on every lookup,
+  * so they automatically become invalid on writes to the code or on
+  * slot/mapper switches (either via a mismatch in content or because the
+  * memory is no longer cacheable).
+  */
+class BlockCache
+{
+public:
+	/** Which (data) memory location an instruction reads. */
+	enum class Read : byte {
+		NONE,    // no data memory read
+		BC,      // byte at (BC)
+		DE,      // byte at (DE)
+		HL,      // byte at (HL)
+		NN,      // byte at a constant address
+		NN_WORD, // word at a constant address
+	};
+
+	struct Instr {
+		word address;
+		word operand; // the constant address for Read::NN(_WORD)
+		byte length;
+		Read read;
+	};
+
+	static constexpr unsigned MAX_INSTRS = 16;
+	static constexpr unsigned MAX_BYTES = 48;
+
+	struct Block {
+		[[nodiscard]] const Instr* find(unsigned address) const;
+
+		std::array<Instr, MAX_INSTRS> instrs;
+		std::array<byte, MAX_BYTES> code; // to validate the block
+		word begin; // address of the first instruction
+		word end;   // address right after the backwards jump
+		byte numInstrs;
+	};
+
+	/** Decode the instruction at the given address.
+	  * Returns false if that instruction is not cacheable memory or if it
+	  * cannot be part of a block (it has side effects).
+	  * @param address The (CPU) address of the instruction.
+	  * @param readLines The CPU read cache lines (see CPUCore).
+	  * @param instr Output parameter, only valid when true is returned.
+	  */
+	[[nodiscard]] static bool decode(unsigned address,
+	                                 const byte* const* readLines,
+	                                 Instr& instr);
+
+	/** Find a still valid block that contains the given address at an
+	  * instruction boundary. Returns nullptr if there is none. */
+	[[nodiscard]] const Block* lookup(unsigned address,
+	                                  const byte* const* readLines) const;
+
+	/** Decode a new block [begin, branch] where 'branch' is the address
+	  * of the jump instruction back to 'begin'. Returns nullptr if that
+	  * range can't form a block. */
+	const Block* insert(unsigned begin, unsigned branch,
+	                    const byte* const* readLines);
+
+	/** Drop all blocks. */
+	void clear();
+
+private:
+	[[nodiscard]] static bool isValid(const Block& block,
+	                                  const byte* const* readLines);
+
+	std::array<Block, 4> blocks;
+	unsigned numBlocks = 0;
+	unsigned victim = 0;
+};
+
+} // namespace openmsx
+
+#endif
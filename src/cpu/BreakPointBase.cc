@@ -5,12 +5,19 @@
 
 namespace openmsx {
 
-bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp) const
+bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp,
+                            CompiledCondition::Context* context) const
 {
 	if (condition.getString().empty()) {
 		// unconditional bp
 		return true;
 	}
+	if (context && compiled) {
+		if (auto result = compiled->evaluate(*context)) {
+			return *result;
+		}
+		// on error, fall back to Tcl (that reports the error)
+	}
 	try {
 		return condition.evalBool(interp);
 	} catch (CommandException& e) {
@@ -19,14 +26,22 @@ bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp) const
 	}
 }
 
-void BreakPointBase::checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp)
+bool BreakPointBase::mightBeTrue(CompiledCondition::Context& context) const
+{
+	if (condition.getString().empty() || !compiled) return true;
+	auto result = compiled->evaluate(context);
+	return !result || *result;
+}
+
+void BreakPointBase::checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp,
+                                     CompiledCondition::Context* context)
 {
 	if (executing) {
 		// no recursive execution
 		return;
 	}
 	ScopedAssign sa(executing, true);
-	if (isTrue(cliComm, interp)) {
+	if (isTrue(cliComm, interp, context)) {
 		try {
 			command.executeCommand(interp, true); // compile command
 		} catch (CommandException& e) {
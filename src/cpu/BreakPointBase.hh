@@ -1,7 +1,9 @@
 #ifndef BREAKPOINTBASE_HH
 #define BREAKPOINTBASE_HH
 
+#include "CompiledCondition.hh"
 #include "TclObject.hh"
+#include <memory>
 #include <string_view>
 
 namespace openmsx {
@@ -20,7 +22,15 @@ public:
 	[[nodiscard]] TclObject getCommandObj()   const { return command; }
 	[[nodiscard]] bool onlyOnce() const { return once; }
 
-	void checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp);
+	/** When a context is given, the condition is (if possible) evaluated
+	  * without going through the Tcl interpreter, see CompiledCondition.
+	  */
+	void checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp,
+	                     CompiledCondition::Context* context = nullptr);
+
+	/** Fast check, without the Tcl interpreter. Returns false when the
+	  * condition is known to be false. */
+	[[nodiscard]] bool mightBeTrue(CompiledCondition::Context& context) const;
 
 protected:
 	// Note: we require GlobalCliComm here because breakpoint objects can
@@ -29,14 +39,17 @@ protected:
 	BreakPointBase(TclObject command_, TclObject condition_, bool once_)
 		: command(std::move(command_))
 		, condition(std::move(condition_))
+		, compiled(CompiledCondition::compile(condition.getString()))
 		, once(once_) {}
 
 private:
-	[[nodiscard]] bool isTrue(GlobalCliComm& cliComm, Interpreter& interp) const;
+	[[nodiscard]] bool isTrue(GlobalCliComm& cliComm, Interpreter& interp,
+	                          CompiledCondition::Context* context) const;
 
 private:
 	TclObject command;
 	TclObject condition;
+	std::shared_ptr<const CompiledCondition> compiled; // nullptr -> use Tcl
 	bool once;
 	bool executing = false;
 };
@@ -38,6 +38,7 @@ protected:
 		return clock.getFastAdd(limit - remaining + cc);
 	}
 	void setTime(EmuTime::param time) { sync(); clock.reset(time); }
+	[[nodiscard]] uint64_t getTotalTicks() const { sync(); return clock.getTotalTicks(); }
 	void setFreq(unsigned freq) { clock.setFreq(freq); }
 	void advanceTime(EmuTime::param time);
 	[[nodiscard]] EmuTime calcTime(EmuTime::param time, unsigned ticks) const {
@@ -112,6 +113,11 @@ protected:
 	[[nodiscard]] inline bool limitReached() const {
 		return remaining < 0;
 	}
+	/** The number of cycles that can still be executed before
+	  * limitReached() returns true. Negative if it already does. */
+	[[nodiscard]] int getRemaining() const {
+		return remaining;
+	}
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
@@ -159,6 +159,9 @@
 // instructions too late.
 
 #include "CPUCore.hh"
+#include "CPUProfiler.hh"
+#include "Debugger.hh"
+#include "InstructionTrace.hh"
 #include "MSXCPUInterface.hh"
 #include "Scheduler.hh"
 #include "MSXMotherBoard.hh"
@@ -173,6 +176,7 @@
 #include "inline.hh"
 #include "unreachable.hh"
 #include "xrange.hh"
+#include <array>
 #include <iostream>
 #include <type_traits>
 #include <cassert>
@@ -263,12 +267,6 @@ static constexpr Table initTables()
 
 constexpr Table table = initTables();
 
-// Global variable, because it should be shared between Z80 and R800.
-// It must not be shared between the CPUs of different MSX machines, but
-// the (logical) lifetime of this variable cannot overlap between execution
-// of two MSX machines.
-static word start_pc;
-
 // conditions
 struct CondC  { bool operator()(byte f) const { return  (f & C_FLAG) != 0; } };
 struct CondNC { bool operator()(byte f) const { return !(f & C_FLAG); } };
@@ -283,7 +281,8 @@ struct CondTrue { bool operator()(byte /*f*/) const { return true; } };
 template<typename T> CPUCore<T>::CPUCore(
 		MSXMotherBoard& motherboard_, const string& name,
 		const BooleanSetting& traceSetting_,
-		TclCallback& diHaltCallback_, EmuTime::param time)
+		TclCallback& diHaltCallback_, CPUProfiler& profiler_,
+		InstructionTrace& instructionTrace_, EmuTime::param time)
 	: CPURegs(T::isR800())
 	, T(time, motherboard_.getScheduler())
 	, motherboard(motherboard_)
@@ -291,6 +290,10 @@ template<typename T> CPUCore<T>::CPUCore(
 	, interface(nullptr)
 	, traceSetting(traceSetting_)
 	, diHaltCallback(diHaltCallback_)
+	, profiler(profiler_)
+	, instructionTrace(instructionTrace_)
+	, coverage(motherboard.getDebugger().getMemoryCoverage())
+	, coverageLines(coverage)
 	, IRQStatus(motherboard.getDebugger(), name + ".pendingIRQ",
 	            "Non-zero if there are pending IRQs (thus CPU would enter "
 	            "interrupt routine in EI mode).",
@@ -553,6 +556,13 @@ template<typename T> void CPUCore<T>::doSetFreq()
 	}
 }
 
+template<typename T> void CPUCore<T>::setBlockCacheEnabled(bool enabled)
+{
+	assert(!enabled || !T::isR800());
+	blockCacheEnabled = enabled;
+	blockCache.clear();
+}
+
 
 template<typename T> inline byte CPUCore<T>::READ_PORT(unsigned port, unsigned cc)
 {
@@ -571,6 +581,51 @@ template<typename T> inline void CPUCore<T>::WRITE_PORT(unsigned port, byte valu
 	// note: no forced page-break after IO
 }
 
+// Called after each memory access, only does something while collecting
+// coverage, recording an instruction trace or profiling (see execute2()). Coverage is
+// counted after the access, then the cache line is filled in (or marked as
+// non-cacheable) and it directly points into the backing store. For a word
+// access 'value' contains both bytes, low byte first.
+template<typename T> ALWAYS_INLINE void CPUCore<T>::memHook(
+	MemoryCoverage::Kind kind, unsigned address, unsigned value, unsigned num)
+{
+	if (unlikely(memHooks)) {
+		memHookSlow(kind, address, value, num); // not inlined
+	}
+}
+template<typename T> NEVER_INLINE void CPUCore<T>::memHookSlow(
+	MemoryCoverage::Kind kind, unsigned address, unsigned value, unsigned num)
+{
+	for (auto i : xrange(num)) {
+		unsigned addr = (address + i) & 0xFFFF;
+		if (coverage.isEnabled()) {
+			unsigned high = addr >> CacheLine::BITS;
+			const byte* line = (kind == MemoryCoverage::WRITE) ? writeCacheLine[high]
+			                                                   : readCacheLine[high];
+			if (uintptr_t(line) > 1) coverageLines.count(kind, line, addr);
+		}
+		// opcode and operand bytes are already part of the trace record
+		if (recording && (kind != MemoryCoverage::EXEC)) {
+			instructionTrace.access(kind == MemoryCoverage::WRITE, word(addr),
+			                        byte(value >> (8 * i)));
+		}
+	}
+}
+// Called after fetching the first opcode byte of an instruction (but not
+// for the byte after a prefix).
+template<typename T> ALWAYS_INLINE void CPUCore<T>::fetchHook(unsigned address)
+{
+	if (unlikely(memHooks)) {
+		fetchHookSlow(address); // not inlined
+	}
+}
+template<typename T> NEVER_INLINE void CPUCore<T>::fetchHookSlow(unsigned address)
+{
+	if (recording) recordPre(ExecIRQ::NONE);
+	if (profiling) profilePre(ExecIRQ::NONE);
+	memHookSlow(MemoryCoverage::EXEC, address, 0, 1);
+}
+
 template<typename T> template<bool PRE_PB, bool POST_PB>
 NEVER_INLINE byte CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 {
@@ -629,11 +684,15 @@ template<typename T> template<unsigned PC_OFFSET> ALWAYS_INLINE byte CPUCore<T>:
 	// faster to only update PC once per instruction instead of after each
 	// fetch.
 	unsigned address = (getPC() + PC_OFFSET) & 0xFFFF;
-	return RDMEM_impl<false, false>(address, cc);
+	byte result = RDMEM_impl<false, false>(address, cc);
+	memHook(MemoryCoverage::EXEC, address, result);
+	return result;
 }
 template<typename T> ALWAYS_INLINE byte CPUCore<T>::RDMEM(unsigned address, unsigned cc)
 {
-	return RDMEM_impl<true, true>(address, cc);
+	byte result = RDMEM_impl<true, true>(address, cc);
+	memHook(MemoryCoverage::READ, address, result);
+	return result;
 }
 
 template<typename T> template<bool PRE_PB, bool POST_PB>
@@ -667,12 +726,16 @@ ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD_impl(unsigned address, unsigned cc)
 template<typename T> template<unsigned PC_OFFSET> ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD_PC(unsigned cc)
 {
 	unsigned addr = (getPC() + PC_OFFSET) & 0xFFFF;
-	return RD_WORD_impl<false, false>(addr, cc);
+	unsigned result = RD_WORD_impl<false, false>(addr, cc);
+	memHook(MemoryCoverage::EXEC, addr, result, 2);
+	return result;
 }
 template<typename T> ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD(
 	unsigned address, unsigned cc)
 {
-	return RD_WORD_impl<true, true>(address, cc);
+	unsigned result = RD_WORD_impl<true, true>(address, cc);
+	memHook(MemoryCoverage::READ, address, result, 2);
+	return result;
 }
 
 template<typename T> template<bool PRE_PB, bool POST_PB>
@@ -727,6 +790,7 @@ template<typename T> ALWAYS_INLINE void CPUCore<T>::WRMEM(
 	unsigned address, byte value, unsigned cc)
 {
 	WRMEM_impl<true, true>(address, value, cc);
+	memHook(MemoryCoverage::WRITE, address, value);
 }
 
 template<typename T> NEVER_INLINE void CPUCore<T>::WR_WORD_slow(
@@ -748,6 +812,7 @@ template<typename T> ALWAYS_INLINE void CPUCore<T>::WR_WORD(
 		// slow path, not inline
 		WR_WORD_slow(address, value, cc);
 	}
+	memHook(MemoryCoverage::WRITE, address, value, 2);
 }
 
 // same as WR_WORD, but writes high byte first
@@ -780,6 +845,7 @@ ALWAYS_INLINE void CPUCore<T>::WR_WORD_rev(
 	constexpr bool PRE  = T::template Normalize<PRE_PB >::value;
 	constexpr bool POST = T::template Normalize<POST_PB>::value;
 	WR_WORD_rev2<PRE, POST>(address, value, cc);
+	memHook(MemoryCoverage::WRITE, address, value, 2);
 }
 
 
@@ -892,6 +958,7 @@ void CPUCore<T>::executeInstructions()
 		if (likely(uintptr_t(line) > 1)) { \
 			T::template PRE_MEM<false, false>(address); \
 			T::template POST_MEM<      false>(address); \
+			fetchHook(address); \
 			byte op = line[address]; \
 			goto *(opcodeTable[op]); \
 		} else { \
@@ -951,14 +1018,15 @@ void CPUCore<T>::executeInstructions()
 start:
 #endif
 	unsigned ixy; // for dd_cb/fd_cb
-	byte opcodeMain = RDMEM_OPCODE<0>(T::CC_MAIN);
+	byte opcodeMain = RDMEM_impl<false, false>(getPC(), T::CC_MAIN);
+	fetchHook(getPC());
 	incR(1);
 #ifdef USE_COMPUTED_GOTO
 	goto *(opcodeTable[opcodeMain]);
 
 fetchSlow: {
-	unsigned address = getPC();
-	byte opcodeSlow = RDMEMslow<false, false>(address, T::CC_MAIN);
+	byte opcodeSlow = RDMEM_impl<false, false>(getPC(), T::CC_MAIN);
+	fetchHook(getPC());
 	goto *(opcodeTable[opcodeSlow]);
 }
 #endif
@@ -2462,6 +2530,58 @@ template<typename T> void CPUCore<T>::cpuTracePost_slow()
 	          << std::flush;
 }
 
+template<typename T> void CPUCore<T>::profilePre(ExecIRQ execIRQ)
+{
+	profilePost(); // in the fast loop the previous instruction ends here
+	profilePending = true;
+	profileIRQ = execIRQ;
+	profilePC = getPC();
+	profiler.begin(getPC(), getSP(), T::getTotalTicks());
+}
+template<typename T> void CPUCore<T>::profilePost()
+{
+	if (!profilePending) return;
+	profilePending = false;
+	auto transfer = CPUProfiler::Transfer::NONE;
+	if (profileIRQ != ExecIRQ::NONE) {
+		transfer = CPUProfiler::Transfer::INTERRUPT;
+	} else if ((getSP() == word(profiler.getStartSP() - 2)) &&
+	           CPUProfiler::isCallOpcode(interface->peekMem(profilePC, T::getTimeFast()))) {
+		// (only peek when needed, most instructions don't touch SP)
+		transfer = CPUProfiler::Transfer::CALL;
+	}
+	profiler.end(getPC(), getSP(), T::getTotalTicks(), transfer);
+}
+
+template<typename T> byte CPUCore<T>::peekCode(word address) const
+{
+	const byte* line = readCacheLine[address >> CacheLine::BITS];
+	return (uintptr_t(line) > 1) ? line[address]
+	                             : interface->peekMem(address, T::getTimeFast());
+}
+template<typename T> void CPUCore<T>::recordPre(ExecIRQ execIRQ)
+{
+	using Kind = InstructionTrace::Kind;
+	recordPost(); // in the fast loop the previous instruction ends here
+	word pc = getPC();
+	if (execIRQ != ExecIRQ::NONE) {
+		instructionTrace.begin(pc, {}, (execIRQ == ExecIRQ::NMI) ? Kind::NMI : Kind::IRQ,
+		                       T::getTotalTicks());
+		return;
+	}
+	byte opcode[4];
+	opcode[0] = peekCode(pc);
+	opcode[1] = peekCode(pc + 1);
+	unsigned len = instructionLength(opcode[0], opcode[1]);
+	for (auto i : xrange(2u, len)) opcode[i] = peekCode(pc + i);
+	instructionTrace.begin(pc, span<const byte>(opcode, len), Kind::INSTRUCTION,
+	                       T::getTotalTicks());
+}
+template<typename T> void CPUCore<T>::recordPost()
+{
+	if (instructionTrace.isPending()) instructionTrace.end(*this);
+}
+
 template<typename T> ExecIRQ CPUCore<T>::getExecIRQ() const
 {
 	if (unlikely(nmiEdge)) return ExecIRQ::NMI;
@@ -2471,6 +2591,9 @@ template<typename T> ExecIRQ CPUCore<T>::getExecIRQ() const
 
 template<typename T> void CPUCore<T>::executeSlow(ExecIRQ execIRQ)
 {
+	// (for instructions the record starts at the opcode fetch)
+	if (unlikely(recording) && (execIRQ != ExecIRQ::NONE)) recordPre(execIRQ);
+	if (unlikely(profiling) && (execIRQ != ExecIRQ::NONE)) profilePre(execIRQ);
 	if (unlikely(execIRQ == ExecIRQ::NMI)) {
 		nmiEdge = false;
 		nmi(); // NMI occurred
@@ -2536,6 +2659,112 @@ template<typename T> void CPUCore<T>::executeSlow(ExecIRQ execIRQ)
 	}
 }
 
+template<typename T> bool CPUCore<T>::stepInstruction()
+{
+	// Execute exactly one instruction, similar to executeSlow(). Returns
+	// false when we must return to the main loop.
+	T::disableLimit();
+	executeInstructions();
+	endInstruction();
+	if (slowInstructions) {
+		// keep limit disabled, see setSlowInstructions()
+		return false;
+	}
+	T::enableLimit();
+	return !T::limitReached();
+}
+
+template<typename T> bool CPUCore<T>::isCachedRead(const BlockCache::Instr& instr) const
+{
+	auto cached = [&](unsigned address) {
+		return uintptr_t(readCacheLine[(address & 0xFFFF) >> CacheLine::BITS]) > 1;
+	};
+	switch (instr.read) {
+		case BlockCache::Read::NONE:    return true;
+		case BlockCache::Read::BC:      return cached(getBC());
+		case BlockCache::Read::DE:      return cached(getDE());
+		case BlockCache::Read::HL:      return cached(getHL());
+		case BlockCache::Read::NN:      return cached(instr.operand);
+		case BlockCache::Read::NN_WORD: return cached(instr.operand) &&
+		                                       cached(instr.operand + 1);
+		default: UNREACHABLE; return false;
+	}
+}
+
+// Second execution tier: skip idle loops.
+//
+// Many programs spend a lot of time in small loops that poll some memory
+// location (e.g. waiting till the interrupt routine changed some variable).
+// When such a loop only reads from cacheable memory and doesn't write to
+// memory or IO ports, then nothing can change until the next sync point
+// (device emulation) or interrupt. And both of those can only occur when the
+// CPU limit is reached. So once an iteration of the loop leaves all registers
+// unchanged, all further iterations (that end before the limit) will be
+// identical as well. So instead of interpreting them, we can directly advance
+// the time (and the R register).
+//
+// The loop itself is still executed (at least once per limit) by the regular
+// interpreter, so there's no need to duplicate the instruction semantics.
+template<typename T> void CPUCore<T>::executeBlockCache()
+{
+	assert(!T::isR800());
+	assert(!T::limitReached());
+
+	const auto* block = blockCache.lookup(getPC(), readCacheLine);
+	if (!block) {
+		// Interpret (side-effect free) instructions till a backwards
+		// jump is taken, that's the candidate loop.
+		for (unsigned i = 0; i < BlockCache::MAX_INSTRS; ++i) {
+			unsigned pc = getPC();
+			BlockCache::Instr instr;
+			if (!BlockCache::decode(pc, readCacheLine, instr) ||
+			    !isCachedRead(instr) || !stepInstruction()) {
+				return;
+			}
+			if (unsigned newPC = getPC(); newPC <= pc) {
+				block = blockCache.insert(newPC, pc, readCacheLine);
+				break;
+			}
+		}
+		if (!block) return;
+	}
+
+	auto step = [&] {
+		const auto* instr = block->find(getPC());
+		return instr && isCachedRead(*instr) && stepInstruction();
+	};
+	// Continue till the start of the loop ...
+	for (unsigned i = 0; getPC() != block->begin; ++i) {
+		if ((i == BlockCache::MAX_INSTRS) || !step()) return;
+	}
+
+	// ... and interpret one more iteration
+	auto getRegs = [&] {
+		return std::array<unsigned, 12>{
+			getAF(),  getBC(),  getDE(),  getHL(),
+			getAF2(), getBC2(), getDE2(), getHL2(),
+			getIX(),  getIY(),  getSP(),  T::getMemPtr()};
+	};
+	auto regs = getRegs();
+	auto ticks = T::getTotalTicks();
+	byte r = getR();
+	unsigned i = 0;
+	do {
+		if ((i++ == 2 * BlockCache::MAX_INSTRS) || !step()) return;
+	} while (getPC() != block->begin);
+	if (getRegs() != regs) return; // not (yet) in a steady state
+
+	// All following iterations are identical, skip the ones that end
+	// before the limit. Exactly like the interpreter would have done.
+	auto iterationTicks = unsigned(T::getTotalTicks() - ticks);
+	byte iterationR = (getR() - r) & 0x7F;
+	assert(iterationTicks > 0);
+	unsigned iterations = unsigned(T::getRemaining()) / iterationTicks;
+	T::add(iterations * iterationTicks);
+	incR(byte(iterations * iterationR));
+	assert(!T::limitReached());
+}
+
 template<typename T> void CPUCore<T>::execute(bool fastForward)
 {
 	// In fast-forward mode, breakpoints, watchpoints or debug condtions
@@ -2546,6 +2775,8 @@ template<typename T> void CPUCore<T>::execute(bool fastForward)
 		interface->setFastForward(true);
 	}
 	execute2(fastForward);
+	recordPost(); // all records must be complete outside the CPU loop
+	profilePost(); // same for the profiler
 	interface->setFastForward(false);
 }
 
@@ -2558,6 +2789,15 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 	scheduler.schedule(T::getTime());
 	setSlowInstructions();
 
+	// Only sample these once, also within the fast loop they must stay
+	// constant so that the begin() and end() calls on the instruction trace
+	// and on the profiler always match. MSXCPU::setTraceEnabled(),
+	// MSXCPU::setProfilingEnabled() and 'debug coverage start/stop' exit
+	// the CPU loop to pick up a change.
+	recording = !fastForward && instructionTrace.isEnabled();
+	profiling = !fastForward && profiler.isEnabled();
+	memHooks = recording || profiling || coverage.isEnabled();
+
 	// Note: we call scheduler _after_ executing the instruction and before
 	// deciding between executeFast() and executeSlow() (because a
 	// SyncPoint could set an IRQ and then we must choose executeSlow())
@@ -2572,6 +2812,12 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 			} else {
 				while (slowInstructions == 0) {
 					T::enableLimit(); // does CPUClock::sync()
+					// (skipped loop iterations wouldn't show up in
+					// the coverage or the trace)
+					if (blockCacheEnabled && !memHooks &&
+					    likely(!T::limitReached())) {
+						executeBlockCache();
+					}
 					if (likely(!T::limitReached())) {
 						// multiple instructions
 						executeInstructions();
@@ -2596,6 +2842,10 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 				--slowInstructions;
 				executeSlow(getExecIRQ());
 			}
+			// Complete the records, a breakpoint can exit the loop
+			// below (and Tcl could then look at the results).
+			if (recording) recordPost();
+			if (profiling) profilePost();
 			// Don't use getTimeFast() here, we need a call to
 			// CPUClock::sync() 'once in a while'. (During a
 			// reverse fast-forward this wasn't always the case).
@@ -2634,7 +2884,7 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 			//
 			auto execIRQ = getExecIRQ();
 			if ((execIRQ == ExecIRQ::NONE) &&
-			    interface->checkBreakPoints(getPC(), motherboard)) {
+			    interface->checkBreakPoints(getPC())) {
 				assert(interface->isBreaked());
 				break;
 			}
@@ -3998,6 +4248,7 @@ template<typename T> II CPUCore<T>::djnz() {
 // EX (SP),ss
 template<typename T> template<Reg16 REG, int EE> II CPUCore<T>::ex_xsp_SS() {
 	unsigned res = RD_WORD_impl<true, false>(getSP(), T::CC_EX_SP_HL_1 + EE);
+	memHook(MemoryCoverage::READ, getSP(), res, 2);
 	T::setMemPtr(res);
 	WR_WORD_rev<false, true>(getSP(), get16<REG>(), T::CC_EX_SP_HL_2 + EE);
 	set16<REG>(res);
@@ -2,7 +2,9 @@
 #define CPUCORE_HH
 
 #include "CPURegs.hh"
+#include "BlockCache.hh"
 #include "CacheLine.hh"
+#include "MemoryCoverage.hh"
 #include "Probe.hh"
 #include "EmuTime.hh"
 #include "BooleanSetting.hh"
@@ -16,6 +18,8 @@
 namespace openmsx {
 
 class MSXCPUInterface;
+class CPUProfiler;
+class InstructionTrace;
 class Scheduler;
 class MSXMotherBoard;
 class TclCallback;
@@ -51,7 +55,8 @@ class CPUCore final : public CPUBase, public CPURegs, public CPU_POLICY
 public:
 	CPUCore(MSXMotherBoard& motherboard, const std::string& name,
 	        const BooleanSetting& traceSetting,
-	        TclCallback& diHaltCallback, EmuTime::param time);
+	        TclCallback& diHaltCallback, CPUProfiler& profiler,
+	        InstructionTrace& instructionTrace, EmuTime::param time);
 
 	void setInterface(MSXCPUInterface* interf) { interface = interf; }
 
@@ -117,6 +122,13 @@ public:
 	 */
 	void setFreq(unsigned freq);
 
+	/**
+	 * Enable/disable the block cache execution tier (see BlockCache).
+	 * Only supported on Z80, the timing of R800 instructions depends on
+	 * too many external factors (refresh, page breaks).
+	 */
+	void setBlockCacheEnabled(bool enabled);
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -134,12 +146,19 @@ private:
 	const byte* readCacheLine[CacheLine::NUM];
 	byte* writeCacheLine[CacheLine::NUM];
 
+	// pre-decoded (idle) loops, see executeBlockCache()
+	BlockCache blockCache;
+
 	MSXMotherBoard& motherboard;
 	Scheduler& scheduler;
 	MSXCPUInterface* interface;
 
 	const BooleanSetting& traceSetting;
 	TclCallback& diHaltCallback;
+	CPUProfiler& profiler;
+	InstructionTrace& instructionTrace;
+	MemoryCoverage& coverage;
+	MemoryCoverage::LineCache coverageLines;
 
 	Probe<int> IRQStatus;
 	Probe<void> IRQAccept;
@@ -165,6 +184,25 @@ private:
 	/** In sync with traceSetting.getBoolean(). */
 	bool tracingEnabled;
 
+	/** PC at the start of the current instruction, only used for tracing. */
+	word start_pc;
+
+	/** Recording an instruction trace, profiling, and whether the memory
+	  * hooks are needed for one of these or for collecting coverage
+	  * (memHooks). Sampled at the start of execute2(). */
+	bool recording = false;
+	bool profiling = false;
+	bool memHooks = false;
+
+	/** The instruction (or interrupt) that was passed to the profiler's
+	  * begin(), but not yet to end(). See profilePre(). */
+	bool profilePending = false;
+	ExecIRQ profileIRQ = ExecIRQ::NONE;
+	word profilePC = 0;
+
+	/** Use the BlockCache execution tier? */
+	bool blockCacheEnabled = false;
+
 	/** 'normal' Z80 and Z80 in a turboR behave slightly different */
 	const bool isTurboR;
 
@@ -172,6 +210,17 @@ private:
 	inline void cpuTracePre();
 	inline void cpuTracePost();
 	void cpuTracePost_slow();
+	void profilePre(ExecIRQ execIRQ);
+	void profilePost();
+	void recordPre(ExecIRQ execIRQ);
+	void recordPost();
+	[[nodiscard]] byte peekCode(word address) const;
+	inline void memHook(MemoryCoverage::Kind kind, unsigned address,
+	                    unsigned value, unsigned num = 1);
+	void memHookSlow(MemoryCoverage::Kind kind, unsigned address,
+	                 unsigned value, unsigned num);
+	inline void fetchHook(unsigned address);
+	void fetchHookSlow(unsigned address);
 
 	inline byte READ_PORT(unsigned port, unsigned cc);
 	inline void WRITE_PORT(unsigned port, byte value, unsigned cc);
@@ -215,6 +264,9 @@ private:
 	inline void WR_WORD_rev (unsigned address, unsigned value, unsigned cc);
 
 	void executeInstructions();
+	void executeBlockCache();
+	bool stepInstruction();
+	[[nodiscard]] bool isCachedRead(const BlockCache::Instr& instr) const;
 	inline void nmi();
 	inline void irq0();
 	inline void irq1();
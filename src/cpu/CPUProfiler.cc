@@ -0,0 +1,178 @@
+#include "CPUProfiler.hh"
+#include "Debuggable.hh"
+#include "Debugger.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXDevice.hh"
+#include "MSXMapperIO.hh"
+#include "MSXMotherBoard.hh"
+#include "ranges.hh"
+#include "strCat.hh"
+#include "stl.hh"
+#include "view.hh"
+#include <cassert>
+#include <ostream>
+#include <tuple>
+
+namespace openmsx {
+
+// Limits the size of the shadow stack when code never returns from its
+// calls (e.g. it resets the stack pointer instead).
+static constexpr size_t MAX_DEPTH = 1024;
+
+void CPUProfiler::clear()
+{
+	selfCost.clear();
+	callCost.clear();
+	frames.clear();
+}
+
+void CPUProfiler::updatePage(int page)
+{
+	auto& info = pages[page];
+	info = PageInfo();
+	info.valid = true;
+	MSXDevice* device = interface->getVisibleDevice(page);
+	info.mapper = dynamic_cast<MSXMemoryMapperInterface*>(device);
+	if (!info.mapper) {
+		info.romBlocks = device->getMotherBoard().getDebugger().findDebuggable(
+			tmpStrCat(device->getName(), " romblocks"));
+	}
+}
+
+CPUProfiler::Location CPUProfiler::locate(word pc)
+{
+	if (!interface) return makeLocation(pc, 0, -1, -1);
+
+	int page = pc >> 14;
+	int ps = interface->getPrimarySlot(page);
+	int ss = interface->isExpanded(ps) ? interface->getSecondarySlot(page) : -1;
+	if (!pages[page].valid) updatePage(page);
+	const auto& info = pages[page];
+	int segment = info.mapper    ? info.mapper->getSelectedSegment(page)
+	            : info.romBlocks ? info.romBlocks->read(pc)
+	            : -1;
+	return makeLocation(pc, ps, ss, segment);
+}
+
+void CPUProfiler::begin(word pc, word sp, uint64_t ticks)
+{
+	startLocation = locate(pc);
+	startTicks = ticks;
+	startSP = sp;
+}
+
+void CPUProfiler::end(word pc, word sp, uint64_t ticks, Transfer transfer)
+{
+	assert(ticks >= startTicks);
+	if (transfer == Transfer::INTERRUPT) {
+		// Accepting the interrupt takes some cycles, attribute those
+		// to the first instruction of the interrupt handler (but
+		// don't count it as an execution of that instruction).
+		auto handler = locate(pc);
+		if (frames.size() == MAX_DEPTH) frames.erase(frames.begin());
+		frames.push_back({handler, startLocation, startTicks, sp});
+		selfCost[std::pair(handler, handler)].ticks += ticks - startTicks;
+		return;
+	}
+
+	auto& cost = selfCost[std::pair(currentFunction(), startLocation)];
+	cost.ticks += ticks - startTicks;
+	cost.count += 1;
+
+	// returned from one or more functions?
+	while (!frames.empty() && (sp > frames.back().sp)) {
+		auto frame = frames.back();
+		frames.pop_back();
+		auto& edge = callCost[CallKey{currentFunction(), frame.callSite, frame.function}];
+		edge.ticks += ticks - frame.startTicks;
+		edge.count += 1;
+	}
+
+	if (transfer == Transfer::CALL) {
+		if (frames.size() == MAX_DEPTH) frames.erase(frames.begin());
+		frames.push_back({locate(pc), startLocation, ticks, sp});
+	}
+}
+
+std::vector<CPUProfiler::FlatEntry> CPUProfiler::getFlatProfile() const
+{
+	hash_map<Location, Cost> sum;
+	for (const auto& [key, cost] : selfCost) {
+		auto& s = sum[key.second];
+		s.ticks += cost.ticks;
+		s.count += cost.count;
+	}
+	auto result = to_vector(view::transform(sum, [](const auto& p) {
+		return FlatEntry{p.first, p.second};
+	}));
+	ranges::sort(result, [](const FlatEntry& x, const FlatEntry& y) {
+		return std::tuple(y.cost.ticks, x.location) <
+		       std::tuple(x.cost.ticks, y.location);
+	});
+	return result;
+}
+
+std::string CPUProfiler::getName(Location loc)
+{
+	if (loc == ROOT) return "<root>";
+	std::string result = strCat("0x", hex_string<4>(getAddress(loc)),
+	                            " (slot ", getPrimarySlot(loc));
+	if (int ss = getSecondarySlot(loc); ss != -1) {
+		strAppend(result, '-', ss);
+	}
+	if (int segment = getSegment(loc); segment != -1) {
+		strAppend(result, ", segment ", segment);
+	}
+	result += ')';
+	return result;
+}
+
+void CPUProfiler::writeCallgrind(std::ostream& os) const
+{
+	// sort everything on function, so that it can be written per function
+	auto self = to_vector<std::pair<std::pair<Location, Location>, Cost>>(selfCost);
+	ranges::sort(self, [](const auto& x, const auto& y) {
+		return x.first < y.first;
+	});
+	auto calls = to_vector<std::pair<CallKey, Cost>>(callCost);
+	ranges::sort(calls, [](const auto& x, const auto& y) {
+		return std::tuple(x.first.caller, x.first.callSite, x.first.callee) <
+		       std::tuple(y.first.caller, y.first.callSite, y.first.callee);
+	});
+
+	std::vector<Location> functions;
+	uint64_t total = 0;
+	for (const auto& [key, cost] : self) {
+		functions.push_back(key.first);
+		total += cost.ticks;
+	}
+	for (const auto& [key, cost] : calls) functions.push_back(key.caller);
+	ranges::sort(functions);
+	functions.erase(ranges::unique(functions), functions.end());
+
+	os << "# callgrind format\n"
+	      "version: 1\n"
+	      "creator: openMSX\n"
+	      "positions: instr\n"
+	      "events: Ticks\n"
+	      "summary: " << total << '\n';
+
+	auto s = self.begin();
+	auto c = calls.begin();
+	for (auto function : functions) {
+		os << "\nfn=" << getName(function) << '\n';
+		for (; (s != self.end()) && (s->first.first == function); ++s) {
+			os << strCat("0x", hex_string<4>(getAddress(s->first.second)),
+			             ' ', s->second.ticks, '\n');
+		}
+		for (; (c != calls.end()) && (c->first.caller == function); ++c) {
+			os << strCat("cfn=", getName(c->first.callee), "\n"
+			             "calls=", c->second.count,
+			             " 0x", hex_string<4>(getAddress(c->first.callee)), "\n"
+			             "0x", hex_string<4>(getAddress(c->first.callSite)),
+			             ' ', c->second.ticks, '\n');
+		}
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,182 @@
+#ifndef CPUPROFILER_HH
+#define CPUPROFILER_HH
+
+#include "hash_map.hh"
+#include "openmsx.hh"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace openmsx {
+
+class MSXCPUInterface;
+class MSXDevice;
+struct MSXMemoryMapperInterface;
+class Debuggable;
+
+/** Accumulates the executed CPU cycles per instruction and per function.
+  *
+  * Each instruction is identified by its 'location': the address, the
+  * primary and secondary slot and (if known) the selected mapper segment
+  * in the page that contains that address. The segment is known for memory
+  * mappers and for ROM mappers that have a "romblocks" debuggable.
+  *
+  * Calls are tracked with a shadow stack: a CALL or RST instruction (or an
+  * accepted IRQ/NMI) pushes a frame, the frame is popped as soon as the
+  * stack pointer moves above the pushed return address (RET, RETI, RETN,
+  * but also e.g. 'pop hl ; jp (hl)'). For each call edge the number of
+  * calls and the inclusive number of cycles are stored. Code that
+  * manipulates the stack in other ways can confuse this administration,
+  * but it recovers as soon as the stack pointer moves up again.
+  *
+  * The CPU calls begin() and end() around each instruction, but only
+  * while profiling is enabled. It calls them from its opcode fetch hook,
+  * so it keeps running its fast loop (only the block cache is skipped).
+  */
+class CPUProfiler
+{
+public:
+	/** Packed representation of a code location:
+	  *   bits  0-15: address
+	  *   bits 16-17: primary slot
+	  *   bits 18-19: secondary slot
+	  *   bit     20: the primary slot is expanded
+	  *   bits 32-63: mapper segment + 1 (0 means: no mapper)
+	  */
+	using Location = uint64_t;
+	static constexpr Location ROOT = Location(-1); // outside any call
+
+	enum class Transfer {
+		NONE,      // regular instruction
+		CALL,      // CALL or RST instruction that pushed a return address
+		INTERRUPT, // the CPU accepted an IRQ or NMI
+	};
+
+	struct Cost {
+		uint64_t ticks = 0;
+		uint64_t count = 0;
+	};
+	struct FlatEntry {
+		Location location;
+		Cost cost;
+	};
+
+	/** Needed to look up slots and mapper segments. Can be nullptr
+	  * (e.g. in unit tests), then all code is reported in slot 0. */
+	void setInterface(MSXCPUInterface* interf) { interface = interf; }
+
+	void setEnabled(bool enabled_) { enabled = enabled_; }
+	[[nodiscard]] bool isEnabled() const { return enabled; }
+
+	/** Forget all collected data. */
+	void clear();
+
+	/** Must be called when the visible device in the given page changed. */
+	void invalidatePage(int page) { pages[page].valid = false; }
+
+	/** Called right before executing an instruction (or accepting an
+	  * interrupt). */
+	void begin(word pc, word sp, uint64_t ticks);
+	/** Called right after that instruction. 'pc' and 'sp' are the new
+	  * register values. */
+	void end(word pc, word sp, uint64_t ticks, Transfer transfer);
+
+	/** Stack pointer passed to the last begin() call. */
+	[[nodiscard]] word getStartSP() const { return startSP; }
+
+	/** Is this the opcode of a (conditional) CALL or a RST instruction? */
+	[[nodiscard]] static bool isCallOpcode(byte opcode)
+	{
+		return (opcode == 0xCD) ||           // call nn
+		       ((opcode & 0xC7) == 0xC4) ||  // call cc,nn
+		       ((opcode & 0xC7) == 0xC7);    // rst n
+	}
+
+	/** The cost per instruction (summed over all functions it is part
+	  * of), sorted on decreasing number of ticks. */
+	[[nodiscard]] std::vector<FlatEntry> getFlatProfile() const;
+
+	/** Write a report in the format of the callgrind tool (see
+	  * valgrind.org), this can be visualized with e.g. KCachegrind. */
+	void writeCallgrind(std::ostream& os) const;
+
+	[[nodiscard]] static Location makeLocation(word address, int ps, int ss, int segment)
+	{
+		return Location(address) | (Location(ps) << 16) |
+		       ((ss >= 0) ? ((Location(ss) << 18) | (Location(1) << 20)) : 0) |
+		       (Location(segment + 1) << 32);
+	}
+	[[nodiscard]] static word getAddress(Location loc) { return word(loc); }
+	[[nodiscard]] static int getPrimarySlot(Location loc) { return (loc >> 16) & 3; }
+	/** Returns -1 for a non-expanded slot. */
+	[[nodiscard]] static int getSecondarySlot(Location loc)
+	{
+		return (loc & (Location(1) << 20)) ? int((loc >> 18) & 3) : -1;
+	}
+	/** Returns -1 when there's no (known) mapper. */
+	[[nodiscard]] static int getSegment(Location loc) { return int(loc >> 32) - 1; }
+	[[nodiscard]] static std::string getName(Location loc);
+
+private:
+	[[nodiscard]] Location locate(word pc);
+	void updatePage(int page);
+
+	struct PairHash {
+		[[nodiscard]] size_t operator()(const std::pair<Location, Location>& p) const {
+			uint64_t h = p.first * 0x9E3779B97F4A7C15ULL + p.second;
+			return size_t(h ^ (h >> 32));
+		}
+	};
+	struct CallKey {
+		Location caller;   // function that contains the call
+		Location callSite; // the CALL instruction (or the interrupted one)
+		Location callee;
+		[[nodiscard]] bool operator==(const CallKey& other) const {
+			return (caller   == other.caller) &&
+			       (callSite == other.callSite) &&
+			       (callee   == other.callee);
+		}
+	};
+	struct CallKeyHash {
+		[[nodiscard]] size_t operator()(const CallKey& k) const {
+			uint64_t h = (k.caller * 0x9E3779B97F4A7C15ULL + k.callSite) *
+			             0x9E3779B97F4A7C15ULL + k.callee;
+			return size_t(h ^ (h >> 32));
+		}
+	};
+	struct Frame {
+		Location function;
+		Location callSite;
+		uint64_t startTicks;
+		word sp; // points to the return address
+	};
+	struct PageInfo {
+		MSXMemoryMapperInterface* mapper = nullptr;
+		Debuggable* romBlocks = nullptr;
+		bool valid = false;
+	};
+
+	[[nodiscard]] Location currentFunction() const {
+		return frames.empty() ? ROOT : frames.back().function;
+	}
+
+	/** Self cost, indexed by (function, instruction). */
+	hash_map<std::pair<Location, Location>, Cost, PairHash> selfCost;
+	/** Number of calls and inclusive cost per call edge. */
+	hash_map<CallKey, Cost, CallKeyHash> callCost;
+	std::vector<Frame> frames; // shadow stack
+
+	MSXCPUInterface* interface = nullptr;
+	PageInfo pages[4];
+
+	Location startLocation = 0;
+	uint64_t startTicks = 0;
+	word startSP = 0;
+	bool enabled = false;
+};
+
+} // namespace openmsx
+
+#endif
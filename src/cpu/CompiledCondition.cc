@@ -0,0 +1,670 @@
+#include "CompiledCondition.hh"
+#include "StringOp.hh"
+#include "one_of.hh"
+#include "unreachable.hh"
+#include <array>
+#include <cassert>
+#include <limits>
+
+namespace openmsx {
+
+using Op = CompiledCondition::Op;
+using Instr = CompiledCondition::Instr;
+
+// Thrown when (part of) the expression can't be handled natively.
+struct CantCompileCondition {};
+
+struct RegInfo {
+	std::string_view name;
+	unsigned index; // in the "CPU regs" debuggable
+	bool isWord;
+};
+static constexpr std::array<RegInfo, 40> regInfos = {{
+	{"A",    0, false}, {"F",    1, false}, {"B",    2, false}, {"C",    3, false},
+	{"D",    4, false}, {"E",    5, false}, {"H",    6, false}, {"L",    7, false},
+	{"A2",   8, false}, {"F2",   9, false}, {"B2",  10, false}, {"C2",  11, false},
+	{"D2",  12, false}, {"E2",  13, false}, {"H2",  14, false}, {"L2",  15, false},
+	{"IXH", 16, false}, {"IXL", 17, false}, {"IYH", 18, false}, {"IYL", 19, false},
+	{"PCH", 20, false}, {"PCL", 21, false}, {"SPH", 22, false}, {"SPL", 23, false},
+	{"I",   24, false}, {"R",   25, false}, {"IM",  26, false}, {"IFF", 27, false},
+	{"AF",   0, true }, {"BC",   2, true }, {"DE",   4, true }, {"HL",   6, true },
+	{"AF2",  8, true }, {"BC2", 10, true }, {"DE2", 12, true }, {"HL2", 14, true },
+	{"IX",  16, true }, {"IY",  18, true }, {"PC",  20, true }, {"SP",  22, true },
+}};
+
+struct PeekInfo {
+	std::string_view name;
+	CompiledCondition::PeekType type;
+};
+static constexpr std::array<PeekInfo, 13> peekInfos = {{
+	{"peek",       CompiledCondition::U8},
+	{"peek8",      CompiledCondition::U8},
+	{"peek_u8",    CompiledCondition::U8},
+	{"peek_s8",    CompiledCondition::S8},
+	{"peek16",     CompiledCondition::U16LE},
+	{"peek16_LE",  CompiledCondition::U16LE},
+	{"peek_u16",   CompiledCondition::U16LE},
+	{"peek_u16LE", CompiledCondition::U16LE},
+	{"peek16_BE",  CompiledCondition::U16BE},
+	{"peek_u16BE", CompiledCondition::U16BE},
+	{"peek_s16",   CompiledCondition::S16LE},
+	{"peek_s16LE", CompiledCondition::S16LE},
+	{"peek_s16BE", CompiledCondition::S16BE},
+}};
+
+// Parses (the supported subset of) a Tcl expression, using the same operator
+// precedence as Tcl, and emits the corresponding bytecode.
+class ConditionParser
+{
+public:
+	explicit ConditionParser(std::vector<Instr>& code_) : code(code_) {}
+
+	void parseExpression(std::string_view expression)
+	{
+		auto savedInput = input;
+		input = expression;
+		parseTernary();
+		skipSpace();
+		if (!input.empty()) throw CantCompileCondition();
+		input = savedInput;
+	}
+
+private:
+	static bool isSpace(char c)
+	{
+		return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+	}
+	void skipSpace()
+	{
+		while (!input.empty() && isSpace(input.front())) input.remove_prefix(1);
+	}
+	bool match(std::string_view token)
+	{
+		skipSpace();
+		if (!StringOp::startsWith(input, token)) return false;
+		input.remove_prefix(token.size());
+		return true;
+	}
+	// Like match(), but fail on a longer operator with the same prefix,
+	// e.g. '<' versus '<<' or '<='.
+	bool matchOp(std::string_view token, std::string_view notFollowedBy)
+	{
+		skipSpace();
+		if (!StringOp::startsWith(input, token)) return false;
+		if ((input.size() > token.size()) &&
+		    (notFollowedBy.find(input[token.size()]) != std::string_view::npos)) {
+			return false;
+		}
+		input.remove_prefix(token.size());
+		return true;
+	}
+
+	size_t emit(Op op, int64_t arg = 0)
+	{
+		switch (op) {
+		case Op::PUSH: case Op::REG8: case Op::REG16: case Op::IN_SLOT:
+			++depth;
+			break;
+		case Op::MUL: case Op::DIV: case Op::MOD: case Op::ADD: case Op::SUB:
+		case Op::SHL: case Op::SHR: case Op::LT: case Op::GT: case Op::LE:
+		case Op::GE: case Op::EQ: case Op::NE: case Op::BIT_AND:
+		case Op::BIT_XOR: case Op::BIT_OR:
+		case Op::AND_JUMP: case Op::OR_JUMP: case Op::JUMP_IF_ZERO:
+			// AND_JUMP/OR_JUMP: pop when not jumping, see evaluate()
+			--depth;
+			break;
+		default:
+			break;
+		}
+		if (depth > int(CompiledCondition::MAX_STACK)) throw CantCompileCondition();
+		code.push_back({op, arg});
+		return code.size() - 1;
+	}
+	void patchJump(size_t jump)
+	{
+		code[jump].arg = int64_t(code.size());
+	}
+
+	void parseTernary()
+	{
+		parseOr();
+		if (!match("?")) return;
+		auto jumpFalse = emit(Op::JUMP_IF_ZERO);
+		parseTernary();
+		if (!match(":")) throw CantCompileCondition();
+		auto jumpEnd = emit(Op::JUMP);
+		--depth; // only one of both branches is executed
+		patchJump(jumpFalse);
+		parseTernary();
+		patchJump(jumpEnd);
+	}
+	void parseOr()
+	{
+		parseAnd();
+		while (match("||")) {
+			auto jump = emit(Op::OR_JUMP);
+			parseAnd();
+			emit(Op::TO_BOOL);
+			patchJump(jump);
+		}
+	}
+	void parseAnd()
+	{
+		parseBitOr();
+		while (match("&&")) {
+			auto jump = emit(Op::AND_JUMP);
+			parseBitOr();
+			emit(Op::TO_BOOL);
+			patchJump(jump);
+		}
+	}
+	void parseBitOr()
+	{
+		parseBitXor();
+		while (matchOp("|", "|")) {
+			parseBitXor();
+			emit(Op::BIT_OR);
+		}
+	}
+	void parseBitXor()
+	{
+		parseBitAnd();
+		while (match("^")) {
+			parseBitAnd();
+			emit(Op::BIT_XOR);
+		}
+	}
+	void parseBitAnd()
+	{
+		parseEquality();
+		while (matchOp("&", "&")) {
+			parseEquality();
+			emit(Op::BIT_AND);
+		}
+	}
+	void parseEquality()
+	{
+		parseRelational();
+		while (true) {
+			if (match("==")) {
+				parseRelational();
+				emit(Op::EQ);
+			} else if (match("!=")) {
+				parseRelational();
+				emit(Op::NE);
+			} else {
+				return;
+			}
+		}
+	}
+	void parseRelational()
+	{
+		parseShift();
+		while (true) {
+			if (match("<=")) {
+				parseShift();
+				emit(Op::LE);
+			} else if (match(">=")) {
+				parseShift();
+				emit(Op::GE);
+			} else if (matchOp("<", "<")) {
+				parseShift();
+				emit(Op::LT);
+			} else if (matchOp(">", ">")) {
+				parseShift();
+				emit(Op::GT);
+			} else {
+				return;
+			}
+		}
+	}
+	void parseShift()
+	{
+		parseAdditive();
+		while (true) {
+			if (match("<<")) {
+				parseAdditive();
+				emit(Op::SHL);
+			} else if (match(">>")) {
+				parseAdditive();
+				emit(Op::SHR);
+			} else {
+				return;
+			}
+		}
+	}
+	void parseAdditive()
+	{
+		parseMultiplicative();
+		while (true) {
+			if (match("+")) {
+				parseMultiplicative();
+				emit(Op::ADD);
+			} else if (match("-")) {
+				parseMultiplicative();
+				emit(Op::SUB);
+			} else {
+				return;
+			}
+		}
+	}
+	void parseMultiplicative()
+	{
+		parseUnary();
+		while (true) {
+			if (matchOp("*", "*")) {
+				parseUnary();
+				emit(Op::MUL);
+			} else if (match("/")) {
+				parseUnary();
+				emit(Op::DIV);
+			} else if (match("%")) {
+				parseUnary();
+				emit(Op::MOD);
+			} else {
+				return;
+			}
+		}
+	}
+	void parseUnary()
+	{
+		if (match("-")) {
+			parseUnary();
+			emit(Op::NEG);
+		} else if (match("+")) {
+			parseUnary();
+		} else if (match("~")) {
+			parseUnary();
+			emit(Op::BIT_NOT);
+		} else if (matchOp("!", "=")) {
+			parseUnary();
+			emit(Op::NOT);
+		} else {
+			parsePrimary();
+		}
+		skipSpace();
+		if (StringOp::startsWith(input, "**")) throw CantCompileCondition();
+	}
+	void parsePrimary()
+	{
+		skipSpace();
+		if (input.empty()) throw CantCompileCondition();
+		char c = input.front();
+		if (c == '(') {
+			input.remove_prefix(1);
+			parseTernary();
+			if (!match(")")) throw CantCompileCondition();
+		} else if (c == '[') {
+			parseCommand();
+		} else if (('0' <= c) && (c <= '9')) {
+			auto len = numberLength(input);
+			emit(Op::PUSH, parseNumber(input.substr(0, len)));
+			input.remove_prefix(len);
+		} else {
+			// variables, strings, functions, ...
+			throw CantCompileCondition();
+		}
+	}
+
+	static size_t numberLength(std::string_view s)
+	{
+		size_t len = 0;
+		while ((len < s.size()) &&
+		       ((('0' <= s[len]) && (s[len] <= '9')) ||
+		        (('a' <= s[len]) && (s[len] <= 'z')) ||
+		        (('A' <= s[len]) && (s[len] <= 'Z')) ||
+		        (s[len] == '.'))) {
+			++len;
+		}
+		return len;
+	}
+	// Only accepts integers that Tcl interprets the same way in all
+	// versions (so e.g. not '010', that's octal in Tcl 8, but decimal
+	// in Tcl 9).
+	static int64_t parseNumber(std::string_view s)
+	{
+		unsigned base = 10;
+		if ((s.size() > 1) && (s[0] == '0')) {
+			switch (s[1]) {
+				case 'x': case 'X': base = 16; break;
+				case 'b': case 'B': base =  2; break;
+				case 'o': case 'O': base =  8; break;
+				default: throw CantCompileCondition();
+			}
+			s.remove_prefix(2);
+		}
+		if (s.empty()) throw CantCompileCondition();
+		uint64_t result = 0;
+		for (char c : s) {
+			unsigned digit = (('0' <= c) && (c <= '9')) ? (c - '0')
+			               : (('a' <= c) && (c <= 'f')) ? (c - 'a' + 10)
+			               : (('A' <= c) && (c <= 'F')) ? (c - 'A' + 10)
+			               : 99;
+			if (digit >= base) throw CantCompileCondition();
+			if (result > (uint64_t(std::numeric_limits<int64_t>::max()) - digit) / base) {
+				throw CantCompileCondition();
+			}
+			result = result * base + digit;
+		}
+		return int64_t(result);
+	}
+
+	// A word of a Tcl command. Either a literal, or (when 'literal' is
+	// empty) a nested command for which the code is already emitted.
+	struct Word {
+		std::string_view literal;
+		bool isLiteral;
+	};
+	Word parseWord()
+	{
+		assert(!input.empty());
+		char c = input.front();
+		if (c == '[') {
+			parseCommand();
+			return {{}, false};
+		}
+		if (c == '{') {
+			int level = 0;
+			for (size_t i = 0; i < input.size(); ++i) {
+				if (input[i] == '\\') throw CantCompileCondition();
+				if (input[i] == '{') ++level;
+				if ((input[i] == '}') && (--level == 0)) {
+					auto result = input.substr(1, i - 1);
+					input.remove_prefix(i + 1);
+					return {result, true};
+				}
+			}
+			throw CantCompileCondition();
+		}
+		size_t len = 0;
+		while ((len < input.size()) && !isSpace(input[len]) && (input[len] != ']')) {
+			if (std::string_view("[$\\\"{};").find(input[len]) != std::string_view::npos) {
+				throw CantCompileCondition();
+			}
+			++len;
+		}
+		auto result = input.substr(0, len);
+		input.remove_prefix(len);
+		return {result, true};
+	}
+	// The words of the command, up to (and including) the closing ']'.
+	std::vector<Word> parseWords()
+	{
+		std::vector<Word> words;
+		while (true) {
+			while (!input.empty() && ((input.front() == ' ') || (input.front() == '\t'))) {
+				input.remove_prefix(1);
+			}
+			// (also) fail on newlines, those separate commands
+			if (input.empty() || isSpace(input.front())) throw CantCompileCondition();
+			if (input.front() == ']') {
+				input.remove_prefix(1);
+				return words;
+			}
+			words.push_back(parseWord());
+			if (!input.empty() && !isSpace(input.front()) && (input.front() != ']')) {
+				// e.g. '[peek 0x[reg A]]'
+				throw CantCompileCondition();
+			}
+		}
+	}
+	// Value of an argument that's used as a number.
+	void emitNumber(const Word& w)
+	{
+		if (!w.isLiteral) return; // code already emitted
+		auto s = w.literal;
+		while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+		while (!s.empty() && isSpace(s.back()))  s.remove_suffix(1);
+		if (s.empty() || !(('0' <= s[0]) && (s[0] <= '9')) ||
+		    (numberLength(s) != s.size())) {
+			throw CantCompileCondition();
+		}
+		emit(Op::PUSH, parseNumber(s));
+	}
+	// Slot number (0..3) or 'X'.
+	static int parseSlot(const Word& w)
+	{
+		if (!w.isLiteral) throw CantCompileCondition();
+		if (w.literal == "X") return -1;
+		if ((w.literal.size() == 1) &&
+		    ('0' <= w.literal[0]) && (w.literal[0] <= '3')) {
+			return w.literal[0] - '0';
+		}
+		throw CantCompileCondition();
+	}
+
+	void parseCommand()
+	{
+		assert(input.front() == '[');
+		input.remove_prefix(1);
+		auto words = parseWords();
+		if (words.empty() || !words[0].isLiteral) throw CantCompileCondition();
+		auto cmd = words[0].literal;
+		if (cmd == "expr") {
+			if ((words.size() != 2) || !words[1].isLiteral) throw CantCompileCondition();
+			parseExpression(words[1].literal);
+		} else if (cmd == "reg") {
+			if ((words.size() != 2) || !words[1].isLiteral) throw CantCompileCondition();
+			for (const auto& info : regInfos) {
+				if (StringOp::casecmp()(info.name, words[1].literal)) {
+					emit(info.isWord ? Op::REG16 : Op::REG8, info.index);
+					return;
+				}
+			}
+			throw CantCompileCondition(); // let Tcl produce the error
+		} else if (cmd == "pc_in_slot") {
+			if ((words.size() < 2) || (words.size() > 4)) throw CantCompileCondition();
+			int ps = parseSlot(words[1]);
+			int ss = (words.size() > 2) ? parseSlot(words[2]) : -1;
+			if ((words.size() > 3) && (parseSlot(words[3]) != -1)) {
+				// mapper block check not supported
+				throw CantCompileCondition();
+			}
+			emit(Op::IN_SLOT, (ps + 1) + 16 * (ss + 1));
+		} else {
+			for (const auto& info : peekInfos) {
+				if (info.name == cmd) {
+					if (words.size() != 2) throw CantCompileCondition();
+					// Nested commands are already emitted at
+					// this point, so the argument is on top
+					// of the stack.
+					emitNumber(words[1]);
+					emit(Op::PEEK, info.type);
+					return;
+				}
+			}
+			throw CantCompileCondition();
+		}
+	}
+
+private:
+	std::vector<Instr>& code;
+	std::string_view input;
+	int depth = 0;
+};
+
+// Tcl uses arbitrary precision integers, we give up (and let Tcl handle
+// it) when the result doesn't fit in 64 bit. These checks only use 64 bit
+// arithmetic (not all compilers have a 128 bit integer type).
+constexpr int64_t MIN_INT64 = std::numeric_limits<int64_t>::min();
+constexpr int64_t MAX_INT64 = std::numeric_limits<int64_t>::max();
+
+[[nodiscard]] static inline std::optional<int64_t> checkedAdd(int64_t a, int64_t b)
+{
+	if ((b > 0) ? (a > MAX_INT64 - b) : (a < MIN_INT64 - b)) return {};
+	return a + b;
+}
+
+[[nodiscard]] static inline std::optional<int64_t> checkedSub(int64_t a, int64_t b)
+{
+	if ((b < 0) ? (a > MAX_INT64 + b) : (a < MIN_INT64 + b)) return {};
+	return a - b;
+}
+
+[[nodiscard]] static inline std::optional<int64_t> checkedMul(int64_t a, int64_t b)
+{
+	if ((a == 0) || (b == 0)) return 0;
+	bool overflow = (a > 0)
+		? ((b > 0) ? (a > MAX_INT64 / b) : (b < MIN_INT64 / a))
+		: ((b > 0) ? (a < MIN_INT64 / b) : (b < MAX_INT64 / a));
+	if (overflow) return {};
+	return a * b;
+}
+
+[[nodiscard]] static inline std::optional<int64_t> checkedShl(int64_t a, int64_t b)
+{
+	if ((b < 0) || (b >= 64)) return {};
+	// The bits that are shifted out must all equal the sign bit.
+	if ((a < (MIN_INT64 >> b)) || (a > (MAX_INT64 >> b))) return {};
+	return int64_t(uint64_t(a) << b);
+}
+
+std::shared_ptr<const CompiledCondition> CompiledCondition::compile(
+	std::string_view expression)
+{
+	auto result = std::make_shared<CompiledCondition>();
+	try {
+		ConditionParser(result->code).parseExpression(expression);
+	} catch (CantCompileCondition&) {
+		return nullptr;
+	}
+	return result;
+}
+
+std::optional<bool> CompiledCondition::evaluate(Context& context) const
+{
+	std::array<int64_t, MAX_STACK> stack;
+	int64_t* sp = stack.data(); // points to top element
+	--sp; // stack is empty
+
+	auto peek = [&](int64_t address) -> std::optional<int64_t> {
+		// Same check as in 'debug read memory'.
+		if ((address < 0) || (address >= 0x10000)) return {};
+		return context.peekMem(word(address));
+	};
+
+	const Instr* ip = code.data();
+	const Instr* end = ip + code.size();
+	while (ip != end) {
+		const Instr& instr = *ip++;
+		switch (instr.op) {
+		case Op::PUSH:
+			*++sp = instr.arg;
+			break;
+		case Op::REG8:
+			*++sp = context.readRegister(unsigned(instr.arg));
+			break;
+		case Op::REG16:
+			*++sp = 256 * context.readRegister(unsigned(instr.arg)) +
+			              context.readRegister(unsigned(instr.arg + 1));
+			break;
+		case Op::PEEK: {
+			auto b0 = peek(*sp);
+			if (!b0) return {};
+			int64_t result = *b0;
+			if (instr.arg >= U16LE) {
+				auto b1 = peek(*sp + 1);
+				if (!b1) return {};
+				result = (instr.arg == one_of(U16BE, S16BE))
+				       ? 256 * *b0 + *b1
+				       : 256 * *b1 + *b0;
+				if ((instr.arg == one_of(S16LE, S16BE)) && (result >= 32768)) {
+					result -= 65536;
+				}
+			} else if ((instr.arg == S8) && (result >= 128)) {
+				result -= 256;
+			}
+			*sp = result;
+			break;
+		}
+		case Op::IN_SLOT:
+			*++sp = context.isPCInSlot(int(instr.arg % 16) - 1,
+			                           int(instr.arg / 16) - 1);
+			break;
+		case Op::NEG:
+			if (*sp == std::numeric_limits<int64_t>::min()) return {};
+			*sp = -*sp;
+			break;
+		case Op::NOT:
+			*sp = *sp == 0;
+			break;
+		case Op::BIT_NOT:
+			*sp = ~*sp;
+			break;
+		case Op::TO_BOOL:
+			*sp = *sp != 0;
+			break;
+		case Op::AND_JUMP:
+			if (*sp == 0) {
+				ip = code.data() + instr.arg;
+			} else {
+				--sp;
+			}
+			break;
+		case Op::OR_JUMP:
+			if (*sp != 0) {
+				*sp = 1;
+				ip = code.data() + instr.arg;
+			} else {
+				--sp;
+			}
+			break;
+		case Op::JUMP_IF_ZERO:
+			if (*sp-- == 0) ip = code.data() + instr.arg;
+			break;
+		case Op::JUMP:
+			ip = code.data() + instr.arg;
+			break;
+		default: {
+			// binary operators
+			int64_t b = *sp--;
+			int64_t a = *sp;
+			std::optional<int64_t> r;
+			switch (instr.op) {
+			case Op::MUL: r = checkedMul(a, b); break;
+			case Op::ADD: r = checkedAdd(a, b); break;
+			case Op::SUB: r = checkedSub(a, b); break;
+			case Op::DIV: case Op::MOD: {
+				// Tcl rounds towards negative infinity.
+				if (b == 0) return {};
+				if (b == -1) {
+					// Avoid 'INT64_MIN / -1' (overflows).
+					r = (instr.op == Op::DIV) ? checkedSub(0, a) : 0;
+					break;
+				}
+				int64_t q = a / b;
+				int64_t m = a % b;
+				if ((m != 0) && ((m < 0) != (b < 0))) {
+					--q;
+					m += b;
+				}
+				r = (instr.op == Op::DIV) ? q : m;
+				break;
+			}
+			case Op::SHL: r = checkedShl(a, b); break;
+			case Op::SHR:
+				if (b < 0) return {};
+				r = a >> std::min<int64_t>(b, 63);
+				break;
+			case Op::LT: r = a <  b; break;
+			case Op::GT: r = a >  b; break;
+			case Op::LE: r = a <= b; break;
+			case Op::GE: r = a >= b; break;
+			case Op::EQ: r = a == b; break;
+			case Op::NE: r = a != b; break;
+			case Op::BIT_AND: r = a & b; break;
+			case Op::BIT_XOR: r = a ^ b; break;
+			case Op::BIT_OR:  r = a | b; break;
+			default: UNREACHABLE;
+			}
+			if (!r) return {};
+			*sp = *r;
+			break;
+		}
+		}
+	}
+	assert(sp == stack.data());
+	return *sp != 0;
+}
+
+} // namespace openmsx
@@ -0,0 +1,82 @@
+#ifndef COMPILEDCONDITION_HH
+#define COMPILEDCONDITION_HH
+
+#include "openmsx.hh"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace openmsx {
+
+/** A breakpoint or debug condition, compiled so that it can be evaluated
+  * without going through the Tcl interpreter.
+  *
+  * Conditions are Tcl expressions. Evaluating those via Tcl after every
+  * emulated instruction is very slow. This class handles the most common
+  * subset natively:
+  *  - integer literals and parentheses
+  *  - the Tcl arithmetic, shift, bitwise, comparison, logical and ?:
+  *    operators (not '**', string operators or floating point)
+  *  - the commands: [reg <name>], [peek <addr>] (and its 8/16 bit,
+  *    signed/unsigned, little/big endian variants, but without the
+  *    optional debuggable argument), [pc_in_slot <ps> [<ss>]] and
+  *    [expr {...}]
+  * For anything else (e.g. Tcl variables) compile() fails and the caller
+  * should keep using the Tcl interpreter. The procs 'reg', 'peek', ... are
+  * assumed to have their standard definitions (see share/scripts).
+  *
+  * The expression is translated to a small stack based bytecode.
+  */
+class CompiledCondition
+{
+public:
+	/** The machine state that a condition can query. */
+	class Context
+	{
+	public:
+		/** Same as reading from the "CPU regs" debuggable. */
+		[[nodiscard]] virtual byte readRegister(unsigned index) = 0;
+		/** Same as reading from the "memory" debuggable. */
+		[[nodiscard]] virtual byte peekMem(word address) = 0;
+		/** Same as the 'pc_in_slot' proc, -1 means 'X' (don't care). */
+		[[nodiscard]] virtual bool isPCInSlot(int ps, int ss) = 0;
+
+	protected:
+		~Context() = default;
+	};
+
+	/** Returns nullptr if the expression can't be handled natively. */
+	[[nodiscard]] static std::shared_ptr<const CompiledCondition> compile(
+		std::string_view expression);
+
+	/** Returns std::nullopt when the evaluation results in an error (e.g.
+	  * a division by zero or an invalid address), or in a result that
+	  * doesn't fit in 64 bit. The caller should then evaluate the condition
+	  * via Tcl, so that it gets handled in the usual way. */
+	[[nodiscard]] std::optional<bool> evaluate(Context& context) const;
+
+public:
+	enum class Op : byte {
+		PUSH, REG8, REG16, PEEK, IN_SLOT,
+		NEG, NOT, BIT_NOT, TO_BOOL,
+		MUL, DIV, MOD, ADD, SUB, SHL, SHR,
+		LT, GT, LE, GE, EQ, NE,
+		BIT_AND, BIT_XOR, BIT_OR,
+		AND_JUMP, OR_JUMP, JUMP_IF_ZERO, JUMP,
+	};
+	enum PeekType { U8, S8, U16LE, S16LE, U16BE, S16BE };
+	struct Instr {
+		Op op;
+		int64_t arg;
+	};
+	static constexpr unsigned MAX_STACK = 32;
+
+private:
+	std::vector<Instr> code;
+};
+
+} // namespace openmsx
+
+#endif
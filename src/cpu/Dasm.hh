@@ -3,6 +3,7 @@
 
 #include "EmuTime.hh"
 #include "openmsx.hh"
+#include "span.hh"
 #include <string>
 
 namespace openmsx {
@@ -21,6 +22,16 @@ class MSXCPUInterface;
 unsigned dasm(const MSXCPUInterface& interf, word pc, byte buf[4],
               std::string& dest, EmuTime::param time);
 
+/** Same as above, but the instruction bytes are taken from the given buffer
+  * instead of from memory (missing bytes are taken as zero). */
+unsigned dasm(span<const byte> opcode, word pc, std::string& dest);
+
+/** Length (in bytes) of the instruction that starts with the given two
+  * bytes. This is the same length as returned by dasm(), except that the
+  * DD/FD CB prefixed instructions are always 4 bytes long (that's how the
+  * CPU executes them). */
+[[nodiscard]] unsigned instructionLength(byte op0, byte op1);
+
 } // namespace openmsx
 
 #endif
@@ -0,0 +1,231 @@
+#include "InstructionTrace.hh"
+#include "CPURegs.hh"
+#include "endian.hh"
+#include "ranges.hh"
+#include "xrange.hh"
+#include <cassert>
+
+namespace openmsx {
+
+// flags byte
+static constexpr byte LENGTH_MASK = 0x07;
+static constexpr unsigned KIND_SHIFT = 3;
+static constexpr byte KIND_MASK = 0x18;
+static constexpr byte HAS_PC = 0x20;
+static constexpr byte HAS_REGS = 0x40;
+static constexpr byte HAS_ACCESSES = 0x80;
+
+// flags + ticks + PC + opcode + mask + registers + count + mask + accesses
+static constexpr size_t MAX_RECORD_SIZE = 1 + 10 + 2 + 4 + 2 + 2 * InstructionTrace::NUM_REGS +
+                                          2 + 3 * InstructionTrace::MAX_ACCESSES;
+
+void InstructionTrace::setSize(size_t bytes)
+{
+	numChunks = (bytes + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	buffer.resize(numChunks * CHUNK_SIZE);
+	clear();
+}
+
+void InstructionTrace::clear()
+{
+	firstChunk = 0;
+	numUsedChunks = 0;
+	chunk = nullptr;
+	pos = 0;
+}
+
+void InstructionTrace::startChunk(uint64_t ticks)
+{
+	assert(numChunks);
+	if (numUsedChunks == numChunks) {
+		// drop the oldest chunk
+		firstChunk = (firstChunk + 1) % numChunks;
+	} else {
+		++numUsedChunks;
+	}
+	chunk = buffer.data() + ((firstChunk + numUsedChunks - 1) % numChunks) * CHUNK_SIZE;
+	Endian::write_UA_L16(chunk + 0, HEADER_SIZE);
+	Endian::write_UA_L64(chunk + 2, ticks);
+	for (auto i : xrange(NUM_REGS)) {
+		Endian::write_UA_L16(chunk + 10 + 2 * i, regs[i]);
+	}
+	pos = HEADER_SIZE;
+	lastTicks = ticks;
+}
+
+void InstructionTrace::begin(word pc, span<const byte> opcode, Kind kind, uint64_t ticks)
+{
+	assert(opcode.size() <= 4);
+	assert(!pending);
+	pending = true;
+	numAccesses = 0;
+	startPC = pc;
+	startKind = kind;
+	startLength = byte(opcode.size());
+	ranges::copy(opcode, startOpcode.begin());
+	startTicks = ticks;
+}
+
+void InstructionTrace::end(const CPURegs& cpuRegs)
+{
+	assert(pending);
+	pending = false;
+	Regs newRegs = {
+		word(cpuRegs.getAF()),  word(cpuRegs.getBC()),  word(cpuRegs.getDE()),
+		word(cpuRegs.getHL()),  word(cpuRegs.getIX()),  word(cpuRegs.getIY()),
+		word(cpuRegs.getSP()),  word(cpuRegs.getAF2()), word(cpuRegs.getBC2()),
+		word(cpuRegs.getDE2()), word(cpuRegs.getHL2()),
+	};
+
+	// The first record in a chunk always has an explicit PC. Also start a
+	// new chunk when time went backwards, that happens when switching
+	// between Z80 and R800 (both have their own cycle counter).
+	bool explicitPC = startPC != expectedPC;
+	if (!chunk || (pos + MAX_RECORD_SIZE > CHUNK_SIZE) || (startTicks < lastTicks)) {
+		startChunk(startTicks);
+		explicitPC = true;
+	}
+
+	byte* p = chunk + pos;
+	byte& flags = *p++;
+	flags = startLength | byte(unsigned(startKind) << KIND_SHIFT);
+
+	uint64_t delta = startTicks - lastTicks;
+	do {
+		byte b = delta & 0x7F;
+		delta >>= 7;
+		*p++ = b | (delta ? 0x80 : 0x00);
+	} while (delta);
+
+	if (explicitPC) {
+		flags |= HAS_PC;
+		Endian::write_UA_L16(p, startPC);
+		p += 2;
+	}
+	for (auto i : xrange(startLength)) *p++ = startOpcode[i];
+
+	unsigned mask = 0;
+	for (auto i : xrange(NUM_REGS)) {
+		if (newRegs[i] != regs[i]) mask |= 1 << i;
+	}
+	if (mask) {
+		flags |= HAS_REGS;
+		Endian::write_UA_L16(p, mask);
+		p += 2;
+		for (auto i : xrange(NUM_REGS)) {
+			if (mask & (1 << i)) {
+				Endian::write_UA_L16(p, newRegs[i]);
+				p += 2;
+			}
+		}
+	}
+
+	if (numAccesses) {
+		flags |= HAS_ACCESSES;
+		*p++ = byte(numAccesses);
+		byte& writeMask = *p++;
+		writeMask = 0;
+		for (auto i : xrange(numAccesses)) {
+			const auto& a = accesses[i];
+			if (a.write) writeMask |= 1 << i;
+			Endian::write_UA_L16(p, a.address);
+			p[2] = a.value;
+			p += 3;
+		}
+	}
+
+	pos = p - chunk;
+	assert(pos <= CHUNK_SIZE);
+	Endian::write_UA_L16(chunk, pos);
+
+	regs = newRegs;
+	lastTicks = startTicks;
+	expectedPC = (startKind == Kind::INSTRUCTION) ? word(startPC + startLength)
+	                                              : startPC;
+}
+
+byte InstructionTrace::readRaw(size_t address) const
+{
+	assert(address < getSize());
+	size_t n = address / CHUNK_SIZE;
+	if (n >= numUsedChunks) return 0;
+	return getChunk(n)[address % CHUNK_SIZE];
+}
+
+
+// class InstructionTrace::Reader
+
+InstructionTrace::Reader::Reader(const InstructionTrace& trace_)
+	: trace(trace_)
+{
+}
+
+bool InstructionTrace::Reader::next(Entry& entry)
+{
+	while (pos == used) {
+		// go to the next chunk
+		if (chunk == trace.numUsedChunks) return false;
+		const byte* c = trace.getChunk(chunk++);
+		used = Endian::read_UA_L16(c + 0);
+		state.ticks = Endian::read_UA_L64(c + 2);
+		for (auto i : xrange(NUM_REGS)) {
+			state.regs[i] = Endian::read_UA_L16(c + 10 + 2 * i);
+		}
+		pos = HEADER_SIZE;
+	}
+
+	const byte* c = trace.getChunk(chunk - 1);
+	const byte* p = c + pos;
+	byte flags = *p++;
+
+	uint64_t delta = 0;
+	unsigned shift = 0;
+	byte b;
+	do {
+		b = *p++;
+		delta |= uint64_t(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	state.ticks += delta;
+
+	if (flags & HAS_PC) {
+		state.pc = Endian::read_UA_L16(p);
+		p += 2;
+	} else {
+		// previous instruction (in this chunk) + its length
+		if (state.kind == Kind::INSTRUCTION) state.pc += state.length;
+	}
+	state.kind = Kind((flags & KIND_MASK) >> KIND_SHIFT);
+	state.length = flags & LENGTH_MASK;
+	for (auto i : xrange(state.length)) state.opcode[i] = *p++;
+
+	if (flags & HAS_REGS) {
+		unsigned mask = Endian::read_UA_L16(p);
+		p += 2;
+		for (auto i : xrange(NUM_REGS)) {
+			if (mask & (1 << i)) {
+				state.regs[i] = Endian::read_UA_L16(p);
+				p += 2;
+			}
+		}
+	}
+
+	state.numAccesses = 0;
+	if (flags & HAS_ACCESSES) {
+		state.numAccesses = *p++;
+		byte writeMask = *p++;
+		for (auto i : xrange(state.numAccesses)) {
+			auto& a = state.accesses[i];
+			a.address = Endian::read_UA_L16(p);
+			a.value = p[2];
+			a.write = writeMask & (1 << i);
+			p += 3;
+		}
+	}
+
+	pos = p - c;
+	entry = state;
+	return true;
+}
+
+} // namespace openmsx
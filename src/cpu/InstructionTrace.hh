@@ -0,0 +1,162 @@
+#ifndef INSTRUCTIONTRACE_HH
+#define INSTRUCTIONTRACE_HH
+
+#include "MemBuffer.hh"
+#include "openmsx.hh"
+#include "span.hh"
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace openmsx {
+
+class CPURegs;
+
+/** Records the most recently executed CPU instructions in a fixed size ring
+  * buffer, for post-mortem analysis.
+  *
+  * Per instruction the start time (in CPU cycles), the PC, the opcode
+  * bytes and the registers that changed are stored. To keep this compact
+  * everything is delta encoded:
+  *  - The buffer is split in chunks of CHUNK_SIZE bytes. Each chunk starts
+  *    with a header that contains the number of used bytes, the absolute
+  *    time and all registers. So decoding can start at any chunk, and when
+  *    the buffer is full the oldest chunk is dropped as a whole.
+  *  - Each record contains:
+  *     - a flags byte: bits 0-2 opcode length (0 for an interrupt),
+  *       bits 3-4 the kind (see Kind), bit 5 PC follows, bit 6 register
+  *       mask follows, bit 7 memory accesses follow
+  *     - the number of cycles since the previous record (LEB128)
+  *     - only when it's not the PC of the previous instruction plus its
+  *       length: the PC (2 bytes)
+  *     - the opcode bytes
+  *     - only when some registers changed: a 2-byte mask (bit n set means
+  *       register n changed, see REG_NAMES), followed by the new values
+  *     - only when the instruction accessed memory: the number of accesses
+  *       (1 byte), a mask (1 byte, bit n set means access n was a write)
+  *       and per access the address (2 bytes) and the value (1 byte)
+  *  - Multi-byte values are stored little endian.
+  * Typically this takes 4 to 8 bytes per instruction, plus 3 bytes per
+  * memory access.
+  *
+  * The memory accesses are reported by the same CPU hooks that collect
+  * the memory coverage (see MemoryCoverage), so also accesses via the
+  * cache lines are seen. Opcode and operand fetches are not recorded as
+  * accesses (those bytes are already stored as the opcode), and only the
+  * first MAX_ACCESSES accesses of an instruction are kept.
+  */
+class InstructionTrace
+{
+public:
+	static constexpr unsigned NUM_REGS = 11;
+	using Regs = std::array<word, NUM_REGS>;
+	static constexpr std::array<std::string_view, NUM_REGS> REG_NAMES = {
+		"AF", "BC", "DE", "HL", "IX", "IY", "SP",
+		"AF'", "BC'", "DE'", "HL'",
+	};
+	static constexpr size_t CHUNK_SIZE = 4096;
+	static constexpr size_t HEADER_SIZE = 2 + 8 + 2 * NUM_REGS;
+	static constexpr unsigned MAX_ACCESSES = 8;
+
+	enum class Kind : byte {
+		INSTRUCTION, // executed an instruction
+		IRQ,         // accepted a maskable interrupt
+		NMI,         // accepted a non-maskable interrupt
+	};
+
+	struct Access {
+		word address;
+		byte value;
+		bool write;
+	};
+
+	struct Entry {
+		uint64_t ticks; // at the start of the instruction
+		word pc;
+		Kind kind;
+		byte length; // of the opcode
+		std::array<byte, 4> opcode;
+		Regs regs; // after the instruction
+		byte numAccesses;
+		std::array<Access, MAX_ACCESSES> accesses; // in execution order
+	};
+
+	/** Iterates over the recorded entries, oldest first. */
+	class Reader
+	{
+	public:
+		explicit Reader(const InstructionTrace& trace);
+		/** Returns false when there are no more entries. */
+		[[nodiscard]] bool next(Entry& entry);
+
+	private:
+		const InstructionTrace& trace;
+		size_t chunk = 0; // number of chunks already started
+		size_t pos = 0;   // position in the current chunk
+		size_t used = 0;  // number of used bytes in the current chunk
+		Entry state = {};
+	};
+
+	/** (Re)allocate the buffer, this discards all recorded data. The size
+	  * is rounded up to a multiple of CHUNK_SIZE. */
+	void setSize(size_t bytes);
+	[[nodiscard]] size_t getSize() const { return numChunks * CHUNK_SIZE; }
+
+	void setEnabled(bool enabled_) { enabled = enabled_; }
+	[[nodiscard]] bool isEnabled() const { return enabled && numChunks; }
+
+	/** Discard all recorded data. */
+	void clear();
+
+	/** Called right before executing an instruction (or accepting an
+	  * interrupt, then 'opcode' is empty). */
+	void begin(word pc, span<const byte> opcode, Kind kind, uint64_t ticks);
+	/** Called for each memory access of that instruction. */
+	void access(bool write, word address, byte value)
+	{
+		if (pending && (numAccesses < MAX_ACCESSES)) {
+			accesses[numAccesses++] = {address, value, write};
+		}
+	}
+	/** Called right after that instruction. */
+	void end(const CPURegs& cpuRegs);
+	/** Is there a begin() without a matching end()? */
+	[[nodiscard]] bool isPending() const { return pending; }
+
+	/** The raw buffer, oldest chunk first. Unused chunks read as zero. */
+	[[nodiscard]] byte readRaw(size_t address) const;
+
+private:
+	[[nodiscard]] const byte* getChunk(size_t n) const {
+		return buffer.data() + ((firstChunk + n) % numChunks) * CHUNK_SIZE;
+	}
+	void startChunk(uint64_t ticks);
+
+	MemBuffer<byte> buffer;
+	size_t numChunks = 0;
+	size_t firstChunk = 0;     // oldest chunk
+	size_t numUsedChunks = 0;
+	byte* chunk = nullptr;     // current chunk, nullptr if none
+	size_t pos = 0;            // write position in current chunk
+
+	// state after the previous record
+	Regs regs = {};
+	uint64_t lastTicks = 0;
+	word expectedPC = 0;
+
+	// pending record (between begin() and end())
+	uint64_t startTicks = 0;
+	word startPC = 0;
+	Kind startKind = Kind::INSTRUCTION;
+	byte startLength = 0;
+	std::array<byte, 4> startOpcode = {};
+	unsigned numAccesses = 0;
+	std::array<Access, MAX_ACCESSES> accesses;
+	bool pending = false;
+
+	bool enabled = false;
+};
+
+} // namespace openmsx
+
+#endif
@@ -26,16 +26,20 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 	, traceSetting(
 		motherboard.getCommandController(), "cputrace",
 		"CPU tracing on/off", false, Setting::DONT_SAVE)
+	, blockCacheSetting(
+		motherboard.getCommandController(), "z80_block_cache",
+		"Skip idle loops on the Z80 by using pre-decoded code blocks "
+		"(timing remains exact)", false)
 	, diHaltCallback(
 		motherboard.getCommandController(), "di_halt_callback",
 		"Tcl proc called when the CPU executed a DI/HALT sequence")
 	, z80(std::make_unique<CPUCore<Z80TYPE>>(
 		motherboard, "z80", traceSetting,
-		diHaltCallback, EmuTime::zero()))
+		diHaltCallback, profiler, instructionTrace, EmuTime::zero()))
 	, r800(motherboard.isTurboR()
 		? std::make_unique<CPUCore<R800TYPE>>(
 			motherboard, "r800", traceSetting,
-			diHaltCallback, EmuTime::zero())
+			diHaltCallback, profiler, instructionTrace, EmuTime::zero())
 		: nullptr)
 	, timeInfo(motherboard.getMachineInfoCommand())
 	, z80FreqInfo(motherboard.getMachineInfoCommand(), "z80_freq", *z80)
@@ -44,6 +48,7 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 			motherboard.getMachineInfoCommand(), "r800_freq", *r800)
 		: nullptr)
 	, debuggable(motherboard_)
+	, traceDebuggable(motherboard_.getDebugger())
 	, reference(EmuTime::zero())
 {
 	z80Active = true; // setActiveCPU(CPU_Z80);
@@ -52,6 +57,8 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 	motherboard.getDebugger().setCPU(this);
 	motherboard.getScheduler().setCPU(this);
 	traceSetting.attach(*this);
+	blockCacheSetting.attach(*this);
+	z80->setBlockCacheEnabled(blockCacheSetting.getBoolean());
 
 	z80->freqLocked.attach(*this);
 	z80->freqValue.attach(*this);
@@ -65,6 +72,7 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 MSXCPU::~MSXCPU()
 {
 	traceSetting.detach(*this);
+	blockCacheSetting.detach(*this);
 	z80->freqLocked.detach(*this);
 	z80->freqValue.detach(*this);
 	if (r800) {
@@ -78,6 +86,7 @@ MSXCPU::~MSXCPU()
 void MSXCPU::setInterface(MSXCPUInterface* interface_)
 {
 	interface = interface_;
+	profiler.setInterface(interface);
 	          z80 ->setInterface(interface);
 	if (r800) r800->setInterface(interface);
 }
@@ -160,6 +169,19 @@ void MSXCPU::invalidateMemCacheSlot()
 		ranges::fill(slotReadLines[i], nullptr);
 		ranges::fill(slotWriteLines[i], nullptr);
 	}
+	ranges::fill(pageGeneration, 0);
+	for (auto& g : slotGeneration) ranges::fill(g, 0);
+}
+
+void MSXCPU::validateSlotPage(unsigned slot, unsigned page)
+{
+	if (slotGeneration[slot][page] == pageGeneration[page]) return;
+	slotGeneration[slot][page] = pageGeneration[page];
+
+	unsigned first = page * (0x4000 / CacheLine::SIZE);
+	unsigned num = 0x4000 / CacheLine::SIZE;
+	std::fill_n(slotReadLines [slot] + first, num, nullptr);
+	std::fill_n(slotWriteLines[slot] + first, num, nullptr);
 }
 
 void MSXCPU::updateVisiblePage(byte page, byte primarySlot, byte secondarySlot)
@@ -167,9 +189,14 @@ void MSXCPU::updateVisiblePage(byte page, byte primarySlot, byte secondarySlot)
 	byte from = slots[page];
 	byte to = 4 * primarySlot + secondarySlot;
 	slots[page] = to;
+	profiler.invalidatePage(page);
 
 	auto [cpuReadLines, cpuWriteLines] = z80Active ? z80->getCacheLines() : r800->getCacheLines();
 
+	// the lines of the visible slot are always up-to-date
+	slotGeneration[from][page] = pageGeneration[page];
+	validateSlotPage(to, page);
+
 	unsigned first = page * (0x4000 / CacheLine::SIZE);
 	unsigned num = 0x4000 / CacheLine::SIZE;
 	std::copy_n(&cpuReadLines      [first], num, &slotReadLines [from][first]);
@@ -190,9 +217,23 @@ void MSXCPU::invalidateAllSlotsRWCache(word start, unsigned size)
 	std::fill_n(cpuReadLines  + first, num, nullptr); // nullptr: means not a valid entry and not
 	std::fill_n(cpuWriteLines + first, num, nullptr); //   yet attempted to fill this entry
 
-	for (auto i : xrange(16)) {
-		std::fill_n(slotReadLines [i] + first, num, nullptr);
-		std::fill_n(slotWriteLines[i] + first, num, nullptr);
+	// The lines of the non-visible slots are only needed on the next slot
+	// switch, so for complete pages postpone that work (this method is
+	// e.g. called on each Panasonic audio bank switch).
+	constexpr unsigned LINES_PER_PAGE = 0x4000 / CacheLine::SIZE;
+	unsigned end = first + num;
+	while (first < end) {
+		unsigned page = first / LINES_PER_PAGE;
+		unsigned pageEnd = std::min((page + 1) * LINES_PER_PAGE, end);
+		if (((first % LINES_PER_PAGE) == 0) && (pageEnd - first == LINES_PER_PAGE)) {
+			++pageGeneration[page];
+		} else {
+			for (auto i : xrange(16)) {
+				std::fill_n(slotReadLines [i] + first, pageEnd - first, nullptr);
+				std::fill_n(slotWriteLines[i] + first, pageEnd - first, nullptr);
+			}
+		}
+		first = pageEnd;
 	}
 }
 
@@ -220,6 +261,7 @@ void MSXCPU::setRWCache(unsigned start, unsigned size, const byte* rData, byte*
 		if (slot == slots[page]) {
 			return z80Active ? z80->getCacheLines() : r800->getCacheLines();
 		} else {
+			validateSlotPage(slot, page);
 			return std::pair{slotReadLines [slot],
 			                 slotWriteLines[slot]};
 		}
@@ -346,11 +388,26 @@ CPURegs& MSXCPU::getRegisters()
 
 void MSXCPU::update(const Setting& setting)
 {
+	if (&setting == &blockCacheSetting) {
+		z80->setBlockCacheEnabled(blockCacheSetting.getBoolean());
+	}
 	          z80 ->update(setting);
 	if (r800) r800->update(setting);
 	exitCPULoopSync();
 }
 
+void MSXCPU::setProfilingEnabled(bool enabled)
+{
+	profiler.setEnabled(enabled);
+	exitCPULoopSync(); // CPUCore samples this at the start of the CPU loop
+}
+
+void MSXCPU::setTraceEnabled(bool enabled)
+{
+	instructionTrace.setEnabled(enabled);
+	exitCPULoopSync(); // CPUCore samples this at the start of the CPU loop
+}
+
 // Command
 
 void MSXCPU::disasmCommand(
@@ -442,11 +499,10 @@ MSXCPU::Debuggable::Debuggable(MSXMotherBoard& motherboard_)
 {
 }
 
-byte MSXCPU::Debuggable::read(unsigned address)
+byte MSXCPU::peekRegister(unsigned index)
 {
-	auto& cpu = OUTER(MSXCPU, debuggable);
-	const CPURegs& regs = cpu.getRegisters();
-	switch (address) {
+	const CPURegs& regs = getRegisters();
+	switch (index) {
 	case  0: return regs.getA();
 	case  1: return regs.getF();
 	case  2: return regs.getB();
@@ -481,6 +537,12 @@ byte MSXCPU::Debuggable::read(unsigned address)
 	}
 }
 
+byte MSXCPU::Debuggable::read(unsigned address)
+{
+	auto& cpu = OUTER(MSXCPU, debuggable);
+	return cpu.peekRegister(address);
+}
+
 void MSXCPU::Debuggable::write(unsigned address, byte value)
 {
 	auto& cpu = OUTER(MSXCPU, debuggable);
@@ -525,6 +587,41 @@ void MSXCPU::Debuggable::write(unsigned address, byte value)
 	}
 }
 
+
+MSXCPU::TraceDebuggable::TraceDebuggable(Debugger& debugger_)
+	: debugger(debugger_)
+{
+	debugger.registerDebuggable("CPU trace", *this);
+}
+
+MSXCPU::TraceDebuggable::~TraceDebuggable()
+{
+	debugger.unregisterDebuggable("CPU trace", *this);
+}
+
+unsigned MSXCPU::TraceDebuggable::getSize() const
+{
+	auto& cpu = OUTER(MSXCPU, traceDebuggable);
+	return unsigned(cpu.instructionTrace.getSize());
+}
+
+std::string_view MSXCPU::TraceDebuggable::getDescription() const
+{
+	return "The raw buffer of the instruction trace (see 'debug trace'), "
+	       "oldest data first. Read-only.";
+}
+
+byte MSXCPU::TraceDebuggable::read(unsigned address)
+{
+	auto& cpu = OUTER(MSXCPU, traceDebuggable);
+	return cpu.instructionTrace.readRaw(address);
+}
+
+void MSXCPU::TraceDebuggable::write(unsigned /*address*/, byte /*value*/)
+{
+	// ignore
+}
+
 // version 1: initial version
 // version 2: activeCPU,newCPU -> z80Active,newZ80Active
 template<typename Archive>
@@ -5,8 +5,11 @@
 #include "SimpleDebuggable.hh"
 #include "Observer.hh"
 #include "BooleanSetting.hh"
+#include "CPUProfiler.hh"
 #include "CacheLine.hh"
+#include "Debuggable.hh"
 #include "EmuTime.hh"
+#include "InstructionTrace.hh"
 #include "TclCallback.hh"
 #include "serialize_meta.hh"
 #include "openmsx.hh"
@@ -17,6 +20,7 @@ namespace openmsx {
 
 class MSXMotherBoard;
 class MSXCPUInterface;
+class Debugger;
 class CPUClock;
 class CPURegs;
 class Z80TYPE;
@@ -144,11 +148,24 @@ public:
 
 	[[nodiscard]] CPURegs& getRegisters();
 
+	/** Read a register like the "CPU regs" debuggable does (see there
+	  * for the meaning of 'index'). */
+	[[nodiscard]] byte peekRegister(unsigned index);
+
+	/** Start/stop collecting profiling data, see CPUProfiler. */
+	void setProfilingEnabled(bool enabled);
+	[[nodiscard]] CPUProfiler& getProfiler() { return profiler; }
+
+	/** Start/stop recording executed instructions, see InstructionTrace. */
+	void setTraceEnabled(bool enabled);
+	[[nodiscard]] InstructionTrace& getInstructionTrace() { return instructionTrace; }
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
 private:
 	void invalidateMemCacheSlot();
+	void validateSlotPage(unsigned slot, unsigned page);
 
 	// only for MSXMotherBoard
 	void execute(bool fastForward);
@@ -171,7 +188,10 @@ private:
 private:
 	MSXMotherBoard& motherboard;
 	BooleanSetting traceSetting;
+	BooleanSetting blockCacheSetting;
 	TclCallback diHaltCallback;
+	CPUProfiler profiler;
+	InstructionTrace instructionTrace;
 	const std::unique_ptr<CPUCore<Z80TYPE>> z80;
 	const std::unique_ptr<CPUCore<R800TYPE>> r800; // can be nullptr
 
@@ -179,6 +199,13 @@ private:
 	      byte* slotWriteLines[16][CacheLine::NUM];
 	byte slots[4]; // active slot for page (= 4 * primSlot + secSlot)
 
+	// Invalidating complete pages in all slots is done lazily: the
+	// (shadow) cache lines of a slot for a page are only valid when its
+	// generation matches the generation of the page, otherwise they're
+	// all 'unknown'. See validateSlotPage().
+	unsigned pageGeneration[4];
+	unsigned slotGeneration[16][4];
+
 	struct TimeInfoTopic final : InfoTopic {
 		explicit TimeInfoTopic(InfoCommand& machineInfoCommand);
 		void execute(span<const TclObject> tokens,
@@ -205,6 +232,18 @@ private:
 		void write(unsigned address, byte value) override;
 	} debuggable;
 
+	// Can't be a SimpleDebuggable, the size changes when the trace buffer
+	// is resized.
+	struct TraceDebuggable final : openmsx::Debuggable {
+		explicit TraceDebuggable(Debugger& debugger);
+		~TraceDebuggable();
+		[[nodiscard]] unsigned getSize() const override;
+		[[nodiscard]] std::string_view getDescription() const override;
+		[[nodiscard]] byte read(unsigned address) override;
+		void write(unsigned address, byte value) override;
+		Debugger& debugger;
+	} traceDebuggable;
+
 	EmuTime reference;
 	bool z80Active;
 	bool newZ80Active;
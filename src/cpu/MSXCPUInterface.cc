@@ -7,6 +7,7 @@
 #include "RealTime.hh"
 #include "MSXMotherBoard.hh"
 #include "MSXCPU.hh"
+#include "CPURegs.hh"
 #include "VDPIODelay.hh"
 #include "CliComm.hh"
 #include "MSXMultiIODevice.hh"
@@ -26,11 +27,13 @@
 #include "stl.hh"
 #include "unreachable.hh"
 #include "xrange.hh"
+#include <algorithm>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <utility>
 
 using std::string;
 using std::vector;
@@ -136,6 +139,11 @@ MSXCPUInterface::MSXCPUInterface(MSXMotherBoard& motherBoard_)
 
 MSXCPUInterface::~MSXCPUInterface()
 {
+	// Don't leave the Reactor blocked when a machine gets deleted while
+	// it's in break mode.
+	breaked = false;
+	updateBreakBlock();
+
 	if (--breakedSettingCount == 0) {
 		assert(breakedSetting);
 		breakedSetting = nullptr;
@@ -781,15 +789,18 @@ void MSXCPUInterface::writeSlottedMem(unsigned address, byte value,
 
 void MSXCPUInterface::insertBreakPoint(BreakPoint bp)
 {
+	breakPointAddresses[bp.getAddress()] = true;
 	auto it = ranges::upper_bound(breakPoints, bp, CompareBreakpoints());
 	breakPoints.insert(it, std::move(bp));
 }
 
 void MSXCPUInterface::removeBreakPoint(const BreakPoint& bp)
 {
-	auto [first, last] = ranges::equal_range(breakPoints, bp.getAddress(), CompareBreakpoints());
+	word address = bp.getAddress();
+	auto [first, last] = ranges::equal_range(breakPoints, address, CompareBreakpoints());
 	breakPoints.erase(find_if_unguarded(first, last,
 		[&](const BreakPoint& i) { return &i == &bp; }));
+	updateBreakPointAddress(address);
 }
 void MSXCPUInterface::removeBreakPoint(unsigned id)
 {
@@ -797,15 +808,68 @@ void MSXCPUInterface::removeBreakPoint(unsigned id)
 		[&](const BreakPoint& i) { return i.getId() == id; });
 	    // could be ==end for a breakpoint that removes itself AND has the -once flag set
 	    it != breakPoints.end()) {
+		word address = it->getAddress();
 		breakPoints.erase(it);
+		updateBreakPointAddress(address);
 	}
 }
 
+void MSXCPUInterface::updateBreakPointAddress(word address)
+{
+	auto [first, last] = ranges::equal_range(breakPoints, address, CompareBreakpoints());
+	breakPointAddresses[address] = first != last;
+}
+
+// Gives compiled conditions access to the state of this machine.
+class ConditionContext final : public CompiledCondition::Context
+{
+public:
+	explicit ConditionContext(MSXMotherBoard& motherBoard_)
+		: motherBoard(motherBoard_)
+		, interface(motherBoard.getCPUInterface())
+		, cpu(motherBoard.getCPU()) {}
+
+	byte readRegister(unsigned index) override
+	{
+		return cpu.peekRegister(index);
+	}
+
+	byte peekMem(word address) override
+	{
+		return interface.peekMem(address, motherBoard.getCurrentTime());
+	}
+
+	bool isPCInSlot(int ps, int ss) override
+	{
+		int page = cpu.getRegisters().getPC() >> 14;
+		int pcPs = interface.getPrimarySlot(page);
+		if ((ps != -1) && (pcPs != ps)) return false;
+		if ((ss != -1) && interface.isExpanded(pcPs) &&
+		    (interface.getSecondarySlot(page) != ss)) return false;
+		return true;
+	}
+
+private:
+	MSXMotherBoard& motherBoard;
+	MSXCPUInterface& interface;
+	MSXCPU& cpu;
+};
+
 void MSXCPUInterface::checkBreakPoints(
 	std::pair<BreakPoints::const_iterator,
-	          BreakPoints::const_iterator> range,
-	MSXMotherBoard& motherBoard)
+	          BreakPoints::const_iterator> range)
 {
+	// Most of the time, none of the conditions is true. When they can be
+	// evaluated without Tcl, detect that without making the copies below.
+	ConditionContext context(motherBoard);
+	auto mightTrigger = [&](const BreakPointBase& b) {
+		return b.onlyOnce() || b.mightBeTrue(context);
+	};
+	if (std::none_of(range.first, range.second, mightTrigger) &&
+	    ranges::none_of(conditions, mightTrigger)) {
+		return;
+	}
+
 	// create copy for the case that breakpoint/condition removes itself
 	//  - keeps object alive by holding a shared_ptr to it
 	//  - avoids iterating over a changing collection
@@ -813,14 +877,14 @@ void MSXCPUInterface::checkBreakPoints(
 	auto& globalCliComm = motherBoard.getReactor().getGlobalCliComm();
 	auto& interp        = motherBoard.getReactor().getInterpreter();
 	for (auto& p : bpCopy) {
-		p.checkAndExecute(globalCliComm, interp);
+		p.checkAndExecute(globalCliComm, interp, &context);
 		if (p.onlyOnce()) {
 			removeBreakPoint(p.getId());
 		}
 	}
 	auto condCopy = conditions;
 	for (auto& c : condCopy) {
-		c.checkAndExecute(globalCliComm, interp);
+		c.checkAndExecute(globalCliComm, interp, &context);
 		if (c.onlyOnce()) {
 			removeCondition(c.getId());
 		}
@@ -1001,12 +1065,9 @@ void MSXCPUInterface::doBreak()
 	if (breaked) return;
 	breaked = true;
 	msxcpu.exitCPULoopSync();
+	updateBreakBlock();
 
-	Reactor& reactor = motherBoard.getReactor();
-	reactor.block();
-	breakedSetting->setReadOnlyValue(TclObject("true"));
-	reactor.getCliComm().update(CliComm::STATUS, "cpu", "suspended");
-	reactor.getEventDistributor().distributeEvent(
+	motherBoard.getReactor().getEventDistributor().distributeEvent(
 		std::make_shared<SimpleEvent>(OPENMSX_BREAK_EVENT));
 }
 
@@ -1023,24 +1084,51 @@ void MSXCPUInterface::doContinue()
 	assert(!isFastForward());
 	if (breaked) {
 		breaked = false;
+		updateBreakBlock();
+		motherBoard.getRealTime().resync();
+	}
+}
 
-		Reactor& reactor = motherBoard.getReactor();
-		breakedSetting->setReadOnlyValue(TclObject("false"));
-		reactor.getCliComm().update(CliComm::STATUS, "cpu", "running");
+void MSXCPUInterface::updateBreakBlock()
+{
+	// Only the active machine blocks the Reactor (and is reflected in the
+	// 'breaked' setting) while it's in break mode. A machine that is in
+	// break mode but not active stays in break mode, it blocks the Reactor
+	// again when it gets activated.
+	bool block = breaked && motherBoard.isActive();
+	if (block == blocking) return;
+	blocking = block;
+
+	Reactor& reactor = motherBoard.getReactor();
+	breakedSetting->setReadOnlyValue(TclObject(block ? "true" : "false"));
+	reactor.getCliComm().update(CliComm::STATUS, "cpu",
+	                            block ? "suspended" : "running");
+	if (block) {
+		reactor.block();
+	} else {
 		reactor.unblock();
-		motherBoard.getRealTime().resync();
 	}
 }
 
-void MSXCPUInterface::cleanup()
+void MSXCPUInterface::transferBreakPoints(MSXCPUInterface& other)
 {
-	// before the Tcl interpreter is destroyed, we must delete all
-	// TclObjects. Breakpoints and conditions contain such objects
-	// for the condition and action.
-	// TODO it would be nicer if breakpoints and conditions were not
-	//      global objects.
-	breakPoints.clear();
-	conditions.clear();
+	breakPoints = std::move(other.breakPoints);
+	breakPointAddresses = other.breakPointAddresses;
+	conditions  = std::move(other.conditions);
+	other.breakPoints.clear();
+	other.breakPointAddresses.reset();
+	other.conditions.clear();
+
+	// The old machine is about to be replaced by this one, this machine
+	// takes over its break state. Also take over the block on the Reactor
+	// (if any) as-is, so that the Reactor doesn't get unblocked in
+	// between. Activating this machine then keeps it blocked.
+	if (other.breaked) {
+		other.breaked = false;
+		breaked = true;
+		msxcpu.exitCPULoopSync();
+	}
+	blocking = std::exchange(other.blocking, false);
 }
 
 
@@ -246,14 +246,19 @@ public:
 	void unsetExpanded(int ps);
 	void testUnsetExpanded(int ps, std::vector<MSXDevice*> allowed) const;
 	[[nodiscard]] inline bool isExpanded(int ps) const { return expanded[ps] != 0; }
+	/** The currently selected primary/secondary slot in the given page. */
+	[[nodiscard]] int getPrimarySlot  (int page) const { return primarySlotState[page]; }
+	[[nodiscard]] int getSecondarySlot(int page) const { return secondarySlotState[page]; }
+	/** The device that is currently visible in the given page. */
+	[[nodiscard]] MSXDevice* getVisibleDevice(int page) const { return visibleDevices[page]; }
 	void changeExpanded(bool newExpanded);
 
 	[[nodiscard]] DummyDevice& getDummyDevice() { return *dummyDevice; }
 
-	static void insertBreakPoint(BreakPoint bp);
-	static void removeBreakPoint(const BreakPoint& bp);
+	void insertBreakPoint(BreakPoint bp);
+	void removeBreakPoint(const BreakPoint& bp);
 	using BreakPoints = std::vector<BreakPoint>;
-	[[nodiscard]] static const BreakPoints& getBreakPoints() { return breakPoints; }
+	[[nodiscard]] const BreakPoints& getBreakPoints() const { return breakPoints; }
 
 	void setWatchPoint(const std::shared_ptr<WatchPoint>& watchPoint);
 	void removeWatchPoint(std::shared_ptr<WatchPoint> watchPoint);
@@ -261,35 +266,45 @@ public:
 	using WatchPoints = std::vector<std::shared_ptr<WatchPoint>>;
 	[[nodiscard]] const WatchPoints& getWatchPoints() const { return watchPoints; }
 
-	static void setCondition(DebugCondition cond);
-	static void removeCondition(const DebugCondition& cond);
+	void setCondition(DebugCondition cond);
+	void removeCondition(const DebugCondition& cond);
 	using Conditions = std::vector<DebugCondition>;
-	[[nodiscard]] static const Conditions& getConditions() { return conditions; }
+	[[nodiscard]] const Conditions& getConditions() const { return conditions; }
 
-	[[nodiscard]] static bool isBreaked() { return breaked; }
+	[[nodiscard]] bool isBreaked() const { return breaked; }
 	void doBreak();
 	void doStep();
 	void doContinue();
 
+	/** (Un)block the Reactor when the break state or the active state of
+	  * this machine changed. Only the active machine's break state blocks
+	  * the Reactor. Called by MSXMotherBoard::activate(). */
+	void updateBreakBlock();
+
 	// breakpoint methods used by CPUCore
-	[[nodiscard]] static bool anyBreakPoints()
+	[[nodiscard]] bool anyBreakPoints() const
 	{
 		return !breakPoints.empty() || !conditions.empty();
 	}
-	[[nodiscard]] static bool checkBreakPoints(unsigned pc, MSXMotherBoard& motherBoard)
+	[[nodiscard]] bool checkBreakPoints(unsigned pc)
 	{
-		auto range = ranges::equal_range(breakPoints, pc, CompareBreakpoints());
-		if (conditions.empty() && (range.first == range.second)) {
+		bool anyBreakPoint = breakPointAddresses[pc];
+		if (conditions.empty() && !anyBreakPoint) {
 			return false;
 		}
+		auto range = anyBreakPoint
+		           ? ranges::equal_range(breakPoints, pc, CompareBreakpoints())
+		           : std::pair(breakPoints.cend(), breakPoints.cend());
 
 		// slow path non-inlined
-		checkBreakPoints(range, motherBoard);
+		checkBreakPoints(range);
 		return isBreaked();
 	}
 
-	// cleanup global variables
-	static void cleanup();
+	/** Take over the breakpoints, conditions and the break state of
+	  * another machine. Used when the active machine gets replaced by a
+	  * new one (e.g. on a reverse jump). */
+	void transferBreakPoints(MSXCPUInterface& other);
 
 	// In fast-forward mode, breakpoints, watchpoints and conditions should
 	// not trigger.
@@ -316,11 +331,11 @@ private:
 	                    int ps, int ss, int base, int size);
 
 
-	static void checkBreakPoints(std::pair<BreakPoints::const_iterator,
-	                                       BreakPoints::const_iterator> range,
-	                             MSXMotherBoard& motherBoard);
-	static void removeBreakPoint(unsigned id);
-	static void removeCondition(unsigned id);
+	void checkBreakPoints(std::pair<BreakPoints::const_iterator,
+	                                BreakPoints::const_iterator> range);
+	void removeBreakPoint(unsigned id);
+	void updateBreakPointAddress(word address);
+	void removeCondition(unsigned id);
 
 	void removeAllWatchPoints();
 	void updateMemWatch(WatchPoint::Type type);
@@ -432,11 +447,15 @@ private:
 
 	bool fastForward; // no need to serialize
 
-	//  All CPUs (Z80 and R800) of all MSX machines share this state.
-	static inline BreakPoints breakPoints; // sorted on address
-	WatchPoints watchPoints; // ordered in creation order,  TODO must also be static
-	static inline Conditions conditions; // ordered in creation order
-	static inline bool breaked = false;
+	// Both CPUs (Z80 and R800) of this MSX machine share this state, but
+	// different machines are completely independent (see also
+	// transferBreakPoints()).
+	BreakPoints breakPoints; // sorted on address
+	std::bitset<0x10000> breakPointAddresses; // is there a bp on this address?
+	WatchPoints watchPoints; // ordered in creation order
+	Conditions conditions; // ordered in creation order
+	bool breaked = false;
+	bool blocking = false; // holding a block on the Reactor?
 };
 
 
@@ -4,12 +4,17 @@
 #include "MSXMotherBoard.hh"
 #include "MSXCPU.hh"
 #include "MSXCPUInterface.hh"
+#include "CPUProfiler.hh"
+#include "Dasm.hh"
+#include "InstructionTrace.hh"
 #include "BreakPoint.hh"
 #include "DebugCondition.hh"
 #include "MSXWatchIODevice.hh"
 #include "TclArgParser.hh"
 #include "TclObject.hh"
 #include "CommandException.hh"
+#include "File.hh"
+#include "FileOperations.hh"
 #include "MemBuffer.hh"
 #include "one_of.hh"
 #include "ranges.hh"
@@ -19,6 +24,7 @@
 #include "view.hh"
 #include "xrange.hh"
 #include <cassert>
+#include <fstream>
 #include <memory>
 #include <stdexcept>
 
@@ -184,8 +190,12 @@ void Debugger::transfer(Debugger& other)
 		}
 	}
 
-	// Breakpoints and conditions are (currently) global, so no need to
-	// copy those.
+	// Move breakpoints and conditions (and the break state).
+	motherBoard.getCPUInterface().transferBreakPoints(
+		other.motherBoard.getCPUInterface());
+
+	// Keep the collected coverage data.
+	coverage.transfer(other.coverage);
 }
 
 
@@ -244,7 +254,10 @@ void Debugger::Cmd::execute(
 		"set_condition",     [&]{ setCondition(tokens, result); },
 		"remove_condition",  [&]{ removeCondition(tokens, result); },
 		"list_conditions",   [&]{ listConditions(tokens, result); },
-		"probe",             [&]{ probe(tokens, result); });
+		"probe",             [&]{ probe(tokens, result); },
+		"profile",           [&]{ profile(tokens, result); },
+		"trace",             [&]{ trace(tokens, result); },
+		"coverage",          [&]{ coverage(tokens, result); });
 }
 
 void Debugger::Cmd::list(TclObject& result)
@@ -687,6 +700,192 @@ void Debugger::Cmd::probeListBreakPoints(
 	result = res;
 }
 
+void Debugger::Cmd::profile(span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{3}, "subcommand ?arg ...?");
+	auto& cpu = *debugger().cpu;
+	executeSubCommand(tokens[2].getString(),
+		"start",     [&]{ cpu.setProfilingEnabled(true); },
+		"stop",      [&]{ cpu.setProfilingEnabled(false); },
+		"enabled",   [&]{ result = cpu.getProfiler().isEnabled(); },
+		"clear",     [&]{ cpu.getProfiler().clear(); },
+		"flat",      [&]{ profileFlat(tokens, result); },
+		"callgrind", [&]{ profileCallgrind(tokens, result); });
+}
+void Debugger::Cmd::profileFlat(span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, Between{3, 4}, Prefix{3}, "?count?");
+	auto entries = debugger().cpu->getProfiler().getFlatProfile();
+	if (tokens.size() == 4) {
+		auto count = tokens[3].getInt(getInterpreter());
+		if (count < 0) throw CommandException("Count must be non-negative");
+		if (size_t(count) < entries.size()) entries.resize(count);
+	}
+	auto slotOrX = [](int i) { return (i == -1) ? TclObject("X") : TclObject(i); };
+	for (const auto& e : entries) {
+		using P = CPUProfiler;
+		result.addListElement(makeTclList(
+			P::getAddress(e.location),
+			P::getPrimarySlot(e.location),
+			slotOrX(P::getSecondarySlot(e.location)),
+			slotOrX(P::getSegment(e.location)),
+			int64_t(e.cost.ticks), int64_t(e.cost.count)));
+	}
+}
+void Debugger::Cmd::profileCallgrind(span<const TclObject> tokens, TclObject& /*result*/)
+{
+	checkNumArgs(tokens, 4, Prefix{3}, "filename");
+	auto filename = FileOperations::expandTilde(string(tokens[3].getString()));
+	std::ofstream file;
+	FileOperations::openofstream(file, filename);
+	if (!file.is_open()) {
+		throw CommandException("Couldn't open ", filename, " for writing.");
+	}
+	debugger().cpu->getProfiler().writeCallgrind(file);
+	if (!file) {
+		throw CommandException("Error while writing ", filename, '.');
+	}
+}
+
+void Debugger::Cmd::trace(span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{3}, "subcommand ?arg ...?");
+	auto& cpu = *debugger().cpu;
+	executeSubCommand(tokens[2].getString(),
+		"start",   [&]{ traceStart(tokens, result); },
+		"stop",    [&]{ cpu.setTraceEnabled(false); },
+		"enabled", [&]{ result = cpu.getInstructionTrace().isEnabled(); },
+		"clear",   [&]{ cpu.getInstructionTrace().clear(); },
+		"size",    [&]{ result = unsigned(cpu.getInstructionTrace().getSize()); },
+		"save",    [&]{ traceSave(tokens, result); });
+}
+void Debugger::Cmd::traceStart(span<const TclObject> tokens, TclObject& /*result*/)
+{
+	checkNumArgs(tokens, Between{3, 4}, Prefix{3}, "?sizeInMB?");
+	auto& cpu = *debugger().cpu;
+	auto& trace = cpu.getInstructionTrace();
+	if (tokens.size() == 4) {
+		auto mb = tokens[3].getInt(getInterpreter());
+		if ((mb < 1) || (mb > 1024)) {
+			throw CommandException("Size must be between 1 and 1024 MB");
+		}
+		trace.setSize(size_t(mb) << 20);
+	} else if (trace.getSize() == 0) {
+		trace.setSize(size_t(16) << 20);
+	}
+	cpu.setTraceEnabled(true);
+}
+void Debugger::Cmd::traceSave(span<const TclObject> tokens, TclObject& /*result*/)
+{
+	checkNumArgs(tokens, 4, Prefix{3}, "filename");
+	auto filename = FileOperations::expandTilde(string(tokens[3].getString()));
+	std::ofstream file;
+	FileOperations::openofstream(file, filename);
+	if (!file.is_open()) {
+		throw CommandException("Couldn't open ", filename, " for writing.");
+	}
+
+	using Trace = InstructionTrace;
+	Trace::Reader reader(debugger().cpu->getInstructionTrace());
+	Trace::Entry entry;
+	string line;
+	while (reader.next(entry)) {
+		line = strCat(entry.ticks, ' ', hex_string<4>(entry.pc), ' ');
+		if (entry.kind == Trace::Kind::INSTRUCTION) {
+			for (auto i : xrange(4)) {
+				if (i < entry.length) {
+					strAppend(line, hex_string<2>(entry.opcode[i]));
+				} else {
+					line += "  ";
+				}
+			}
+			string mnemonic;
+			dasm(span<const byte>(entry.opcode.data(), entry.length),
+			     entry.pc, mnemonic);
+			strAppend(line, ' ', mnemonic);
+			if (mnemonic.size() < 20) line.append(20 - mnemonic.size(), ' ');
+		} else {
+			strAppend(line, "         ",
+			          (entry.kind == Trace::Kind::IRQ) ? "<IRQ>" : "<NMI>",
+			          string(15, ' '));
+		}
+		for (auto i : xrange(Trace::NUM_REGS)) {
+			strAppend(line, ' ', Trace::REG_NAMES[i], '=',
+			          hex_string<4>(entry.regs[i]));
+		}
+		for (auto i : xrange(entry.numAccesses)) {
+			const auto& a = entry.accesses[i];
+			strAppend(line, (a.write ? " W(" : " R("), hex_string<4>(a.address),
+			          ")=", hex_string<2>(a.value));
+		}
+		line += '\n';
+		file << line;
+	}
+	if (!file) {
+		throw CommandException("Error while writing ", filename, '.');
+	}
+}
+
+void Debugger::Cmd::coverage(span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{3}, "subcommand ?arg ...?");
+	auto& cov = debugger().coverage;
+	executeSubCommand(tokens[2].getString(),
+		"start",   [&]{ cov.setEnabled(true);  debugger().cpu->exitCPULoopSync(); },
+		"stop",    [&]{ cov.setEnabled(false); debugger().cpu->exitCPULoopSync(); },
+		"enabled", [&]{ result = cov.isEnabled(); },
+		"clear",   [&]{ cov.clear(); },
+		"summary", [&]{ coverageSummary(tokens, result); },
+		"save",    [&]{ coverageSave(tokens, result); },
+		"merge",   [&]{ coverageMerge(tokens, result); });
+}
+void Debugger::Cmd::coverageSummary(span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, 3, "");
+	for (const auto& r : debugger().coverage.getRegions()) {
+		TclObject line = makeTclList(r.name, r.size);
+		for (const auto& c : r.counts) {
+			line.addListElement(int(ranges::count_if(c, [](auto n) { return n != 0; })));
+		}
+		result.addListElement(line);
+	}
+}
+static void writeCoverage(const string& filename, span<const MemoryCoverage::Region> regions)
+{
+	std::ofstream file;
+	FileOperations::openofstream(file, filename);
+	if (!file.is_open()) {
+		throw CommandException("Couldn't open ", filename, " for writing.");
+	}
+	MemoryCoverage::save(file, regions);
+	if (!file) {
+		throw CommandException("Error while writing ", filename, '.');
+	}
+}
+void Debugger::Cmd::coverageSave(span<const TclObject> tokens, TclObject& /*result*/)
+{
+	checkNumArgs(tokens, 4, Prefix{3}, "filename");
+	auto filename = FileOperations::expandTilde(string(tokens[3].getString()));
+	writeCoverage(filename, debugger().coverage.getRegions());
+}
+void Debugger::Cmd::coverageMerge(span<const TclObject> tokens, TclObject& /*result*/)
+{
+	checkNumArgs(tokens, AtLeast{5}, Prefix{3}, "output input ?input ...?");
+	vector<MemoryCoverage::Region> merged;
+	try {
+		for (const auto& input : view::drop(tokens, 4)) {
+			File file(FileOperations::expandTilde(string(input.getString())));
+			for (const auto& r : MemoryCoverage::load(file.mmap())) {
+				MemoryCoverage::merge(merged, r);
+			}
+		}
+	} catch (MSXException& e) {
+		throw CommandException("Couldn't merge coverage maps: ", e.getMessage());
+	}
+	auto filename = FileOperations::expandTilde(string(tokens[3].getString()));
+	writeCoverage(filename, merged);
+}
+
 string Debugger::Cmd::help(const vector<string>& tokens) const
 {
 	static const string generalHelp =
@@ -709,6 +908,9 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    remove_condition  remove a certain condition\n"
 		"    list_conditions   list the active conditions\n"
 		"    probe             probe related subcommands\n"
+		"    profile           CPU profiler related subcommands\n"
+		"    trace             instruction trace related subcommands\n"
+		"    coverage          code coverage related subcommands\n"
 		"    cont              continue execution after break\n"
 		"    step              execute one instruction\n"
 		"    break             break CPU at current position\n"
@@ -849,6 +1051,78 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    set_bp <probe> [-once] [<cond>] [<cmd>]  set a breakpoint on the given probe\n"
 		"    remove_bp <id>                           remove the given breakpoint\n"
 		"    list_bp                                  returns a list of breakpoints that are set on probes\n";
+	static const string profileHelp =
+		"debug profile <subcommand> [<arguments>]\n"
+		"  Measure how many CPU cycles are spent where. Possible subcommands are:\n"
+		"    start                start collecting profiling data\n"
+		"    stop                 stop collecting (the data is kept)\n"
+		"    enabled              returns whether data is being collected\n"
+		"    clear                discard all collected data\n"
+		"    flat [<count>]       returns the cost per instruction\n"
+		"    callgrind <filename> write a report in callgrind format\n"
+		"  The cost of an instruction is the number of CPU cycles it took "
+		"(including wait cycles, so the sum for the whole profile equals "
+		"the emulated time the CPU was running). Instructions are "
+		"identified by their address, the primary and secondary slot and "
+		"the selected memory mapper or ROM mapper segment.\n"
+		"  The result of 'flat' is a list of {address ps ss segment cycles "
+		"count}, sorted on decreasing number of cycles, optionally limited "
+		"to <count> elements. The secondary slot is 'X' for a non-expanded "
+		"slot, the segment is 'X' when there's no (known) mapper.\n"
+		"  The 'callgrind' report also contains the call graph: for each "
+		"CALL or RST instruction and each accepted interrupt, how often it "
+		"occurred and how many cycles were spent until it returned. This "
+		"file can be visualized with e.g. KCachegrind.\n"
+		"  While profiling is enabled the emulation runs somewhat slower "
+		"(comparable to having a breakpoint set).\n";
+	static const string traceHelp =
+		"debug trace <subcommand> [<arguments>]\n"
+		"  Record the most recently executed instructions. Possible "
+		"subcommands are:\n"
+		"    start [<sizeInMB>]   start recording\n"
+		"    stop                 stop recording (the data is kept)\n"
+		"    enabled              returns whether instructions are being recorded\n"
+		"    clear                discard all recorded data\n"
+		"    size                 returns the size of the buffer in bytes\n"
+		"    save <filename>      write the recorded instructions to a text file\n"
+		"  The instructions are stored in a ring buffer, when it is full "
+		"the oldest instructions are discarded. The buffer is allocated by "
+		"'start': with the given size, or 16MB when no size is given and "
+		"there's no buffer yet. Giving a size discards all earlier data. "
+		"Typically an instruction takes 4 to 8 bytes.\n"
+		"  Per instruction the start time (in CPU cycles), the address, the "
+		"opcode bytes, the resulting register values and the memory reads "
+		"and writes (at most 8, not counting opcode fetches) are recorded, "
+		"and also when an IRQ or NMI was accepted. A memory access takes 3 "
+		"more bytes.\n"
+		"  The raw (compressed) buffer is also available as the 'CPU trace' "
+		"debuggable.\n"
+		"  While recording the emulation runs somewhat slower.\n";
+	static const string coverageHelp =
+		"debug coverage <subcommand> [<arguments>]\n"
+		"  Count per byte of ROM and RAM how often it was executed, read "
+		"and written. Possible subcommands are:\n"
+		"    start                        start collecting\n"
+		"    stop                         stop collecting (the data is kept)\n"
+		"    enabled                      returns whether data is being collected\n"
+		"    clear                        reset all counters\n"
+		"    summary                      returns a summary per memory\n"
+		"    save <filename>              write all counters to a binary file\n"
+		"    merge <output> <input> ...   combine saved files into one\n"
+		"  The counters are kept per ROM and RAM (the same names as the "
+		"debuggables), not per CPU address. So e.g. code in a memory "
+		"mapper segment or in a ROM block is counted in that segment or "
+		"block, wherever it was visible to the CPU. Executed bytes are "
+		"all instruction bytes (opcodes and operands) fetched by the "
+		"CPU.\n"
+		"  The result of 'summary' is a list of {name size executed read "
+		"written}, where the last three are the number of bytes with a "
+		"non-zero counter.\n"
+		"  Only accesses to cacheable memory are counted, that's plain "
+		"ROM and RAM, but e.g. not memory-mapped registers.\n"
+		"  'merge' sums the counters of files from multiple runs, e.g. to "
+		"get the combined coverage of a set of tests. See MemoryCoverage.hh "
+		"for the file format.\n";
 	static const string contHelp =
 		"debug cont\n"
 		"  Continue execution after CPU was breaked.\n";
@@ -914,6 +1188,12 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		return listCondHelp;
 	} else if (tokens[1] == "probe") {
 		return probeHelp;
+	} else if (tokens[1] == "profile") {
+		return profileHelp;
+	} else if (tokens[1] == "trace") {
+		return traceHelp;
+	} else if (tokens[1] == "coverage") {
+		return coverageHelp;
 	} else if (tokens[1] == "cont") {
 		return contHelp;
 	} else if (tokens[1] == "step") {
@@ -961,7 +1241,7 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 	static constexpr const char* const otherCmds[] = {
 		"disasm", "set_bp", "remove_bp", "set_watchpoint",
 		"remove_watchpoint", "set_condition", "remove_condition",
-		"probe",
+		"probe", "profile", "trace", "coverage",
 	};
 	switch (tokens.size()) {
 	case 2: {
@@ -995,6 +1275,24 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 					"remove_bp", "list_bp",
 				};
 				completeString(tokens, subCmds);
+			} else if (tokens[1] == "profile") {
+				static constexpr const char* const subCmds[] = {
+					"start", "stop", "enabled", "clear",
+					"flat", "callgrind",
+				};
+				completeString(tokens, subCmds);
+			} else if (tokens[1] == "trace") {
+				static constexpr const char* const subCmds[] = {
+					"start", "stop", "enabled", "clear",
+					"size", "save",
+				};
+				completeString(tokens, subCmds);
+		} else if (tokens[1] == "coverage") {
+				static constexpr const char* const subCmds[] = {
+					"start", "stop", "enabled", "clear",
+					"summary", "save", "merge",
+				};
+				completeString(tokens, subCmds);
 			}
 		}
 		break;
@@ -1,6 +1,7 @@
 #ifndef DEBUGGER_HH
 #define DEBUGGER_HH
 
+#include "MemoryCoverage.hh"
 #include "Probe.hh"
 #include "RecordedCommand.hh"
 #include "WatchPoint.hh"
@@ -42,6 +43,7 @@ public:
 	void transfer(Debugger& other);
 
 	[[nodiscard]] MSXMotherBoard& getMotherBoard() { return motherBoard; }
+	[[nodiscard]] MemoryCoverage& getMemoryCoverage() { return coverage; }
 
 private:
 	[[nodiscard]] Debuggable& getDebuggable(std::string_view name);
@@ -99,6 +101,16 @@ private:
 		void probeSetBreakPoint(span<const TclObject> tokens, TclObject& result);
 		void probeRemoveBreakPoint(span<const TclObject> tokens, TclObject& result);
 		void probeListBreakPoints(span<const TclObject> tokens, TclObject& result);
+		void profile(span<const TclObject> tokens, TclObject& result);
+		void profileFlat(span<const TclObject> tokens, TclObject& result);
+		void profileCallgrind(span<const TclObject> tokens, TclObject& result);
+		void trace(span<const TclObject> tokens, TclObject& result);
+		void traceStart(span<const TclObject> tokens, TclObject& result);
+		void traceSave(span<const TclObject> tokens, TclObject& result);
+		void coverage(span<const TclObject> tokens, TclObject& result);
+		void coverageSummary(span<const TclObject> tokens, TclObject& result);
+		void coverageSave(span<const TclObject> tokens, TclObject& result);
+		void coverageMerge(span<const TclObject> tokens, TclObject& result);
 	} cmd;
 
 	struct NameFromProbe {
@@ -110,6 +122,7 @@ private:
 	hash_map<std::string, Debuggable*, XXHasher> debuggables;
 	hash_set<ProbeBase*, NameFromProbe, XXHasher> probes;
 	std::vector<std::unique_ptr<ProbeBreakPoint>> probeBreakPoints; // unordered
+	MemoryCoverage coverage;
 	MSXCPU* cpu = nullptr;
 };
 
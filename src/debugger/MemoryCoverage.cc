@@ -0,0 +1,232 @@
+#include "MemoryCoverage.hh"
+#include "MSXException.hh"
+#include "endian.hh"
+#include "ranges.hh"
+#include "stl.hh"
+#include "xrange.hh"
+#include <cassert>
+#include <ostream>
+
+namespace openmsx {
+
+static constexpr std::string_view MAGIC = "openMSX coverage";
+static constexpr uint32_t VERSION = 1;
+
+static auto findName(std::vector<MemoryCoverage::Region>& regions, std::string_view name)
+{
+	return ranges::find_if(regions, [&](auto& r) { return r.name == name; });
+}
+
+void MemoryCoverage::allocate(Region& region)
+{
+	for (auto& c : region.counts) c.resize(region.size);
+}
+
+void MemoryCoverage::registerMemory(std::string name, span<const byte> memory)
+{
+	if (memory.empty()) return;
+	assert(find(memory.data()) == size_t(-1));
+	last = size_t(-1);
+	++generation;
+	// reattach the counters of a previously removed memory
+	auto it = findName(regions, name);
+	if (it != regions.end()) {
+		assert(!it->data);
+		if (it->size == memory.size()) {
+			it->data = memory.data();
+			if (enabled) allocate(*it);
+			return;
+		}
+		regions.erase(it); // stale
+	}
+	auto& region = regions.emplace_back();
+	region.name = std::move(name);
+	region.data = memory.data();
+	region.size = unsigned(memory.size());
+	if (enabled) allocate(region);
+}
+
+void MemoryCoverage::unregisterMemory(const byte* data)
+{
+	last = size_t(-1);
+	++generation;
+	auto i = find(data);
+	if (i == size_t(-1)) return; // empty memory
+	auto it = regions.begin() + i;
+	if (it->counts[EXEC].empty()) {
+		move_pop_back(regions, it);
+	} else {
+		it->data = nullptr;
+	}
+}
+
+void MemoryCoverage::setEnabled(bool enabled_)
+{
+	enabled = enabled_;
+	++generation;
+	if (enabled) {
+		for (auto& r : regions) {
+			if (r.data) allocate(r);
+		}
+	}
+}
+
+void MemoryCoverage::clear()
+{
+	last = size_t(-1);
+	++generation;
+	for (auto& r : regions) {
+		for (auto& c : r.counts) ranges::fill(c, 0);
+	}
+	regions.erase(ranges::remove_if(regions, [](auto& r) { return !r.data; }),
+	              regions.end());
+}
+
+size_t MemoryCoverage::find(const byte* p) const
+{
+	for (auto i : xrange(regions.size())) {
+		const auto& r = regions[i];
+		if (r.data && (uintptr_t(p) - uintptr_t(r.data) < r.size)) return i;
+	}
+	return size_t(-1);
+}
+
+void MemoryCoverage::LineCache::reset()
+{
+	for (auto& kind : entries) {
+		for (auto& e : kind) e = Entry();
+	}
+	generation = coverage.generation;
+}
+
+void MemoryCoverage::LineCache::fill(
+	Entry& e, Kind kind, const byte* line, unsigned address)
+{
+	e.line = line;
+	e.counts = nullptr;
+	auto begin = uintptr_t(&line[address & CacheLine::HIGH]);
+	auto end = begin + CacheLine::SIZE;
+	for (auto& r : coverage.regions) {
+		if (!r.data) continue;
+		auto rBegin = uintptr_t(r.data);
+		auto rEnd = rBegin + r.size;
+		if ((end <= rBegin) || (rEnd <= begin)) continue;
+		if ((rBegin <= begin) && (end <= rEnd)) {
+			assert(!r.counts[kind].empty());
+			e.counts = &r.counts[kind][begin - rBegin];
+		} else {
+			// e.g. a memory smaller than a cache line
+			e.counts = reinterpret_cast<uint32_t*>(1);
+		}
+		return;
+	}
+}
+
+void MemoryCoverage::transfer(MemoryCoverage& other)
+{
+	setEnabled(other.enabled);
+	for (const auto& r : other.regions) {
+		if (r.counts[EXEC].empty()) continue;
+		auto it = findName(regions, r.name);
+		if ((it != regions.end()) && (it->size != r.size)) continue;
+		merge(regions, r);
+	}
+	other.clear();
+}
+
+void MemoryCoverage::merge(std::vector<Region>& dst, const Region& src)
+{
+	auto it = findName(dst, src.name);
+	if (it == dst.end()) {
+		auto& region = dst.emplace_back(src);
+		region.data = nullptr;
+		return;
+	}
+	if (it->size != src.size) {
+		throw MSXException("Size mismatch for '", src.name, "': ",
+		                   it->size, " vs ", src.size, " bytes.");
+	}
+	for (auto k : xrange(size_t(NUM_KINDS))) {
+		auto& d = it->counts[k];
+		const auto& s = src.counts[k];
+		if (s.empty()) continue;
+		if (d.empty()) d.resize(it->size);
+		for (auto i : xrange(it->size)) {
+			uint64_t sum = uint64_t(d[i]) + s[i];
+			d[i] = uint32_t(std::min<uint64_t>(sum, uint32_t(-1)));
+		}
+	}
+}
+
+void MemoryCoverage::save(std::ostream& os, span<const Region> regions_)
+{
+	auto writeU32 = [&](uint32_t value) {
+		byte buf[4];
+		Endian::write_UA_L32(buf, value);
+		os.write(reinterpret_cast<const char*>(buf), 4);
+	};
+	os.write(MAGIC.data(), MAGIC.size());
+	writeU32(VERSION);
+	writeU32(uint32_t(regions_.size()));
+	std::vector<byte> buf;
+	for (const auto& r : regions_) {
+		writeU32(uint32_t(r.name.size()));
+		os.write(r.name.data(), r.name.size());
+		writeU32(r.size);
+		buf.resize(4 * size_t(r.size));
+		for (const auto& c : r.counts) {
+			for (auto i : xrange(r.size)) {
+				Endian::write_UA_L32(&buf[4 * i], c.empty() ? 0 : c[i]);
+			}
+			os.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+		}
+	}
+}
+
+std::vector<MemoryCoverage::Region> MemoryCoverage::load(span<const uint8_t> buf)
+{
+	size_t pos = 0;
+	auto need = [&](size_t n) {
+		if ((buf.size() - pos) < n) {
+			throw MSXException("Coverage map is truncated.");
+		}
+	};
+	auto readU32 = [&] {
+		need(4);
+		uint32_t result = Endian::read_UA_L32(&buf[pos]);
+		pos += 4;
+		return result;
+	};
+
+	need(MAGIC.size());
+	if (std::string_view(reinterpret_cast<const char*>(buf.data()), MAGIC.size()) != MAGIC) {
+		throw MSXException("Not a coverage map.");
+	}
+	pos += MAGIC.size();
+	if (auto version = readU32(); version != VERSION) {
+		throw MSXException("Unsupported coverage map version: ", version);
+	}
+
+	std::vector<Region> result;
+	auto num = readU32();
+	for (uint32_t n = 0; n < num; ++n) {
+		auto& r = result.emplace_back();
+		auto nameSize = readU32();
+		need(nameSize);
+		r.name.assign(reinterpret_cast<const char*>(&buf[pos]), nameSize);
+		pos += nameSize;
+		r.data = nullptr;
+		r.size = readU32();
+		need(3 * 4 * size_t(r.size));
+		for (auto& c : r.counts) {
+			c.resize(r.size);
+			for (auto i : xrange(r.size)) {
+				c[i] = Endian::read_UA_L32(&buf[pos]);
+				pos += 4;
+			}
+		}
+	}
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,145 @@
+#ifndef MEMORYCOVERAGE_HH
+#define MEMORYCOVERAGE_HH
+
+#include "CacheLine.hh"
+#include "likely.hh"
+#include "openmsx.hh"
+#include "span.hh"
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+/** Counts, per byte, how often the CPU executed, read and wrote each byte
+  * of ROM and RAM.
+  *
+  * The counters are keyed on the backing store (a Rom or a Ram object)
+  * instead of on the CPU address. So code in a mapped ROM or in a memory
+  * mapper segment is attributed to the correct ROM block or RAM segment,
+  * regardless of where it was visible in the CPU address space. The
+  * backing stores register themselves with registerMemory().
+  *
+  * The CPU reports accesses with the host pointer obtained from its cache
+  * lines (see CacheLine), so collecting doesn't require leaving the fast
+  * CPU loop. A consequence is that accesses to non-cacheable memory (e.g.
+  * memory-mapped registers) are not counted. Each CPU maps its cache lines
+  * to the counters with a LineCache, so finding the region is only needed
+  * when a cache line changes.
+  */
+class MemoryCoverage
+{
+public:
+	enum Kind { EXEC, READ, WRITE, NUM_KINDS };
+
+	struct Region {
+		std::string name;
+		const byte* data; // nullptr when the backing store is removed
+		unsigned size;
+		// per kind one counter per byte, empty when never enabled
+		std::array<std::vector<uint32_t>, NUM_KINDS> counts;
+	};
+
+	/** Called by the backing stores. The counters of a removed memory are
+	  * kept (till clear() is called), so results are not lost when e.g.
+	  * a cartridge is removed. */
+	void registerMemory(std::string name, span<const byte> memory);
+	void unregisterMemory(const byte* data);
+
+	/** Allocates the counters when needed. */
+	void setEnabled(bool enabled_);
+	[[nodiscard]] bool isEnabled() const { return enabled; }
+
+	/** Reset all counters to zero. */
+	void clear();
+
+	/** 'p' points into the backing store. Does nothing for unregistered
+	  * memory. Only called when enabled. */
+	void count(Kind kind, const byte* p)
+	{
+		if ((last == size_t(-1)) || !regions[last].data ||
+		    (uintptr_t(p) - uintptr_t(regions[last].data) >= regions[last].size)) {
+			last = find(p);
+			if (last == size_t(-1)) return;
+		}
+		auto& r = regions[last];
+		auto& c = r.counts[kind][p - r.data];
+		c += (c != uint32_t(-1)); // saturate
+	}
+
+	[[nodiscard]] const std::vector<Region>& getRegions() const { return regions; }
+
+	/** Move the collected data from another instance (used when the
+	  * machine is replaced, e.g. when going back in time). */
+	void transfer(MemoryCoverage& other);
+
+	/** Binary map format (all values little endian):
+	  *   "openMSX coverage" (16 bytes), version (u32), number of regions (u32)
+	  *   per region: name length (u32), name, size (u32),
+	  *               size exec counters, size read counters and size write
+	  *               counters (all u32)
+	  */
+	static void save(std::ostream& os, span<const Region> regions);
+	/** Throws MSXException on a malformed map. The 'data' fields of the
+	  * result are nullptr. */
+	[[nodiscard]] static std::vector<Region> load(span<const uint8_t> buf);
+	/** Add the counters of 'src' to the region with the same name in
+	  * 'dst' (append a new region when there's none). Throws MSXException
+	  * when the sizes don't match. */
+	static void merge(std::vector<Region>& dst, const Region& src);
+
+	/** Per-CPU cache: for each CPU cache line the counters of the region
+	  * that backs it. An entry is recalculated when the cache line points
+	  * to another memory block, or when the regions have changed. */
+	class LineCache
+	{
+	public:
+		explicit LineCache(MemoryCoverage& coverage_)
+			: coverage(coverage_), generation(coverage.generation - 1) {}
+
+		/** 'line' is the (cacheable) CPU cache line that contains
+		  * 'address', so 'line[address]' is the accessed byte. */
+		void count(Kind kind, const byte* line, unsigned address)
+		{
+			if (unlikely(generation != coverage.generation)) reset();
+			auto& e = entries[kind][address >> CacheLine::BITS];
+			if (unlikely(e.line != line)) fill(e, kind, line, address);
+			if (likely(uintptr_t(e.counts) > 1)) {
+				auto& c = e.counts[address & CacheLine::LOW];
+				c += (c != uint32_t(-1)); // saturate
+			} else if (e.counts) {
+				coverage.count(kind, &line[address]);
+			}
+		}
+
+	private:
+		struct Entry {
+			const byte* line = nullptr;
+			// nullptr: not in a registered memory
+			// 1:       partly in a registered memory, count per byte
+			// other:   the counters for the start of the cache line
+			uint32_t* counts = nullptr;
+		};
+		void reset();
+		void fill(Entry& e, Kind kind, const byte* line, unsigned address);
+
+		MemoryCoverage& coverage;
+		std::array<std::array<Entry, CacheLine::NUM>, NUM_KINDS> entries;
+		unsigned generation;
+	};
+
+private:
+	[[nodiscard]] size_t find(const byte* p) const;
+	static void allocate(Region& region);
+
+	std::vector<Region> regions;
+	size_t last = size_t(-1); // index of the most recently used region
+	unsigned generation = 0; // changes when the LineCaches are invalid
+	bool enabled = false;
+};
+
+} // namespace openmsx
+
+#endif
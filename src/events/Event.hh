@@ -44,6 +44,10 @@ enum EventType
 	  * source. */
 	OPENMSX_FRAME_DRAWN_EVENT,
 
+	/** Sent (possibly from another thread) when a layer finished preparing
+	  * its image in the background, see Layer::isPreparing(). */
+	OPENMSX_LAYER_READY_EVENT,
+
 	OPENMSX_BREAK_EVENT,
 	OPENMSX_SWITCH_RENDERER_EVENT,
 
@@ -3,6 +3,7 @@
 #include "hash_set.hh"
 #include "xxhash.hh"
 #include <cstring>
+#include <mutex>
 
 using std::string;
 
@@ -15,6 +16,8 @@ struct GetURLFromDecompressed {
 };
 static hash_set<std::unique_ptr<CompressedFileAdapter::Decompressed>,
                 GetURLFromDecompressed, XXHasher> decompressCache;
+// Files can be opened from a FilePool (background) scan thread.
+static std::mutex decompressCacheMutex;
 
 
 CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_)
@@ -25,6 +28,7 @@ CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_)
 CompressedFileAdapter::~CompressedFileAdapter()
 {
 	if (decompressed) {
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
 		auto it = decompressCache.find(getURL());
 		assert(it != end(decompressCache));
 		assert(it->get() == decompressed);
@@ -41,16 +45,29 @@ void CompressedFileAdapter::decompress()
 	if (decompressed) return;
 
 	const std::string& url = getURL();
-	auto it = decompressCache.find(url);
-	if (it == end(decompressCache)) {
+	{
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
+		if (auto it = decompressCache.find(url); it != end(decompressCache)) {
+			++(*it)->useCount;
+			decompressed = it->get();
+		}
+	}
+	if (!decompressed) {
+		// Decompress without holding the lock, another thread may
+		// have inserted the same file in the mean time.
 		auto d = std::make_unique<Decompressed>();
 		decompress(*file, *d);
 		d->cachedModificationDate = getModificationDate();
 		d->cachedURL = url;
-		it = decompressCache.insert_noDuplicateCheck(std::move(d));
+
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
+		auto it = decompressCache.find(url);
+		if (it == end(decompressCache)) {
+			it = decompressCache.insert_noDuplicateCheck(std::move(d));
+		}
+		++(*it)->useCount;
+		decompressed = it->get();
 	}
-	++(*it)->useCount;
-	decompressed = it->get();
 
 	// close original file after successful decompress
 	file.reset();
@@ -8,6 +8,7 @@
 #include "EventDistributor.hh"
 #include "CliComm.hh"
 #include "Reactor.hh"
+#include "one_of.hh"
 #include "xrange.hh"
 #include <memory>
 
@@ -45,15 +46,23 @@ private:
 FilePool::FilePool(CommandController& controller, Reactor& reactor_)
 	: core(FileOperations::getUserDataDir() + "/.filecache",
 	       [&] { return getDirectories(); },
-	       [&](std::string_view message) { reportProgress(message); })
+	       [&](std::string_view message) { reportProgress(message); },
+	       reactor_.getWorkerPool())
 	, filePoolSetting(
 		controller, "__filepool",
 		"This is an internal setting. Don't change this directly, "
 		"instead use the 'filepool' command.",
 		initialFilePoolSettingValue())
+	, prefetchSetting(
+		controller, "filepool_prefetch",
+		"Index the filepool directories in the background (at startup "
+		"and when the filepool changes), so that searching for a file "
+		"later on is faster.",
+		false)
 	, reactor(reactor_)
 {
 	filePoolSetting.attach(*this);
+	prefetchSetting.attach(*this);
 	reactor.getEventDistributor().registerEventListener(OPENMSX_QUIT_EVENT, *this);
 
 	sha1SumCommand = std::make_unique<Sha1SumCommand>(controller, *this);
@@ -62,6 +71,7 @@ FilePool::FilePool(CommandController& controller, Reactor& reactor_)
 FilePool::~FilePool()
 {
 	reactor.getEventDistributor().unregisterEventListener(OPENMSX_QUIT_EVENT, *this);
+	prefetchSetting.detach(*this);
 	filePoolSetting.detach(*this);
 }
 
@@ -143,8 +153,15 @@ FilePoolCore::Directories FilePool::getDirectories() const
 
 void FilePool::update(const Setting& setting)
 {
-	assert(&setting == &filePoolSetting); (void)setting;
-	(void)getDirectories(); // check for syntax errors
+	assert(&setting == one_of(&filePoolSetting, &prefetchSetting));
+	if (&setting == &filePoolSetting) {
+		(void)getDirectories(); // check for syntax errors
+	}
+	if (prefetchSetting.getBoolean()) {
+		core.startPrefetch();
+	} else {
+		core.stopPrefetch();
+	}
 }
 
 void FilePool::reportProgress(std::string_view message)
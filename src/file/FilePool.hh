@@ -1,6 +1,7 @@
 #ifndef FILEPOOL_HH
 #define FILEPOOL_HH
 
+#include "BooleanSetting.hh"
 #include "EventListener.hh"
 #include "FilePoolCore.hh"
 #include "StringSetting.hh"
@@ -44,6 +45,7 @@ private:
 private:
 	FilePoolCore core;
 	StringSetting filePoolSetting;
+	BooleanSetting prefetchSetting;
 	Reactor& reactor;
 	std::unique_ptr<Sha1SumCommand> sha1SumCommand;
 	bool quit = false;
@@ -4,9 +4,12 @@
 #include "foreach_file.hh"
 #include "Date.hh"
 #include "Timer.hh"
+#include "WorkerPool.hh"
 #include "one_of.hh"
 #include "ranges.hh"
+#include <chrono>
 #include <fstream>
+#include <memory>
 #include <optional>
 #include <tuple>
 
@@ -28,25 +31,69 @@ private:
 	const FilePoolCore::Pool& pool;
 };
 
+// A file for which the sha1sum is (being) calculated on the worker pool.
+struct FilePoolCore::HashJob {
+	std::string filename;
+	time_t time;
+	Sha1Sum sum;
+	File file; // only kept open when 'sum' is the searched sha1sum
+	bool ok = false; // false when there was an error reading the file
+	bool skipped = false; // scan was aborted before the job started
+};
+
+// State of one scan over (part of) the filepool directories, either a
+// search for a specific sha1sum (in the foreground) or a prefetch (in
+// the background).
+struct FilePoolCore::ScanState {
+	ScanState(const Sha1Sum* sha1sum_, bool background_, WorkerPool& workers_)
+		: sha1sum(sha1sum_), background(background_), workers(workers_)
+	{
+		// Timer::getTime() is not thread safe (and the background
+		// scan doesn't report progress anyway).
+		progress.lastTime = background ? 0 : Timer::getTime();
+		progress.amountScanned = 0;
+	}
+
+	const Sha1Sum* sha1sum; // nullptr when not searching for a specific file
+	const bool background;
+	WorkerPool& workers;
+	std::string_view poolPath;
+	ScanProgress progress;
+	// Directories that were modified in the same second as (or after)
+	// the start of the scan can still change without changing their
+	// modification time, don't trust those.
+	time_t startTime = time(nullptr);
+	File result;
+	std::vector<std::unique_ptr<HashJob>> jobs;
+	// Fully scanned directories, only added to 'dirInfos' once all their
+	// files are added to the database.
+	std::vector<std::pair<std::string, DirInfo>> pendingDirs;
+};
+
 
 FilePoolCore::FilePoolCore(string filecache_,
                            std::function<Directories()> getDirectories_,
-                           std::function<void(std::string_view)> reportProgress_)
+                           std::function<void(std::string_view)> reportProgress_,
+                           WorkerPool& workerPool_)
 	: filecache(std::move(filecache_))
 	, getDirectories(getDirectories_)
 	, reportProgress(reportProgress_)
+	, workerPool(workerPool_)
 {
 	try {
 		readSha1sums();
 	} catch (MSXException&) {
 		// ignore, probably .filecache doesn't exist yet
 	}
+	readDirInfos();
 }
 
 FilePoolCore::~FilePoolCore()
 {
+	stopPrefetch();
 	if (needWrite) {
 		writeSha1sums();
+		writeDirInfos();
 	}
 }
 
@@ -245,27 +292,177 @@ void FilePoolCore::writeSha1sums()
 	}
 }
 
+// The directory summaries are stored next to the '.filecache' file (that
+// file keeps its original format). Each directory is one line with its
+// modification time and its full path, followed by one line per file and
+// per subdirectory: a tab followed by the name of that file, or by the name
+// of that subdirectory plus a slash.
+void FilePoolCore::readDirInfos()
+{
+	std::string buf;
+	try {
+		File file(filecache + ".dirs");
+		buf.resize(file.getSize());
+		file.read(buf.data(), buf.size());
+	} catch (MSXException&) {
+		return; // ignore, probably doesn't exist yet
+	}
+
+	DirInfo* current = nullptr;
+	std::string_view data = buf;
+	while (!data.empty()) {
+		auto eol = data.find('\n');
+		auto line = data.substr(0, eol);
+		data = (eol == std::string_view::npos) ? std::string_view() : data.substr(eol + 1);
+		if (!line.empty() && (line.back() == '\r')) line.remove_suffix(1);
+		if (line.empty()) continue;
+
+		if (line[0] == '\t') {
+			if (!current) continue;
+			auto name = line.substr(1);
+			if (!name.empty() && (name.back() == '/')) {
+				name.remove_suffix(1);
+				current->subDirs.emplace_back(name);
+			} else {
+				current->files.emplace_back(name);
+			}
+			continue;
+		}
+		current = nullptr;
+		if ((line.size() <= 26) || (line[24] != ' ') || (line[25] != ' ')) {
+			continue; // invalid line, ignore
+		}
+		auto time = Date::fromString(std::string(line.substr(0, 24)).c_str());
+		if (time == Date::INVALID_TIME_T) continue;
+		current = &dirInfos[std::string(line.substr(26))];
+		current->time = time;
+		current->subDirs.clear();
+		current->files.clear();
+	}
+}
+
+void FilePoolCore::writeDirInfos()
+{
+	std::ofstream file;
+	FileOperations::openofstream(file, filecache + ".dirs");
+	if (!file.is_open()) {
+		return;
+	}
+	for (const auto& [path, info] : dirInfos) {
+		file << Date::toString(info.time) << "  " << path << '\n';
+		for (const auto& name : info.files) {
+			file << '\t' << name << '\n';
+		}
+		for (const auto& sub : info.subDirs) {
+			file << '\t' << sub << "/\n";
+		}
+	}
+}
+
 File FilePoolCore::getFile(FileType fileType, const Sha1Sum& sha1sum)
 {
-	File result = getFromPool(sha1sum);
+	std::unique_lock<std::mutex> lock(mutex);
+	File result = getFromPool(sha1sum, lock);
 	if (result.is_open()) return result;
 
-	// not found in cache, need to scan directories
 	stop = false;
-	ScanProgress progress;
-	progress.lastTime = Timer::getTime();
-	progress.amountScanned = 0;
+	if (prefetching) {
+		// The background scan will likely encounter the requested
+		// file, wait for it (but not for the rest of the scan).
+		auto lastReport = Timer::getTime();
+		while (prefetching) {
+			prefetchProgress.wait_for(lock, std::chrono::milliseconds(250));
+			result = getFromPool(sha1sum, lock);
+			if (result.is_open()) return result;
+
+			auto now = Timer::getTime();
+			if (now > (lastReport + 250'000)) { // 4Hz
+				lastReport = now;
+				lock.unlock();
+				reportProgress(tmpStrCat(
+				        "Searching for file with sha1sum ",
+				        sha1sum.toString(), "...\nIndexing filepool"));
+				lock.lock();
+			}
+			if (stop) return result; // not found
+		}
+		// Prefetch finished without finding the file, the scan below
+		// is fast because the database is now up-to-date.
+	}
+	// The scan below only locks the database while accessing it.
+	lock.unlock();
 
+	// not found in cache, need to scan directories
+	ScanState state(&sha1sum, false, workerPool);
 	for (auto& [path, types] : getDirectories()) {
 		if ((types & fileType) != FileType::NONE) {
-			result = scanDirectory(sha1sum, FileOperations::expandTilde(string(path)), path, progress);
-			if (result.is_open()) return result;
+			state.poolPath = path;
+			scanDirectory(FileOperations::expandTilde(string(path)), state);
+			if (state.result.is_open() || isAborted(state)) break;
 		}
 	}
+	flushJobs(state);
+	return std::move(state.result); // possibly not found
+}
+
+void FilePoolCore::startPrefetch()
+{
+	stopPrefetch();
+
+	// Copy the directories, the background thread shouldn't access the
+	// 'getDirectories' callback.
+	std::vector<std::pair<std::string, std::string>> directories;
+	for (auto& [path, types] : getDirectories()) {
+		directories.emplace_back(FileOperations::expandTilde(string(path)), path);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		prefetching = true;
+	}
+	exitPrefetch = false;
+	prefetchThread = std::thread([this, directories = std::move(directories)] {
+		prefetch(directories);
+	});
+}
+
+void FilePoolCore::stopPrefetch()
+{
+	if (!prefetchThread.joinable()) return;
+	exitPrefetch = true;
+	prefetchThread.join();
+}
+
+void FilePoolCore::prefetch(const std::vector<std::pair<std::string, std::string>>& directories)
+{
+	ScanState state(nullptr, true, workerPool);
+	for (auto& [directory, poolPath] : directories) {
+		state.poolPath = poolPath;
+		scanDirectory(directory, state);
+		if (isAborted(state)) break;
+	}
+	flushJobs(state);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		prefetching = false;
+	}
+	prefetchProgress.notify_all();
+}
+
+bool FilePoolCore::isAborted(const ScanState& state) const
+{
+	// Scanning can take a long time. Allow to exit openmsx when it takes
+	// too long. Stop scanning by pretending we didn't find the file.
+	return state.background ? exitPrefetch.load() : stop.load();
+}
 
-	return result; // not found
+std::unique_lock<std::mutex> FilePoolCore::lockDatabase(const ScanState& /*state*/)
+{
+	return std::unique_lock<std::mutex>(mutex);
 }
 
+// Must be called without holding the database lock: this reports progress.
 Sha1Sum FilePoolCore::calcSha1sum(File& file)
 {
 	// Calculate sha1 in several steps so that we can show progress
@@ -308,12 +505,15 @@ Sha1Sum FilePoolCore::calcSha1sum(File& file)
 	return sha1.digest();
 }
 
-File FilePoolCore::getFromPool(const Sha1Sum& sha1sum)
+File FilePoolCore::getFromPool(const Sha1Sum& sha1sum, std::unique_lock<std::mutex>& lock)
 {
-	auto [b, e] = ranges::equal_range(sha1Index, sha1sum, CompareSha1(pool));
-	// use indices instead of iterators
-	auto i    = distance(begin(sha1Index), b);
-	auto last = distance(begin(sha1Index), e);
+	auto findRange = [&] {
+		auto [b, e] = ranges::equal_range(sha1Index, sha1sum, CompareSha1(pool));
+		// use indices instead of iterators
+		return std::pair(distance(begin(sha1Index), b),
+		                 distance(begin(sha1Index), e));
+	};
+	auto [i, last] = findRange();
 	while (i != last) {
 		auto it = begin(sha1Index) + i;
 		auto& entry = pool[*it];
@@ -324,116 +524,233 @@ File FilePoolCore::getFromPool(const Sha1Sum& sha1sum)
 			--last;
 			continue;
 		}
+		string filename(entry.filename);
+		File file;
+		time_t newTime;
 		try {
-			File file(string(entry.filename));
-			auto newTime = file.getModificationDate();
-			if (entry.getTime() == newTime) {
-				// When modification time is unchanged, assume
-				// sha1sum is also unchanged. So avoid
-				// expensive sha1sum calculation.
-				return file;
-			}
-			entry.setTime(newTime); // update timestamp
-			needWrite = true;
-			auto newSum = calcSha1sum(file);
-			if (newSum == sha1sum) {
-				// Modification time was changed, but
-				// (recalculated) sha1sum is still the same.
-				return file;
-			}
-			// Sha1sum has changed: update sha1sum, move entry to
-			// new position new sum and continue searching.
-			if (adjustSha1(it, entry, newSum)) {
-				// after
-				--last; // no ++i
-			} else {
-				// before (or at)
-				++i;
-			}
+			file = File(filename);
+			newTime = file.getModificationDate();
 		} catch (FileException&) {
 			// Error reading file: remove from db and continue
 			// searching.
 			remove(it);
 			--last;
+			continue;
+		}
+		if (entry.getTime() == newTime) {
+			// When modification time is unchanged, assume
+			// sha1sum is also unchanged. So avoid
+			// expensive sha1sum calculation.
+			return file;
+		}
+
+		// Recalculate the sha1sum. This reports progress, so release
+		// the lock meanwhile. Afterwards the entry must be looked up
+		// again, a prefetch may have changed the database.
+		std::optional<Sha1Sum> newSum;
+		lock.unlock();
+		try {
+			newSum = calcSha1sum(file);
+		} catch (FileException&) {
+			// handled below
+		}
+		lock.lock();
+		auto [idx, current] = findInDatabase(filename);
+		if (idx != Index(-1)) {
+			if (!newSum) {
+				// Error reading file: remove from db.
+				remove(idx, *current);
+			} else {
+				current->setTime(newTime); // update timestamp
+				needWrite = true;
+				if (current->sum != *newSum) {
+					adjustSha1(idx, *current, *newSum);
+				}
+			}
+		}
+		if (newSum && (*newSum == sha1sum)) {
+			// Modification time was changed, but
+			// (recalculated) sha1sum is still the same.
+			return file;
 		}
+		// Sha1sum has changed (so the entry moved out of the searched
+		// range) or the file was removed: continue searching.
+		std::tie(i, last) = findRange();
 	}
 	return File(); // not found
 }
 
-File FilePoolCore::scanDirectory(
-	const Sha1Sum& sha1sum, const string& directory, std::string_view poolPath,
-	ScanProgress& progress)
+void FilePoolCore::scanDirectory(const string& directory, ScanState& state)
 {
-	File result;
-	auto fileAction = [&](const std::string& path, const FileOperations::Stat& st) {
-		if (stop) {
-			// Scanning can take a long time. Allow to exit
-			// openmsx when it takes too long. Stop scanning
-			// by pretending we didn't find the file.
-			assert(!result.is_open());
-			return false; // abort foreach_file_recursive
+	if (isAborted(state) || state.result.is_open()) return;
+
+	FileOperations::Stat st;
+	if (!FileOperations::getStat(directory, st)) return;
+	auto time = FileOperations::getModificationDate(st);
+
+	// When the directory itself didn't change, no files were added,
+	// removed or renamed in it. Then only the known files are checked
+	// (a file can still be overwritten in-place), that avoids reading the
+	// directory itself.
+	std::vector<string> subDirs;
+	std::vector<string> files;
+	bool unchanged = [&] {
+		auto lock = lockDatabase(state);
+		auto it = dirInfos.find(directory);
+		if ((it == end(dirInfos)) || (it->second.time != time)) return false;
+		subDirs = it->second.subDirs;
+		files = it->second.files;
+		return true;
+	}();
+
+	if (unchanged) {
+		for (const auto& name : files) {
+			if (isAborted(state)) return;
+			auto path = strCat(directory, '/', name);
+			FileOperations::Stat fst;
+			if (!FileOperations::getStat(path, fst)) continue;
+			if (FileOperations::isDirectory(fst)) {
+				// unmarked subdirectory (older '.dirs' format)
+				subDirs.push_back(name);
+				continue;
+			}
+			if (!FileOperations::isRegularFile(fst)) continue;
+			scanFile(path, fst, state);
+			if (state.result.is_open()) return;
 		}
-		result = scanFile(sha1sum, path, st, poolPath, progress);
-		return !result.is_open(); // abort traversal when found
-	};
-	foreach_file_recursive(directory, fileAction);
-	return result;
+	} else {
+		bool completed = foreach_file_and_directory(directory,
+			[&](const string& path, std::string_view name, const FileOperations::Stat& fst) {
+				if (isAborted(state)) return false;
+				files.emplace_back(name);
+				scanFile(path, fst, state);
+				return !state.result.is_open(); // abort traversal when found
+			},
+			[&](const string& /*path*/, std::string_view name) {
+				subDirs.emplace_back(name);
+			});
+		if (!completed) return;
+		if (time < state.startTime) {
+			state.pendingDirs.emplace_back(directory, DirInfo{time, subDirs, files});
+		}
+	}
+
+	for (const auto& sub : subDirs) {
+		scanDirectory(strCat(directory, '/', sub), state);
+		if (isAborted(state) || state.result.is_open()) return;
+	}
 }
 
-File FilePoolCore::scanFile(const Sha1Sum& sha1sum, const string& filename,
-                            const FileOperations::Stat& st, std::string_view poolPath,
-                            ScanProgress& progress)
+void FilePoolCore::scanFile(const string& filename, const FileOperations::Stat& st,
+                            ScanState& state)
 {
-	++progress.amountScanned;
-	// Periodically send a progress message with the current filename
-	auto now = Timer::getTime();
-	if (now > (progress.lastTime + 250'000)) { // 4Hz
-		progress.lastTime = now;
-		reportProgress(tmpStrCat(
-		        "Searching for file with sha1sum ", sha1sum.toString(),
-		        "...\nIndexing filepool ", poolPath, ": [",
-		        progress.amountScanned, "]: ",
-		        std::string_view(filename).substr(poolPath.size())));
-	}
+	++state.progress.amountScanned;
+	reportScanProgress(state, filename);
 
 	auto time = FileOperations::getModificationDate(st);
-	if (auto [idx, entry] = findInDatabase(filename); idx == Index(-1)) {
-		// not in pool
+	{
+		auto lock = lockDatabase(state);
+		if (auto [idx, entry] = findInDatabase(filename); idx != Index(-1)) {
+			assert(filename == entry->filename);
+			if (entry->getTime() == time) {
+				// db is still up to date
+				if (state.sha1sum && (entry->sum == *state.sha1sum)) {
+					try {
+						state.result = File(filename);
+					} catch (FileException&) {
+						// error reading file, remove from db
+						remove(idx, *entry);
+					}
+				}
+				return;
+			}
+		}
+	}
+
+	// Not in pool or db outdated: (re)calculate the sha1sum on the worker
+	// pool. The database is only updated in flushJobs().
+	auto& job = *state.jobs.emplace_back(std::make_unique<HashJob>());
+	job.filename = filename;
+	job.time = time;
+	// The jobs of one scan form a group, see flushJobs().
+	state.workers.submit([this, &job, &state] {
+		if (isAborted(state)) {
+			// Don't start hashing (possibly big) files anymore.
+			job.skipped = true;
+			return;
+		}
+		auto* target = state.sha1sum;
 		try {
-			File file(filename);
-			auto sum = calcSha1sum(file);
-			insert(sum, time, filename);
-			if (sum == sha1sum) {
-				return file;
+			File file(job.filename);
+			job.sum = SHA1::calc(file.mmap());
+			job.ok = true;
+			if (target && (job.sum == *target)) {
+				job.file = std::move(file);
 			}
 		} catch (FileException&) {
 			// ignore
 		}
-	} else {
-		// already in pool
-		assert(filename == entry->filename);
-		try {
-			if (entry->getTime() == time) {
-				// db is still up to date
-				if (entry->sum == sha1sum) {
-					return File(filename);
-				}
+	}, &state);
+	// Bound the amount of outstanding work, and don't delay finding the
+	// searched file too much.
+	if (state.jobs.size() >= 4 * state.workers.getNumThreads()) {
+		flushJobs(state);
+	}
+}
+
+void FilePoolCore::flushJobs(ScanState& state)
+{
+	// The pool is shared with unrelated work. Waiting for the group runs
+	// the jobs that didn't start yet on this thread, so a scan never
+	// waits behind other jobs.
+	state.workers.wait(&state);
+
+	{
+		auto lock = lockDatabase(state);
+		for (auto& job : state.jobs) {
+			if (job->skipped) continue;
+			auto [idx, entry] = findInDatabase(job->filename);
+			if (!job->ok) {
+				// error reading file, remove from db
+				if (idx != Index(-1)) remove(idx, *entry);
+				continue;
+			}
+			if (idx == Index(-1)) {
+				insert(job->sum, job->time, job->filename);
 			} else {
-				// db outdated
-				File file(filename);
-				auto sum = calcSha1sum(file);
-				entry->setTime(time);
-				adjustSha1(idx, *entry, sum);
-				if (sum == sha1sum) {
-					return file;
-				}
+				entry->setTime(job->time);
+				adjustSha1(idx, *entry, job->sum);
 			}
-		} catch (FileException&) {
-			// error reading file, remove from db
-			remove(idx, *entry);
+			if (job->file.is_open() && !state.result.is_open()) {
+				state.result = std::move(job->file);
+			}
+		}
+		for (auto& [path, info] : state.pendingDirs) {
+			dirInfos[std::move(path)] = std::move(info);
+			needWrite = true;
 		}
 	}
-	return File(); // not found
+	state.jobs.clear();
+	state.pendingDirs.clear();
+	if (state.background) prefetchProgress.notify_all();
+}
+
+void FilePoolCore::reportScanProgress(ScanState& state, std::string_view filename)
+{
+	// Only the foreground scan reports progress, the callback is not
+	// thread safe.
+	if (state.background) return;
+
+	// Periodically send a progress message with the current filename
+	auto now = Timer::getTime();
+	if (now > (state.progress.lastTime + 250'000)) { // 4Hz
+		state.progress.lastTime = now;
+		reportProgress(tmpStrCat(
+		        "Searching for file with sha1sum ", state.sha1sum->toString(),
+		        "...\nIndexing filepool ", state.poolPath, ": [",
+		        state.progress.amountScanned, "]: ",
+		        filename.substr(state.poolPath.size())));
+	}
 }
 
 std::pair<FilePoolCore::Index, FilePoolCore::Entry*> FilePoolCore::findInDatabase(std::string_view filename)
@@ -454,11 +771,11 @@ std::pair<FilePoolCore::Index, FilePoolCore::Entry*> FilePoolCore::findInDatabas
 
 Sha1Sum FilePoolCore::getSha1Sum(File& file)
 {
+	std::unique_lock<std::mutex> lock(mutex);
 	auto time = file.getModificationDate();
 	const std::string& filename = file.getURL();
 
-	auto [idx, entry] = findInDatabase(filename);
-	if (idx != Index(-1)) {
+	if (auto [idx, entry] = findInDatabase(filename); idx != Index(-1)) {
 		if (entry->getTime() == time) {
 			// in database and modification time matches,
 			// assume sha1sum also matches
@@ -467,7 +784,11 @@ Sha1Sum FilePoolCore::getSha1Sum(File& file)
 	}
 
 	// not in database or timestamp mismatch
+	// (calculating reports progress, don't hold the lock meanwhile)
+	lock.unlock();
 	auto sum = calcSha1sum(file);
+	lock.lock();
+	auto [idx, entry] = findInDatabase(filename);
 	if (idx == Index(-1)) {
 		// was not yet in database, insert new entry
 		insert(sum, time, filename);
@@ -5,19 +5,26 @@
 #include "ObjectPool.hh"
 #include "MemBuffer.hh"
 #include "SimpleHashSet.hh"
+#include "hash_map.hh"
 #include "sha1.hh"
 #include "xxhash.hh"
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace openmsx {
 
 class File;
+class WorkerPool;
 
 enum class FileType {
 	NONE = 0,
@@ -44,9 +51,11 @@ public:
 	using Directories = std::vector<Dir>;
 
 public:
+	/** @param workerPool Calculates the sha1sums, in parallel. */
 	FilePoolCore(std::string filecache,
 	             std::function<Directories()> getDirectories,
-	             std::function<void(std::string_view)> reportProgress);
+	             std::function<void(std::string_view)> reportProgress,
+	             WorkerPool& workerPool);
 	~FilePoolCore();
 
 	/** Search file with the given sha1sum.
@@ -67,11 +76,35 @@ public:
 	 */
 	void abort() { stop = true; }
 
+	/** Scan all directories in a background thread, so that later calls
+	 * to getFile() don't have to (the cache is brought up-to-date). If a
+	 * getFile() call can't be resolved from the cache while this scan is
+	 * still running, it waits until the requested file is found (or
+	 * until the scan has finished), not for the whole scan.
+	 * A prefetch that's still running is restarted.
+	 */
+	void startPrefetch();
+
+	/** Stop a running prefetch (if any), waits till it has stopped.
+	 * What was already scanned is kept in the database.
+	 */
+	void stopPrefetch();
+
 private:
 	struct ScanProgress {
 		uint64_t lastTime;
 		unsigned amountScanned;
 	};
+	struct ScanState;
+	struct HashJob;
+
+	// Per directory, used to skip directories that didn't change since
+	// the previous scan.
+	struct DirInfo {
+		time_t time = Date::INVALID_TIME_T; // modification time of the directory
+		std::vector<std::string> subDirs; // names, not full paths
+		std::vector<std::string> files; // names of the regular files
+	};
 
 	struct Entry {
 		Entry(const Sha1Sum& s, time_t t, std::string_view f)
@@ -136,19 +169,19 @@ private:
 
 	void readSha1sums();
 	void writeSha1sums();
-
-	[[nodiscard]] File getFromPool(const Sha1Sum& sha1sum);
-	[[nodiscard]] File scanDirectory(
-		const Sha1Sum& sha1sum,
-	        const std::string& directory,
-	        std::string_view poolPath,
-	        ScanProgress& progress);
-	[[nodiscard]] File scanFile(
-		const Sha1Sum& sha1sum,
-	        const std::string& filename,
-	        const FileOperations::Stat& st,
-	        std::string_view poolPath,
-	        ScanProgress& progress);
+	void readDirInfos();
+	void writeDirInfos();
+
+	[[nodiscard]] File getFromPool(const Sha1Sum& sha1sum, std::unique_lock<std::mutex>& lock);
+	void scanDirectory(const std::string& directory, ScanState& state);
+	void scanFile(const std::string& filename,
+	              const FileOperations::Stat& st,
+	              ScanState& state);
+	void flushJobs(ScanState& state);
+	void reportScanProgress(ScanState& state, std::string_view filename);
+	[[nodiscard]] bool isAborted(const ScanState& state) const;
+	[[nodiscard]] std::unique_lock<std::mutex> lockDatabase(const ScanState& state);
+	void prefetch(const std::vector<std::pair<std::string, std::string>>& directories);
 	[[nodiscard]] Sha1Sum calcSha1sum(File& file);
 	[[nodiscard]] std::pair<Index, Entry*> findInDatabase(std::string_view filename);
 
@@ -163,8 +196,22 @@ private:
 	Pool pool; // the actual entries
 	Sha1Index sha1Index; // entries accessible via sha1, sorted on 'CompareSha1'
 	FilenameIndex filenameIndex{FilenameIndexHash(pool), FilenameIndexEqual(pool)}; // accessible via filename
-
-	bool stop = false; // abort long search (set via reportProgress callback)
+	hash_map<std::string, DirInfo, XXHasher> dirInfos; // indexed by full path
+
+	WorkerPool& workerPool;
+
+	// Background scan (prefetch). 'mutex' protects all the database
+	// structures above (plus 'needWrite' and 'prefetching'). It's never
+	// held while calling 'reportProgress', that callback may re-enter
+	// this class. 'prefetchProgress' is notified each time the prefetch
+	// thread added entries to the database.
+	std::mutex mutex;
+	std::condition_variable prefetchProgress;
+	std::thread prefetchThread;
+	std::atomic<bool> exitPrefetch = false;
+	bool prefetching = false;
+
+	std::atomic<bool> stop = false; // abort long search (set via reportProgress callback)
 	bool needWrite = false; // dirty '.filecache'? write on exit
 
 	friend class CompareSha1;
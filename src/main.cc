@@ -125,7 +125,9 @@ static int main(int argc, char **argv)
 				// 'ext gfx9000'.
 				reactor.getEventDistributor().deliverEvents();
 			}
-			if (parseStatus != CommandLineParser::TEST) {
+			if (parseStatus == CommandLineParser::BATCH) {
+				reactor.run(parser);
+			} else if (parseStatus != CommandLineParser::TEST) {
 				CliServer cliServer(reactor.getCommandController(),
 				                    reactor.getEventDistributor(),
 				                    reactor.getGlobalCliComm());
@@ -53,8 +53,11 @@ const byte* CheckedRam::getReadCacheLine(unsigned addr) const
 
 byte* CheckedRam::getWriteCacheLine(unsigned addr) const
 {
-	return (completely_initialized_cacheline[addr >> CacheLine::BITS])
-	     ? const_cast<byte*>(&ram[addr]) : nullptr;
+	if (!completely_initialized_cacheline[addr >> CacheLine::BITS]) {
+		return nullptr;
+	}
+	ram.getDirtyPages().pin(addr, CacheLine::SIZE);
+	return const_cast<byte*>(&ram[addr]);
 }
 
 byte* CheckedRam::getRWCacheLines(unsigned addr, unsigned size) const
@@ -67,6 +70,7 @@ byte* CheckedRam::getRWCacheLines(unsigned addr, unsigned size) const
 			return nullptr;
 		}
 	}
+	ram.getDirtyPages().pin(addr, size);
 	return const_cast<byte*>(&ram[addr]);
 }
 
@@ -89,6 +93,7 @@ void CheckedRam::write(unsigned addr, const byte value)
 		}
 	}
 	ram[addr] = value;
+	ram.getDirtyPages().markDirty(addr);
 }
 
 void CheckedRam::clear()
@@ -97,6 +102,16 @@ void CheckedRam::clear()
 	init();
 }
 
+void CheckedRam::enableDirtyTracking()
+{
+	static_assert(DirtyPages::PAGE_SIZE <= CacheLine::SIZE);
+	ram.getDirtyPages().enable([this] {
+		// We don't know where (in which slots) this Ram is visible,
+		// so revoke all direct write access.
+		msxcpu.invalidateAllSlotsRWCache(0, 0x10000);
+	});
+}
+
 void CheckedRam::init()
 {
 	if (umrCallback.getValue().empty()) {
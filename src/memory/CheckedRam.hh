@@ -42,6 +42,11 @@ public:
 	[[nodiscard]] unsigned getSize() const { return ram.getSize(); }
 	void clear();
 
+	/** Track the modified pages of this Ram (see DirtyPages). Only enable
+	  * this when all writes go via this class (and not via
+	  * getUncheckedRam()). */
+	void enableDirtyTracking();
+
 	/**
 	 * Give access to the unchecked Ram. No problem to use it, but there
 	 * will just be no checking done! Keep in mind that you should use this
@@ -6,6 +6,7 @@ namespace openmsx {
 MSXMemoryMapper::MSXMemoryMapper(const DeviceConfig& config)
 	: MSXMemoryMapperBase(config)
 {
+	checkedRam.enableDirtyTracking();
 }
 
 void MSXMemoryMapper::writeIO(word port, byte value, EmuTime::param time)
@@ -30,6 +30,7 @@ void MSXRam::init()
 
 	checkedRam = std::make_unique<CheckedRam>(
 		getDeviceConfig2(), getName(), "ram", size);
+	checkedRam->enableDirtyTracking();
 }
 
 void MSXRam::powerUp(EmuTime::param /*time*/)
@@ -1,5 +1,7 @@
 #include "Ram.hh"
 #include "DeviceConfig.hh"
+#include "Debugger.hh"
+#include "MSXMotherBoard.hh"
 #include "SimpleDebuggable.hh"
 #include "XMLElement.hh"
 #include "Base64.hh"
@@ -21,6 +23,7 @@ class RamDebuggable final : public SimpleDebuggable
 public:
 	RamDebuggable(MSXMotherBoard& motherBoard, const string& name,
 	              static_string_view description, Ram& ram);
+	~RamDebuggable();
 	byte read(unsigned address) override;
 	void write(unsigned address, byte value) override;
 private:
@@ -33,6 +36,7 @@ Ram::Ram(const DeviceConfig& config, const string& name,
 	: xml(*config.getXML())
 	, ram(size_)
 	, size(size_)
+	, dirtyPages(size_)
 	, debuggable(std::make_unique<RamDebuggable>(
 		config.getMotherBoard(), name, description, *this))
 {
@@ -43,6 +47,7 @@ Ram::Ram(const XMLElement& xml_, unsigned size_)
 	: xml(xml_)
 	, ram(size_)
 	, size(size_)
+	, dirtyPages(size_)
 {
 	clear();
 }
@@ -90,7 +95,7 @@ void Ram::clear(byte c)
 		// no init pattern specified
 		memset(ram.data(), c, size);
 	}
-
+	dirtyPages.markAllDirty();
 }
 
 const string& Ram::getName() const
@@ -104,6 +109,13 @@ RamDebuggable::RamDebuggable(MSXMotherBoard& motherBoard_,
 	: SimpleDebuggable(motherBoard_, name_, description_, ram_.getSize())
 	, ram(ram_)
 {
+	getMotherBoard().getDebugger().getMemoryCoverage().registerMemory(
+		name_, span<const byte>(&ram[0], ram.getSize()));
+}
+
+RamDebuggable::~RamDebuggable()
+{
+	getMotherBoard().getDebugger().getMemoryCoverage().unregisterMemory(&ram[0]);
 }
 
 byte RamDebuggable::read(unsigned address)
@@ -114,13 +126,14 @@ byte RamDebuggable::read(unsigned address)
 void RamDebuggable::write(unsigned address, byte value)
 {
 	ram[address] = value;
+	ram.getDirtyPages().markDirty(address);
 }
 
 
 template<typename Archive>
 void Ram::serialize(Archive& ar, unsigned /*version*/)
 {
-	ar.serialize_blob("ram", ram.data(), size);
+	ar.serialize_blob("ram", ram.data(), size, dirtyPages);
 }
 INSTANTIATE_SERIALIZE_METHODS(Ram);
 
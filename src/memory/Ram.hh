@@ -1,6 +1,7 @@
 #ifndef RAM_HH
 #define RAM_HH
 
+#include "DirtyPages.hh"
 #include "MemBuffer.hh"
 #include "openmsx.hh"
 #include "static_string_view.hh"
@@ -38,6 +39,10 @@ public:
 	[[nodiscard]] const std::string& getName() const;
 	void clear(byte c = 0xff);
 
+	/** Administration of modified pages, used to speed up reverse
+	  * snapshots. Disabled by default, see DirtyPages for details. */
+	[[nodiscard]] DirtyPages& getDirtyPages() const { return dirtyPages; }
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -45,6 +50,7 @@ private:
 	const XMLElement& xml;
 	MemBuffer<byte> ram;
 	unsigned size; // must come before debuggable
+	mutable DirtyPages dirtyPages; // only administration, not the content
 	const std::unique_ptr<RamDebuggable> debuggable; // can be nullptr
 };
 
@@ -41,9 +41,11 @@ public:
 	[[nodiscard]] byte read(unsigned address) override;
 	void write(unsigned address, byte value) override;
 	void moved(Rom& r);
+	void dataChanged();
 private:
 	Debugger& debugger;
 	Rom* rom;
+	const byte* data; // as registered in MemoryCoverage
 };
 
 
@@ -385,16 +387,20 @@ void Rom::addPadding(unsigned newSize, byte filler)
 	extendedRom = std::move(tmp);
 	rom = newData;
 	size = newSize;
+	if (romDebuggable) romDebuggable->dataChanged();
 }
 
 RomDebuggable::RomDebuggable(Debugger& debugger_, Rom& rom_)
-	: debugger(debugger_), rom(&rom_)
+	: debugger(debugger_), rom(&rom_), data(&(*rom)[0])
 {
 	debugger.registerDebuggable(rom->getName(), *this);
+	debugger.getMemoryCoverage().registerMemory(
+		rom->getName(), span<const byte>(data, rom->getSize()));
 }
 
 RomDebuggable::~RomDebuggable()
 {
+	debugger.getMemoryCoverage().unregisterMemory(data);
 	debugger.unregisterDebuggable(rom->getName(), *this);
 }
 
@@ -424,4 +430,12 @@ void RomDebuggable::moved(Rom& r)
 	rom = &r;
 }
 
+void RomDebuggable::dataChanged()
+{
+	auto& coverage = debugger.getMemoryCoverage();
+	coverage.unregisterMemory(data);
+	data = &(*rom)[0];
+	coverage.registerMemory(rom->getName(), span<const byte>(data, rom->getSize()));
+}
+
 } // namespace openmsx
@@ -2,20 +2,27 @@
 #include "RomInfo.hh"
 #include "FileContext.hh"
 #include "File.hh"
+#include "FileException.hh"
 #include "FileOperations.hh"
 #include "CliComm.hh"
 #include "MSXException.hh"
 #include "StringOp.hh"
 #include "String32.hh"
+#include "Version.hh"
 #include "hash_map.hh"
 #include "ranges.hh"
 #include "rapidsax.hh"
 #include "unreachable.hh"
 #include "stl.hh"
 #include "view.hh"
+#include "xrange.hh"
 #include "xxhash.hh"
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
 
 using std::string;
 using std::string_view;
@@ -567,10 +574,39 @@ static void parseDB(CliComm& cliComm, char* buf, char* bufStart,
 	}
 }
 
+// The cache file starts with this header, followed by the (sorted) array
+// of entries and then the string table.
+struct CacheHeader {
+	char magic[8];
+	uint64_t checksum; // of the xml files (and the openMSX version)
+	uint32_t entrySize; // detects builds with a different layout
+	uint32_t numEntries;
+	uint32_t stringsSize;
+	uint32_t padding;
+};
+static_assert(sizeof(CacheHeader) == 32);
+static_assert(std::is_trivially_copyable_v<RomDatabase::Entry>);
+static constexpr char CACHE_MAGIC[8] = {'o','M','S','X','s','d','b','1'};
+
+// String32 is a pointer on 32-bit systems, such an index can't be stored.
+static constexpr bool CACHE_SUPPORTED = std::is_same_v<String32, uint32_t>;
+
+static uint64_t calcChecksum(vector<File>& files)
+{
+	// RomType values (and the layout of Entry) can change between
+	// openMSX versions, so the version is part of the checksum.
+	uint64_t result = xxhash(Version::full());
+	for (auto& file : files) {
+		auto data = file.mmap();
+		uint64_t h = xxhash_impl<false>(data.data(), data.size());
+		result = result * 0x9E3779B97F4A7C15ULL + ((uint64_t(data.size()) << 32) | h);
+		file.munmap();
+	}
+	return result;
+}
+
 RomDatabase::RomDatabase(CliComm& cliComm)
 {
-	db.reserve(3500);
-	UnknownTypes unknownTypes;
 	// first user- then system-directory
 	vector<string> paths = systemFileContext().getPaths();
 	vector<File> files;
@@ -586,17 +622,32 @@ RomDatabase::RomDatabase(CliComm& cliComm)
 			// warning, but that's done below.
 		}
 	}
-	buffer.resize(bufferSize);
+
+	uint64_t checksum = 0;
+	string cacheName = FileOperations::getUserDataDir() + "/.softwaredb.cache";
+	if (CACHE_SUPPORTED && !files.empty()) {
+		try {
+			checksum = calcChecksum(files);
+			if (loadCache(cacheName, checksum)) return;
+		} catch (MSXException& /*e*/) {
+			// Ignore, just parse the xml files.
+		}
+	}
+
+	RomDB db;
+	db.reserve(3500);
+	UnknownTypes unknownTypes;
+	MemBuffer<char> xmlBuffer(bufferSize);
 	size_t bufferOffset = 0;
 	for (auto& file : files) {
 		try {
 			auto size = file.getSize();
-			auto* buf = &buffer[bufferOffset];
+			auto* buf = &xmlBuffer[bufferOffset];
 			bufferOffset += size + rapidsax::EXTRA_BUFFER_SPACE;
 			file.read(buf, size);
 			buf[size] = 0;
 
-			parseDB(cliComm, buf, buffer.data(), db, unknownTypes);
+			parseDB(cliComm, buf, xmlBuffer.data(), db, unknownTypes);
 		} catch (rapidsax::ParseError& e) {
 			cliComm.printWarning(
 				"Rom database parsing failed: ", e.what());
@@ -604,7 +655,7 @@ RomDatabase::RomDatabase(CliComm& cliComm)
 			// Ignore, see above
 		}
 	}
-	if (bufferSize) buffer[0] = 0;
+	if (bufferSize) xmlBuffer[0] = 0;
 	if (db.empty()) {
 		cliComm.printWarning(
 			"Couldn't load software database.\n"
@@ -617,13 +668,138 @@ RomDatabase::RomDatabase(CliComm& cliComm)
 		}
 		cliComm.printWarning(output);
 	}
+
+	buildIndex(db, xmlBuffer.data(), checksum);
+	if (CACHE_SUPPORTED && !db.empty()) {
+		saveCache(cacheName);
+	}
+}
+
+// Copy the parsed database into a compact index: only the strings that are
+// actually used are kept (and each distinct string only once).
+void RomDatabase::buildIndex(const RomDB& db, const char* bufStart, uint64_t checksum)
+{
+	hash_map<string_view, uint32_t, XXHasher> stringIndex;
+	uint32_t stringsSize = 1; // offset 0 is the empty string
+	auto addString = [&](string_view str) {
+		if (str.empty()) return;
+		auto [it, inserted] = stringIndex.emplace(str, stringsSize);
+		if (inserted) stringsSize += uint32_t(str.size() + 1);
+	};
+	for (const auto& info : view::values(db)) {
+		addString(info.getTitle   (bufStart));
+		addString(info.getYear    (bufStart));
+		addString(info.getCompany (bufStart));
+		addString(info.getCountry (bufStart));
+		addString(info.getOrigType(bufStart));
+		addString(info.getRemark  (bufStart));
+	}
+
+	size_t entriesOffset = sizeof(CacheHeader);
+	size_t stringsOffset = entriesOffset + db.size() * sizeof(Entry);
+	buffer.resize(stringsOffset + stringsSize);
+
+	CacheHeader header = {};
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.checksum = checksum;
+	header.entrySize = sizeof(Entry);
+	header.numEntries = uint32_t(db.size());
+	header.stringsSize = stringsSize;
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	char* strs = buffer.data() + stringsOffset;
+	strs[0] = 0;
+	for (const auto& [str, offset] : stringIndex) {
+		memcpy(strs + offset, str.data(), str.size());
+		strs[offset + str.size()] = 0;
+	}
+
+	auto str32 = [&](string_view str) {
+		String32 result;
+		toString32(strs, strs + (str.empty() ? 0 : *lookup(stringIndex, str)), result);
+		return result;
+	};
+	auto* out = reinterpret_cast<Entry*>(buffer.data() + entriesOffset);
+	for (auto i : xrange(db.size())) {
+		const auto& [sha1, info] = db[i];
+		new (&out[i]) Entry{sha1, RomInfo(
+			str32(info.getTitle   (bufStart)),
+			str32(info.getYear    (bufStart)),
+			str32(info.getCompany (bufStart)),
+			str32(info.getCountry (bufStart)),
+			info.getOriginal(),
+			str32(info.getOrigType(bufStart)),
+			str32(info.getRemark  (bufStart)),
+			info.getRomType(),
+			info.getGenMSXid())};
+	}
+	entries = span<const Entry>(out, db.size());
+	strings = strs;
+}
+
+bool RomDatabase::loadCache(const string& filename, uint64_t checksum)
+{
+	File file;
+	try {
+		file = File(filename);
+	} catch (FileException&) {
+		return false; // no cache (yet)
+	}
+	auto data = file.mmap();
+	if (data.size() < sizeof(CacheHeader)) return false;
+	CacheHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	if ((memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ||
+	    (header.checksum != checksum) ||
+	    (header.entrySize != sizeof(Entry)) ||
+	    (header.stringsSize == 0) ||
+	    (data.size() != (sizeof(CacheHeader) +
+	                     size_t(header.numEntries) * sizeof(Entry) +
+	                     header.stringsSize)) ||
+	    (data.back() != 0)) {
+		return false; // outdated or corrupt
+	}
+	entries = span<const Entry>(
+		reinterpret_cast<const Entry*>(data.data() + sizeof(CacheHeader)),
+		header.numEntries);
+	strings = reinterpret_cast<const char*>(data.data() + data.size() - header.stringsSize);
+	cacheFile = std::move(file); // keep mapping alive
+	return true;
+}
+
+void RomDatabase::saveCache(const string& filename) const
+{
+	// Another openMSX process may have the cache file mapped in memory,
+	// so don't overwrite it in-place.
+	string tmpName = filename + ".tmp";
+	try {
+		FileOperations::mkdirp(FileOperations::getUserDataDir());
+		{
+			CacheHeader header;
+			memcpy(&header, buffer.data(), sizeof(header));
+			File file(tmpName, File::TRUNCATE);
+			file.write(buffer.data(), sizeof(CacheHeader) +
+			                          header.numEntries * sizeof(Entry) +
+			                          header.stringsSize);
+		}
+		if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+			// On windows rename() fails when the target exists.
+			FileOperations::unlink(filename);
+			if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+				FileOperations::unlink(tmpName);
+			}
+		}
+	} catch (FileException&) {
+		// Ignore, next time we'll just parse the xml again.
+	}
 }
 
 const RomInfo* RomDatabase::fetchRomInfo(const Sha1Sum& sha1sum) const
 {
-	auto it = ranges::lower_bound(db, sha1sum, LessTupleElement<0>());
-	return ((it != end(db)) && (it->first == sha1sum))
-		? &it->second : nullptr;
+	auto it = ranges::lower_bound(entries, sha1sum,
+		[](const Entry& e, const Sha1Sum& s) { return e.sha1 < s; });
+	return ((it != entries.end()) && (it->sha1 == sha1sum))
+		? &it->info : nullptr;
 }
 
 } // namespace openmsx
@@ -1,21 +1,39 @@
 #ifndef ROMDATABASE_HH
 #define ROMDATABASE_HH
 
+#include "File.hh"
 #include "MemBuffer.hh"
+#include "RomInfo.hh"
 #include "sha1.hh"
+#include "span.hh"
+#include <cstdint>
+#include <string>
 #include <utility>
 #include <vector>
 
 namespace openmsx {
 
 class CliComm;
-class RomInfo;
 
+/** The software database (softwaredb.xml).
+  *
+  * Parsing the xml file(s) is relatively slow. So the result is stored in
+  * a compact binary index (sorted on sha1sum) which is cached in the user
+  * data directory. As long as the xml file(s) don't change, that cache file
+  * is memory mapped and queried directly, without parsing anything.
+  */
 class RomDatabase
 {
 public:
 	using RomDB = std::vector<std::pair<Sha1Sum, RomInfo>>;
 
+	/** An entry in the index. The index is (also) stored as-is in the
+	  * cache file, so this must remain a trivially copyable type. */
+	struct Entry {
+		Sha1Sum sha1;
+		RomInfo info;
+	};
+
 	RomDatabase(CliComm& cliComm);
 
 	/** Lookup an entry in the database by sha1sum.
@@ -23,11 +41,19 @@ public:
 	 */
 	[[nodiscard]] const RomInfo* fetchRomInfo(const Sha1Sum& sha1sum) const;
 
-	[[nodiscard]] const char* getBufferStart() const { return buffer.data(); }
+	[[nodiscard]] const char* getBufferStart() const { return strings; }
+
+private:
+	[[nodiscard]] bool loadCache(const std::string& filename, uint64_t checksum);
+	void saveCache(const std::string& filename) const;
+	void buildIndex(const RomDB& db, const char* bufStart, uint64_t checksum);
 
 private:
-	RomDB db;
-	MemBuffer<char> buffer;
+	span<const Entry> entries;
+	const char* strings = nullptr;
+
+	File cacheFile; // memory mapped index
+	MemBuffer<char> buffer; // or a freshly built index
 };
 
 } // namespace openmsx
@@ -6,6 +6,7 @@
 #include "ConfigException.hh"
 #include "XMLException.hh"
 #include "DeltaBlock.hh"
+#include "DirtyPages.hh"
 #include "MemBuffer.hh"
 #include "FileOperations.hh"
 #include "Version.hh"
@@ -166,6 +167,14 @@ void InputArchiveBase<Derived>::serialize_blob(
 	}
 }
 
+template<typename Derived>
+void InputArchiveBase<Derived>::serialize_blob(
+	const char* tag, void* data, size_t len, DirtyPages& dirty)
+{
+	this->self().serialize_blob(tag, data, len);
+	dirty.markAllDirty();
+}
+
 template class InputArchiveBase<MemInputArchive>;
 template class InputArchiveBase<XmlInputArchive>;
 
@@ -232,6 +241,23 @@ void MemOutputArchive::serialize_blob(const char* /*tag*/, const void* data,
 
 }
 
+void MemOutputArchive::serialize_blob(const char* tag, const void* data,
+                                      size_t len, DirtyPages& dirty)
+{
+	if (!dirty.isEnabled() || (len <= SMALL_SIZE)) {
+		serialize_blob(tag, data, len);
+		return;
+	}
+	// Same as above, but LastDeltaBlocks only has to look at the pages
+	// that were modified.
+	auto deltaBlockIdx = unsigned(deltaBlocks.size());
+	save(deltaBlockIdx);
+	dirty.flush();
+	deltaBlocks.push_back(lastDeltaBlocks.createNew(
+		data, static_cast<const uint8_t*>(data), len, &dirty));
+	dirty.nextEpoch();
+}
+
 void MemInputArchive::serialize_blob(const char* /*tag*/, void* data,
                                      size_t len, bool /*diff*/)
 {
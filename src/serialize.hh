@@ -23,6 +23,7 @@ namespace openmsx {
 
 class LastDeltaBlocks;
 class DeltaBlock;
+class DirtyPages;
 
 // TODO move somewhere in utils once we use this more often
 struct HashPair {
@@ -145,6 +146,13 @@ public:
 	//   or as a collection of bytes (IOW we cannot decide it based on the
 	//   type).
 	//
+	// void serialize_blob(const char* tag, const void* data, size_t len,
+	//                     DirtyPages& dirty)
+	//
+	//   Same as above, but 'dirty' keeps track of which parts of the blob
+	//   were modified. MemOutputArchive uses this to avoid scanning
+	//   unmodified memory. Loaders mark the whole blob as modified.
+	//
 	//
 	// template<typename T> void serialize(const char* tag, const T& t)
 	//
@@ -460,6 +468,13 @@ public:
 	// the resulting string. But memory archives will memcpy the blob.
 	void serialize_blob(const char* tag, const void* data, size_t len,
 	                    bool diff = true);
+	// Same, but with information about which parts of the blob were
+	// modified. Only MemOutputArchive makes use of that information.
+	void serialize_blob(const char* tag, const void* data, size_t len,
+	                    DirtyPages& /*dirty*/)
+	{
+		this->self().serialize_blob(tag, data, len);
+	}
 
 	template<typename T> void serialize(const char* tag, const T& t)
 	{
@@ -555,6 +570,9 @@ public:
 	}
 	void serialize_blob(const char* tag, void* data, size_t len,
 	                    bool diff = true);
+	// Same, but additionally marks the whole blob as modified.
+	void serialize_blob(const char* tag, void* data, size_t len,
+	                    DirtyPages& dirty);
 
 	template<typename T>
 	void serialize(const char* tag, T& t)
@@ -665,6 +683,8 @@ public:
 	void save(const std::string& s);
 	void serialize_blob(const char* tag, const void* data, size_t len,
 	                    bool diff = true);
+	void serialize_blob(const char* tag, const void* data, size_t len,
+	                    DirtyPages& dirty);
 
 	using OutputArchiveBase<MemOutputArchive>::serialize;
 	template<typename T, typename ...Args>
@@ -777,6 +797,7 @@ public:
 	[[nodiscard]] std::string_view loadStr();
 	void serialize_blob(const char* tag, void* data, size_t len,
 	                    bool diff = true);
+	using InputArchiveBase<MemInputArchive>::serialize_blob;
 
 	using InputArchiveBase<MemInputArchive>::serialize;
 	template<typename T, typename ...Args>
@@ -21,6 +21,7 @@
 #include "one_of.hh"
 #include "outer.hh"
 #include "random.hh"
+#include "ranges.hh"
 #include "xrange.hh"
 #include <cassert>
 #include <cstring>
@@ -588,6 +589,10 @@ void AY8910::writeRegister(unsigned reg, byte value, EmuTime::param time)
 		// Update the output buffer before changing the register.
 		updateStream(time);
 	}
+	if (reg < AY_PORTA) {
+		recordVGM(isAY8910 ? VGMRecorder::Chip::AY8910 : VGMRecorder::Chip::YM2149,
+		          0, reg, value, time);
+	}
 	wrtReg(reg, value, time);
 }
 void AY8910::wrtReg(unsigned reg, byte value, EmuTime::param time)
@@ -678,17 +683,28 @@ void AY8910::wrtReg(unsigned reg, byte value, EmuTime::param time)
 	}
 }
 
+bool AY8910::isChannelSilent(unsigned chan) const
+{
+	// Volume 0, and it remains 0 until the next register write.
+	if (amplitude.followsEnvelope(chan)) {
+		return !envelope.isChanging() && (envelope.getVolume() == 0.0f);
+	} else {
+		return amplitude.getVolume(chan) == 0.0f;
+	}
+}
+
+bool AY8910::isIdle() const
+{
+	return ranges::all_of(xrange(3), [&](auto chan) { return isChannelSilent(chan); });
+}
+
 void AY8910::generateChannels(float** bufs, unsigned num)
 {
 	// Disable channels with volume 0: since the sample value doesn't matter,
 	// we can use the fastest path.
 	unsigned chanEnable = regs[AY_ENABLE];
 	for (auto chan : xrange(3)) {
-		if ((!amplitude.followsEnvelope(chan) &&
-		     (amplitude.getVolume(chan) == 0.0f)) ||
-		    (amplitude.followsEnvelope(chan) &&
-		     !envelope.isChanging() &&
-		     (envelope.getVolume() == 0.0f))) {
+		if (isChannelSilent(chan)) {
 			bufs[chan] = nullptr;
 			tone[chan].advance(num);
 			chanEnable |= 0x09 << chan;
@@ -162,10 +162,12 @@ private:
 	// SoundDevice
 	void generateChannels(float** bufs, unsigned num) override;
 	[[nodiscard]] float getAmplificationFactorImpl() const override;
+	[[nodiscard]] bool isIdle() const override;
 
 	// Observer<Setting>
 	void update(const Setting& setting) override;
 
+	[[nodiscard]] bool isChannelSilent(unsigned chan) const;
 	void wrtReg(unsigned reg, byte value, EmuTime::param time);
 
 private:
@@ -3,6 +3,7 @@
 #include "SoundDevice.hh"
 #include "MSXMotherBoard.hh"
 #include "MSXCommandController.hh"
+#include "Reactor.hh"
 #include "TclObject.hh"
 #include "ThrottleManager.hh"
 #include "GlobalSettings.hh"
@@ -14,6 +15,7 @@
 #include "Filename.hh"
 #include "FileOperations.hh"
 #include "CliComm.hh"
+#include "WorkerPool.hh"
 #include "stl.hh"
 #include "aligned.hh"
 #include "one_of.hh"
@@ -23,10 +25,14 @@
 #include "view.hh"
 #include "vla.hh"
 #include "xrange.hh"
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <tuple>
 
 #ifdef __SSE2__
@@ -49,6 +55,7 @@ MSXMixer::MSXMixer(Mixer& mixer_, MSXMotherBoard& motherBoard_,
 	, throttleManager(globalSettings.getThrottleManager())
 	, prevTime(getCurrentTime(), 44100)
 	, soundDeviceInfo(commandController.getMachineInfoCommand())
+	, vgmRecorder(motherBoard)
 	, recorder(nullptr)
 	, synchronousCounter(0)
 {
@@ -134,6 +141,7 @@ void MSXMixer::unregisterSound(SoundDevice& device)
 		s.muteSetting->detach(*this);
 	}
 	move_pop_back(infos, it);
+	vgmRecorder.removeDevice(device);
 	commandController.getCliComm().update(CliComm::SOUNDDEVICE, device.getName(), "remove");
 }
 
@@ -402,12 +410,51 @@ filterBothStereo(float tl0, float tr0, const float* __restrict inM,
 	return std::tuple(tl0, tr0);
 }
 
+// Below this number of samples, all devices are generated sequentially.
+static constexpr unsigned PARALLEL_THRESHOLD = 64;
+
 static bool approxEqual(float x, float y)
 {
 	constexpr float threshold = 1.0f / 32768;
 	return std::abs(x - y) < threshold;
 }
 
+void MSXMixer::generateParallel(EmuTime::param time, unsigned samples, unsigned pitch)
+{
+	auto& workerPool = motherBoard.getReactor().getWorkerPool();
+	auto num = infos.size();
+	parallelBuf.resize(num * pitch);
+	parallelOutput.resize(num);
+
+	// The sound devices don't share any state, so they can be generated
+	// concurrently. Devices can take very different amounts of time, so
+	// instead of statically assigning them, each thread (including this
+	// one) repeatedly grabs the next not yet handled device.
+	// updateBuffer() can throw (e.g. when writing a wav file fails), the
+	// jobs must not throw, so the (first) exception is rethrown on this
+	// thread once all devices are done.
+	std::atomic<size_t> next = 0;
+	std::mutex errorMutex;
+	std::exception_ptr error;
+	auto work = [&] {
+		for (auto i = next++; i < num; i = next++) {
+			try {
+				parallelOutput[i] = infos[i].device->updateBuffer(
+					samples, &parallelBuf[i * pitch], time);
+			} catch (...) {
+				parallelOutput[i] = false;
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error) error = std::current_exception();
+			}
+		}
+	};
+	auto numJobs = std::min<size_t>(workerPool.getNumThreads(), num - 1);
+	repeat(numJobs, [&] { workerPool.submit(work, this); });
+	work();
+	workerPool.wait(this);
+	if (error) std::rethrow_exception(error);
+}
+
 void MSXMixer::generate(float* output, EmuTime::param time, unsigned samples)
 {
 	// The code below is specialized for a lot of cases (before this
@@ -438,33 +485,67 @@ void MSXMixer::generate(float* output, EmuTime::param time, unsigned samples)
 	constexpr unsigned HAS_STEREO_FLAG = 2;
 	unsigned usedBuffers = 0;
 
+	// When there's enough work, all devices first generate their output in
+	// parallel (each in its own buffer). The loop below then only combines
+	// those buffers. Small updates (e.g. triggered by a register write)
+	// are handled sequentially, there the synchronization overhead would
+	// be larger than the gain.
+	// Hibernating devices (see SoundDevice::isHibernating()) don't count:
+	// their updateBuffer() immediately returns silence, so they're not
+	// mixed and cost (almost) nothing.
+	static const bool multiCore = std::thread::hardware_concurrency() > 1;
+	auto numActive = ranges::count_if(infos, [](auto& info) {
+		return !info.device->isHibernating();
+	});
+	bool parallel = multiCore && (samples >= PARALLEL_THRESHOLD) &&
+	                (numActive >= 2);
+	unsigned pitch = (2 * samples + 3 + 3) & ~3; // keep each buffer SSE-aligned
+	if (parallel) generateParallel(time, samples, pitch);
+
+	// Get the output of the i-th device, returns nullptr if it's silent.
+	// In sequential mode the output is generated in 'buf'.
+	auto deviceOutput = [&](size_t i, float* buf) -> const float* {
+		if (parallel) {
+			return parallelOutput[i] ? &parallelBuf[i * pitch] : nullptr;
+		}
+		return infos[i].device->updateBuffer(samples, buf, time) ? buf : nullptr;
+	};
+	// Same as above, but always place the output in 'buf'.
+	auto deviceOutputIn = [&](size_t i, float* buf, unsigned num) {
+		const auto* out = deviceOutput(i, buf);
+		if (!out) return false;
+		if (out != buf) memcpy(buf, out, num * sizeof(float));
+		return true;
+	};
+
 	// FIXME: The Infos should be ordered such that all the mono
 	// devices are handled first
-	for (auto& info : infos) {
+	for (auto i : xrange(infos.size())) {
+		auto& info = infos[i];
 		SoundDevice& device = *info.device;
 		auto l1 = info.left1;
 		auto r1 = info.right1;
 		if (!device.isStereo()) {
 			if (l1 == r1) {
 				if (!(usedBuffers & HAS_MONO_FLAG)) {
-					if (device.updateBuffer(samples, monoBuf, time)) {
+					if (deviceOutputIn(i, monoBuf, samples)) {
 						usedBuffers |= HAS_MONO_FLAG;
 						mul(monoBuf, samples, l1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulAcc(monoBuf, tmpBuf, samples, l1);
+					if (const auto* buf = deviceOutput(i, tmpBuf)) {
+						mulAcc(monoBuf, buf, samples, l1);
 					}
 				}
 			} else {
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (deviceOutputIn(i, stereoBuf, samples)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulExpand(stereoBuf, samples, l1, r1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulExpandAcc(stereoBuf, tmpBuf, samples, l1, r1);
+					if (const auto* buf = deviceOutput(i, tmpBuf)) {
+						mulExpandAcc(stereoBuf, buf, samples, l1, r1);
 					}
 				}
 			}
@@ -475,24 +556,24 @@ void MSXMixer::generate(float* output, EmuTime::param time, unsigned samples)
 				assert(l2 == 0.0f);
 				assert(r1 == 0.0f);
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (deviceOutputIn(i, stereoBuf, 2 * samples)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mul(stereoBuf, 2 * samples, l1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulAcc(stereoBuf, tmpBuf, 2 * samples, l1);
+					if (const auto* buf = deviceOutput(i, tmpBuf)) {
+						mulAcc(stereoBuf, buf, 2 * samples, l1);
 					}
 				}
 			} else {
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (deviceOutputIn(i, stereoBuf, 2 * samples)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulMix2(stereoBuf, samples, l1, l2, r1, r2);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulMix2Acc(stereoBuf, tmpBuf, samples, l1, l2, r1, r2);
+					if (const auto* buf = deviceOutput(i, tmpBuf)) {
+						mulMix2Acc(stereoBuf, buf, samples, l1, l2, r1, r2);
 					}
 				}
 			}
@@ -6,6 +6,9 @@
 #include "InfoTopic.hh"
 #include "EmuTime.hh"
 #include "DynamicClock.hh"
+#include "VGMRecorder.hh"
+#include "MemBuffer.hh"
+#include "aligned.hh"
 #include <vector>
 #include <memory>
 
@@ -114,6 +117,8 @@ public:
 
 	[[nodiscard]] SoundDevice* findDevice(std::string_view name) const;
 
+	[[nodiscard]] VGMRecorder& getVGMRecorder() { return vgmRecorder; }
+
 	void reInit();
 
 private:
@@ -135,6 +140,7 @@ private:
 	void reschedule();
 	void reschedule2();
 	void generate(float* output, EmuTime::param time, unsigned samples);
+	void generateParallel(EmuTime::param time, unsigned samples, unsigned pitch);
 
 	// Schedulable
 	void executeUntil(EmuTime::param time) override;
@@ -174,11 +180,17 @@ private:
 		void tabCompletion(std::vector<std::string>& tokens) const override;
 	} soundDeviceInfo;
 
+	VGMRecorder vgmRecorder;
+
 	AviRecorder* recorder;
 	unsigned synchronousCounter;
 
 	unsigned muteCount;
 	float tl0, tr0; // internal DC-filter state
+
+	// parallel generation of the sound devices, see generate()
+	MemBuffer<float, SSE_ALIGNMENT> parallelBuf; // per device one buffer
+	std::vector<uint8_t> parallelOutput; // per device: did it produce sound?
 };
 
 } // namespace openmsx
@@ -39,11 +39,25 @@ void ResampledSoundDevice::setOutputRate(unsigned /*sampleRate*/)
 bool ResampledSoundDevice::updateBuffer(unsigned length, float* buffer,
                                         EmuTime::param time)
 {
-	return algo->generateOutput(buffer, length, time);
+	if (isHibernating()) {
+		// Output remains silent, only keep the clock in sync (exactly
+		// like the resamplers do when their input is silent).
+		emuClock.advance(time);
+		return false;
+	}
+	bool result = algo->generateOutput(buffer, length, time);
+	if (!result && canHibernate()) {
+		// Both the device and the resampler (its history) are silent,
+		// and they remain so until the device state changes.
+		hibernate();
+	}
+	return result;
 }
 
 bool ResampledSoundDevice::generateInput(float* buffer, unsigned num)
 {
+	// An idle device only produces silence, no need to run its generator.
+	if (canHibernate()) return false;
 	return mixChannels(buffer, num);
 }
 
@@ -293,28 +293,34 @@ void SCC::writeMem(byte address, byte value, EmuTime::param time)
 		if (address < 0x80) {
 			// 0x00..0x7F : write wave form 1..4
 			writeWave(address >> 5, address, value);
+			recordVGM(VGMRecorder::Chip::SCC, 0, address, value, time);
 		} else if (address < 0xA0) {
 			// 0x80..0x9F : freq volume block
 			setFreqVol(address, value, time);
+			recordVGMFreqVol(address, value, time);
 		} else if (address < 0xE0) {
 			// 0xA0..0xDF : no function
 		} else {
 			// 0xE0..0xFF : deformation register
 			setDeformReg(value, time);
+			recordVGM(VGMRecorder::Chip::SCC, 5, 0, value, time);
 		}
 		break;
 	case SCC_Compatible:
 		if (address < 0x80) {
 			// 0x00..0x7F : write wave form 1..4
 			writeWave(address >> 5, address, value);
+			recordVGM(VGMRecorder::Chip::SCC, 0, address, value, time);
 		} else if (address < 0xA0) {
 			// 0x80..0x9F : freq volume block
 			setFreqVol(address, value, time);
+			recordVGMFreqVol(address, value, time);
 		} else if (address < 0xC0) {
 			// 0xA0..0xBF : ignore write wave form 5
 		} else if (address < 0xE0) {
 			// 0xC0..0xDF : deformation register
 			setDeformReg(value, time);
+			recordVGM(VGMRecorder::Chip::SCC, 5, 0, value, time);
 		} else {
 			// 0xE0..0xFF : no function
 		}
@@ -323,12 +329,15 @@ void SCC::writeMem(byte address, byte value, EmuTime::param time)
 		if (address < 0xA0) {
 			// 0x00..0x9F : write wave form 1..5
 			writeWave(address >> 5, address, value);
+			recordVGM(VGMRecorder::Chip::SCC, 4, address, value, time);
 		} else if (address < 0xC0) {
 			// 0xA0..0xBF : freq volume block
 			setFreqVol(address, value, time);
+			recordVGMFreqVol(address, value, time);
 		} else if (address < 0xE0) {
 			// 0xC0..0xDF : deformation register
 			setDeformReg(value, time);
+			recordVGM(VGMRecorder::Chip::SCC, 5, 0, value, time);
 		} else {
 			// 0xE0..0xFF : no function
 		}
@@ -338,6 +347,19 @@ void SCC::writeMem(byte address, byte value, EmuTime::param time)
 	}
 }
 
+void SCC::recordVGMFreqVol(unsigned address, byte value, EmuTime::param time)
+{
+	// VGM ports: 1 = frequency, 2 = volume, 3 = channel enable
+	address &= 0x0F; // region is visible twice
+	if (address < 0x0A) {
+		recordVGM(VGMRecorder::Chip::SCC, 1, address, value, time);
+	} else if (address < 0x0F) {
+		recordVGM(VGMRecorder::Chip::SCC, 2, address - 0x0A, value, time);
+	} else {
+		recordVGM(VGMRecorder::Chip::SCC, 3, 0, value, time);
+	}
+}
+
 float SCC::getAmplificationFactorImpl() const
 {
 	return 1.0f / 128.0f;
@@ -461,6 +483,14 @@ void SCC::setDeformRegHelper(byte value)
 	}
 }
 
+bool SCC::isIdle() const
+{
+	// All channels are muted in generateChannels() (and remain so)
+	return ranges::none_of(xrange(5), [&](auto i) {
+		return ((ch_enable >> i) & 1) && (volume[i] || out[i]);
+	});
+}
+
 void SCC::generateChannels(float** bufs, unsigned num)
 {
 	unsigned enable = ch_enable;
@@ -526,6 +556,8 @@ byte SCC::Debuggable::read(unsigned address, EmuTime::param time)
 void SCC::Debuggable::write(unsigned address, byte value, EmuTime::param time)
 {
 	auto& scc = OUTER(SCC, debuggable);
+	// Same as writeMem(): also wakes up a hibernating SCC.
+	scc.updateStream(time);
 	if (address < 0xA0) {
 		// read wave form 1..5
 		scc.writeWave(address >> 5, address, value);
@@ -32,12 +32,14 @@ private:
 	// SoundDevice
 	[[nodiscard]] float getAmplificationFactorImpl() const override;
 	void generateChannels(float** bufs, unsigned num) override;
+	[[nodiscard]] bool isIdle() const override;
 
 	[[nodiscard]] byte readWave(unsigned channel, unsigned address, EmuTime::param time) const;
 	void writeWave(unsigned channel, unsigned address, byte value);
 	void setDeformReg(byte value, EmuTime::param time);
 	void setDeformRegHelper(byte value);
 	void setFreqVol(unsigned address, byte value, EmuTime::param time);
+	void recordVGMFreqVol(unsigned address, byte value, EmuTime::param time);
 	[[nodiscard]] byte getFreqVol(unsigned address) const;
 
 private:
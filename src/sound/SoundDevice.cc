@@ -21,8 +21,9 @@ using std::string;
 
 namespace openmsx {
 
-static MemBuffer<float, SSE_ALIGNMENT> mixBuffer;
-static unsigned mixBufferSize = 0;
+// Per thread, because MSXMixer may generate several devices in parallel.
+static thread_local MemBuffer<float, SSE_ALIGNMENT> mixBuffer;
+static thread_local unsigned mixBufferSize = 0;
 
 static void allocateMixBuffer(unsigned size)
 {
@@ -84,6 +85,16 @@ bool SoundDevice::isStereo() const
 	return stereo == 2 || !balanceCenter;
 }
 
+std::pair<byte, span<const byte>> SoundDevice::getVGMDataBlock() const
+{
+	return {0, {}};
+}
+
+bool SoundDevice::isIdle() const
+{
+	return false;
+}
+
 float SoundDevice::getAmplificationFactorImpl() const
 {
 	return 1.0f / 32768.0f;
@@ -141,6 +152,9 @@ void SoundDevice::unregisterSound()
 void SoundDevice::updateStream(EmuTime::param time)
 {
 	mixer.updateStream(time);
+	// The caller is about to change the state of this device, so it may
+	// no longer be idle.
+	hibernating = false;
 }
 
 void SoundDevice::setSoftwareVolume(float volume, EmuTime::param time)
@@ -167,6 +181,7 @@ void SoundDevice::recordChannel(unsigned channel, const Filename& filename)
 		writer[channel].reset();
 	}
 	bool recording = writer[channel] != nullptr;
+	hibernating = false; // the recording must also contain the silence
 	if (recording != wasRecording) {
 		if (recording) {
 			if (numRecordChannels == 0) {
@@ -3,10 +3,15 @@
 
 #include "MSXMixer.hh"
 #include "EmuTime.hh"
+#include "VGMRecorder.hh"
+#include "likely.hh"
+#include "openmsx.hh"
+#include "span.hh"
 #include "static_string_view.hh"
 #include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
 
 namespace openmsx {
 
@@ -68,6 +73,13 @@ public:
 	void recordChannel(unsigned channel, const Filename& filename);
 	void muteChannel  (unsigned channel, bool muted);
 
+	/** Is this device hibernating? IOW it's idle (see isIdle()) and its
+	  * last output was silent. Then it doesn't generate any sound until
+	  * the next call to updateStream() (e.g. a register write), and the
+	  * mixer can skip it.
+	  */
+	[[nodiscard]] bool isHibernating() const { return hibernating; }
+
 protected:
 	/** Constructor.
 	  * @param mixer The Mixer object
@@ -105,9 +117,32 @@ protected:
 	 */
 	void unregisterSound();
 
-	/** @see Mixer::updateStream */
+	/** @see Mixer::updateStream
+	  * This also wakes up the device when it was hibernating.
+	  */
 	void updateStream(EmuTime::param time);
 
+	/** Is this device in a (provably) silent steady state? IOW does it
+	  * currently produce silence and will it keep doing so until its
+	  * state is changed (e.g. by a register write, which always calls
+	  * updateStream() first, also when it comes from a debuggable)?
+	  * While idle the device doesn't need to run
+	  * its generator, and once its output is silent it can hibernate.
+	  * The default implementation returns false.
+	  */
+	[[nodiscard]] virtual bool isIdle() const;
+
+	/** Is this device idle and are none of its channels recorded? */
+	[[nodiscard]] bool canHibernate() const {
+		return (numRecordChannels == 0) && isIdle();
+	}
+
+	/** Start hibernating (see isHibernating()). Should only be called
+	  * right after the device produced silent output while
+	  * canHibernate() returned true.
+	  */
+	void hibernate() { hibernating = true; }
+
 	void setInputRate(unsigned sampleRate) { inputSampleRate = sampleRate; }
 	[[nodiscard]] unsigned getInputRate() const { return inputSampleRate; }
 
@@ -140,6 +175,14 @@ public: // Will be called by Mixer:
 	[[nodiscard]] virtual bool updateBuffer(unsigned length, float* buffer,
 	                                        EmuTime::param time) = 0;
 
+public: // Will be called by VGMRecorder:
+	/** Memory (e.g. sample RAM) that must be stored in a VGM recording
+	  * before the first recorded register write of this device, together
+	  * with the VGM data block type. The default implementation returns
+	  * an empty block.
+	  */
+	[[nodiscard]] virtual std::pair<byte, span<const byte>> getVGMDataBlock() const;
+
 protected:
 	/** Adds a number of samples that all have the same value.
 	  * Can be used to synthesize segments of a square wave.
@@ -180,6 +223,18 @@ protected:
 	  */
 	[[nodiscard]] bool mixChannels(float* dataOut, unsigned samples);
 
+	/** Report a register write to the VGM recorder (see VGMRecorder).
+	  * Sound chips call this for every write that can influence the
+	  * sound, while not recording this is cheap.
+	  */
+	void recordVGM(VGMRecorder::Chip chip, byte port, byte reg, byte value,
+	               EmuTime::param time) {
+		auto& recorder = mixer.getVGMRecorder();
+		if (unlikely(recorder.isRecording())) {
+			recorder.write(*this, chip, port, reg, value, time);
+		}
+	}
+
 	/** See MSXMixer::getHostSampleClock(). */
 	[[nodiscard]] const DynamicClock& getHostSampleClock() const;
 	[[nodiscard]] double getEffectiveSpeed() const;
@@ -200,6 +255,7 @@ private:
 	int channelBalance[MAX_CHANNELS];
 	bool channelMuted[MAX_CHANNELS];
 	bool balanceCenter;
+	bool hibernating = false;
 };
 
 } // namespace openmsx
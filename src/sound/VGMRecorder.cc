@@ -0,0 +1,427 @@
+#include "VGMRecorder.hh"
+#include "SoundDevice.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXCommandController.hh"
+#include "CliComm.hh"
+#include "CommandException.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "TclArgParser.hh"
+#include "TclObject.hh"
+#include "endian.hh"
+#include "outer.hh"
+#include "ranges.hh"
+#include "strCat.hh"
+#include "unreachable.hh"
+#include "xrange.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace openmsx {
+
+static constexpr unsigned SAMPLE_RATE = 44100; // fixed by the VGM format
+static constexpr size_t HEADER_SIZE = 0x100;
+static constexpr size_t FLUSH_SIZE = 64 * 1024;
+static constexpr uint32_t MIN_LOOP_TICKS = SAMPLE_RATE; // 1 second
+// Register writes that are part of a loop can be (slightly) shifted in time
+// because the 44100Hz resolution of VGM doesn't match the MSX clocks.
+static constexpr uint32_t DELTA_TOLERANCE = 2;
+
+struct ChipInfo {
+	unsigned headerOffset; // position of the clock in the header
+	uint32_t clock;
+};
+static constexpr ChipInfo chipInfos[size_t(VGMRecorder::Chip::NUM_CHIPS)] = {
+	{0x74,  1789773}, // AY8910
+	{0x74,  1789773}, // YM2149
+	{0x10,  3579545}, // YM2413
+	{0x58,  3579545}, // Y8950
+	{0x5C, 14318180}, // YMF262
+	{0x60, 33868800}, // YMF278B
+	{0x30,  3579545}, // YM2151
+	{0x9C,  1789773}, // SCC (K051649)
+};
+
+VGMRecorder::VGMRecorder(MSXMotherBoard& motherBoard_)
+	: motherBoard(motherBoard_)
+	, recordCommand(motherBoard.getMSXCommandController())
+{
+}
+
+VGMRecorder::~VGMRecorder()
+{
+	if (!recording) return;
+	try {
+		if (started) {
+			finish(ticks);
+		} else {
+			abort();
+		}
+	} catch (MSXException&) {
+		// ignore, can't report errors anymore
+	}
+}
+
+void VGMRecorder::start(const std::string& filename_)
+{
+	assert(!recording);
+	file = File(filename_, "wb");
+	filename = filename_;
+	buffer.assign(HEADER_SIZE, 0); // header is written when stopping
+	filePos = 0;
+	events.clear();
+	ranges::fill(owners, nullptr);
+	ranges::fill(used, false);
+	sccPlusUsed = false;
+	ticks = 0;
+	started = false;
+	recording = true;
+}
+
+std::string VGMRecorder::stop(EmuTime::param time)
+{
+	assert(recording);
+	if (!started) {
+		abort();
+		return "Nothing was recorded.";
+	}
+	finish(getTicks(time));
+	return strCat("Recorded to ", filename, '.');
+}
+
+void VGMRecorder::abort()
+{
+	recording = false;
+	file.close();
+	FileOperations::unlink(filename);
+}
+
+void VGMRecorder::finish(uint32_t endTicks)
+{
+	recording = false;
+	uint32_t totalTicks;
+	std::optional<std::pair<uint32_t, uint32_t>> loopInfo;
+	if (auto loop = findLoop(events, MIN_LOOP_TICKS)) {
+		// only keep the first iteration of the loop
+		const auto& first = events[loop->start];
+		const auto& end   = events[loop->start + loop->length];
+		flush();
+		file.truncate(end.offset);
+		file.seek(end.offset);
+		filePos = end.offset;
+		totalTicks = end.ticks;
+		loopInfo.emplace(first.offset, end.ticks - first.ticks);
+	} else {
+		totalTicks = std::max(endTicks, ticks);
+		writeWait(totalTicks - ticks);
+	}
+	emit({0x66}); // end of sound data
+	flush();
+	writeHeader(totalTicks, loopInfo);
+	file.close();
+	events.clear();
+	events.shrink_to_fit();
+}
+
+void VGMRecorder::writeHeader(uint32_t totalTicks, std::optional<std::pair<uint32_t, uint32_t>> loop)
+{
+	byte header[HEADER_SIZE] = {};
+	auto put = [&](unsigned offset, uint32_t value) {
+		Endian::write_UA_L32(&header[offset], value);
+	};
+	memcpy(&header[0x00], "Vgm ", 4);
+	put(0x04, uint32_t(filePos - 0x04)); // end of file offset
+	put(0x08, 0x161); // version 1.61
+	put(0x18, totalTicks);
+	if (loop) {
+		put(0x1C, loop->first - 0x1C);
+		put(0x20, loop->second);
+	}
+	put(0x34, HEADER_SIZE - 0x34); // start of the data
+	for (auto c : xrange(size_t(Chip::NUM_CHIPS))) {
+		if (!used[c]) continue;
+		uint32_t clock = chipInfos[c].clock;
+		if ((Chip(c) == Chip::SCC) && sccPlusUsed) clock |= 0x80000000;
+		put(chipInfos[c].headerOffset, clock);
+	}
+	if (used[size_t(Chip::YM2149)]) {
+		header[0x78] = 0x10; // AY type: YM2149
+	}
+	file.seek(0);
+	file.write(header, sizeof(header));
+}
+
+void VGMRecorder::write(SoundDevice& device, Chip chip, byte port, byte reg, byte value,
+                        EmuTime::param time)
+{
+	assert(recording);
+	auto c = size_t(chip);
+	auto o = (chip == Chip::YM2149) ? size_t(Chip::AY8910)
+	       : ((chip == Chip::YMF278B) && (port == 2)) ? size_t(Chip::NUM_CHIPS)
+	       : c;
+	bool first = false;
+	if (!owners[o]) {
+		owners[o] = &device;
+		first = true;
+	} else if (owners[o] != &device) {
+		return; // only one device per chip type
+	}
+
+	if (!started) {
+		started = true;
+		startTime = time;
+		motherBoard.getMSXCliComm().printInfo(
+			"VGM recording started, data was written to a sound chip.");
+	}
+	uint32_t now = getTicks(time);
+	writeWait(now - ticks);
+	ticks = now;
+
+	if (first) {
+		used[c] = true;
+		auto [type, data] = device.getVGMDataBlock();
+		if (!data.empty()) writeDataBlock(type, data);
+		if (o == size_t(Chip::NUM_CHIPS)) {
+			// enable OPL4 mode, the recording may have started after
+			// the program did this
+			emit({0xD0, 0x01, 0x05, 0x03});
+		}
+	}
+
+	events.push_back({now, uint32_t(getPosition()), Event::makeKey(chip, port, reg, value)});
+	switch (chip) {
+	case Chip::AY8910:
+	case Chip::YM2149:  emit({0xA0, reg, value}); break;
+	case Chip::YM2413:  emit({0x51, reg, value}); break;
+	case Chip::Y8950:   emit({0x5C, reg, value}); break;
+	case Chip::YMF262:  emit({byte(port ? 0x5F : 0x5E), reg, value}); break;
+	case Chip::YMF278B: emit({0xD0, port, reg, value}); break;
+	case Chip::YM2151:  emit({0x54, reg, value}); break;
+	case Chip::SCC:
+		if (port == 4) sccPlusUsed = true;
+		emit({0xD2, port, reg, value});
+		break;
+	default:
+		UNREACHABLE;
+	}
+
+	if (buffer.size() >= FLUSH_SIZE) {
+		try {
+			flush();
+		} catch (MSXException& e) {
+			motherBoard.getMSXCliComm().printWarning(
+				"VGM recording aborted: ", e.getMessage());
+			abort();
+		}
+	}
+}
+
+void VGMRecorder::removeDevice(const SoundDevice& device)
+{
+	for (auto& owner : owners) {
+		if (owner == &device) owner = nullptr;
+	}
+}
+
+void VGMRecorder::writeWait(uint32_t num)
+{
+	while (num) {
+		if (num <= 16) {
+			emit({byte(0x70 + num - 1)}); // wait n+1 samples
+			return;
+		}
+		auto n = std::min<uint32_t>(num, 0xFFFF);
+		emit({0x61, byte(n & 0xFF), byte(n >> 8)}); // wait n samples
+		num -= n;
+	}
+}
+
+void VGMRecorder::writeDataBlock(byte type, span<const byte> data)
+{
+	auto size = uint32_t(data.size());
+	byte buf[15] = {0x67, 0x66, type};
+	Endian::write_UA_L32(&buf[3], size + 8); // size of this block
+	Endian::write_UA_L32(&buf[7], size); // total size of the memory
+	Endian::write_UA_L32(&buf[11], 0); // start address of this block
+	buffer.insert(buffer.end(), std::begin(buf), std::end(buf));
+	buffer.insert(buffer.end(), data.begin(), data.end());
+}
+
+void VGMRecorder::emit(std::initializer_list<byte> bytes)
+{
+	buffer.insert(buffer.end(), bytes);
+}
+
+void VGMRecorder::flush()
+{
+	file.write(buffer.data(), buffer.size());
+	filePos += buffer.size();
+	buffer.clear();
+}
+
+uint32_t VGMRecorder::getTicks(EmuTime::param time) const
+{
+	return (time - startTime).getTicksAt(SAMPLE_RATE);
+}
+
+std::optional<VGMRecorder::Loop> VGMRecorder::findLoop(
+	span<const Event> events_, uint32_t minTicks)
+{
+	auto n = events_.size();
+	if (n < 2) return {};
+	auto key   = [&](size_t i) { return events_[n - 1 - i].key; }; // reversed
+	auto delta = [&](size_t i) { return events_[i].ticks - events_[i - 1].ticks; };
+
+	// keyRepeats[period]: the number of trailing events of which the
+	// register write (ignoring the timing) repeats the one 'period' events
+	// earlier. This is the Z-function of the reversed keys, calculated in
+	// linear time.
+	std::vector<size_t> keyRepeats(n, 0);
+	for (size_t i = 1, l = 0, r = 0; i < n; ++i) {
+		size_t z = (i < r) ? std::min(r - i, keyRepeats[i - l]) : 0;
+		while ((i + z < n) && (key(z) == key(i + z))) ++z;
+		keyRepeats[i] = z;
+		if (i + z > r) { l = i; r = i + z; }
+	}
+
+	// Checking the timing is only needed for the periods that can give a
+	// better loop, bound the total amount of work anyway (a (very) long
+	// repetitive recording could still take quadratic time). When the
+	// budget is exhausted, the best loop found so far is returned.
+	size_t budget = 16 * n;
+
+	std::optional<Loop> result;
+	size_t bestStart = n;
+	for (size_t period = 1; 2 * period <= n; ++period) {
+		// the last iteration must be long enough (doesn't need to be
+		// checked exactly, the start of the loop is checked below)
+		if ((events_[n - 1].ticks - events_[n - 1 - period].ticks) < minTicks) continue;
+
+		auto maxNum = keyRepeats[period];
+		if (maxNum < period) continue; // less than one full iteration
+		if ((n - maxNum - period) >= bestStart) continue; // can't be better
+
+		// number of trailing events that repeat, including the time
+		// since the previous event
+		size_t num = 0;
+		while ((num < maxNum) && (num + period + 1 < n)) {
+			auto d1 = delta(n - 1 - num);
+			auto d2 = delta(n - 1 - num - period);
+			if ((std::max(d1, d2) - std::min(d1, d2)) > DELTA_TOLERANCE) break;
+			++num;
+		}
+		budget -= std::min(budget, num + 1);
+		// The loop point is placed right before the first event of the
+		// loop (after the wait that precedes it), so for that event
+		// only the register write itself must repeat.
+		if (num < maxNum) ++num;
+
+		if (num >= period) { // at least one full iteration
+			size_t start = n - num - period;
+			if ((start < bestStart) &&
+			    ((events_[start + period].ticks - events_[start].ticks) >= minTicks)) {
+				bestStart = start;
+				result = Loop{start, period};
+			}
+		}
+		if (budget == 0) break;
+	}
+	return result;
+}
+
+// class VGMRecorder::Cmd
+
+VGMRecorder::Cmd::Cmd(CommandController& commandController_)
+	: Command(commandController_, "record_vgm")
+{
+}
+
+void VGMRecorder::Cmd::execute(span<const TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw CommandException("Missing argument");
+	}
+	auto& recorder = OUTER(VGMRecorder, recordCommand);
+	executeSubCommand(tokens[1].getString(),
+		"start", [&]{
+			std::string_view prefix = "music";
+			ArgsInfo info[] = { valueArg("-prefix", prefix) };
+			auto arguments = parseTclArgs(getInterpreter(), tokens.subspan(2), info);
+			if (arguments.size() > 1) throw SyntaxError();
+			auto filename = FileOperations::parseCommandFileArgument(
+				arguments.empty() ? std::string_view{} : arguments[0].getString(),
+				"vgm_recordings", prefix, ".vgm");
+			if (recorder.recording) {
+				result = "Already recording.";
+				return;
+			}
+			try {
+				recorder.start(filename);
+			} catch (MSXException& e) {
+				throw CommandException("Couldn't start VGM recording: ", e.getMessage());
+			}
+			result = strCat("VGM recording to ", filename,
+			                ", recording starts at the first sound chip register write.");
+		},
+		"stop", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			if (!recorder.recording) {
+				throw CommandException("Not recording.");
+			}
+			try {
+				result = recorder.stop(recorder.motherBoard.getCurrentTime());
+			} catch (MSXException& e) {
+				throw CommandException("Couldn't write VGM file: ", e.getMessage());
+			}
+		},
+		"abort", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			if (!recorder.recording) {
+				throw CommandException("Not recording.");
+			}
+			recorder.abort();
+		},
+		"status", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			result.addDictKeyValue("status", !recorder.recording ? "idle"
+			                                 : recorder.started ? "recording"
+			                                                    : "waiting");
+		});
+}
+
+std::string VGMRecorder::Cmd::help(const std::vector<std::string>& /*tokens*/) const
+{
+	return "Records the register writes of the sound chips to a .vgm file.\n"
+	       "record_vgm start              Record to file 'musicNNNN.vgm'\n"
+	       "record_vgm start <filename>   Record to given file\n"
+	       "record_vgm start -prefix foo  Record to file 'fooNNNN.vgm'\n"
+	       "record_vgm stop               Stop recording and save the file\n"
+	       "record_vgm abort              Stop recording without saving\n"
+	       "record_vgm status             Query recording state\n"
+	       "\n"
+	       "The recording starts at the first register write, so start the "
+	       "recording before starting the music. Recorded chips: PSG, SCC, "
+	       "MSX-MUSIC, MSX-AUDIO, OPL3, MoonSound and SFG, per type only the "
+	       "first one that is used. When stopping, the recording is checked "
+	       "for a loop. If one is found, the file only contains the music up "
+	       "to the end of the first iteration of the loop, with a loop point "
+	       "in the header.";
+}
+
+void VGMRecorder::Cmd::tabCompletion(std::vector<std::string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static constexpr const char* const cmds[] = {
+			"start", "stop", "abort", "status",
+		};
+		completeString(tokens, cmds);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
+		static constexpr const char* const options[] = { "-prefix" };
+		completeFileName(tokens, userFileContext(), options);
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,124 @@
+#ifndef VGMRECORDER_HH
+#define VGMRECORDER_HH
+
+#include "Command.hh"
+#include "EmuTime.hh"
+#include "File.hh"
+#include "openmsx.hh"
+#include "span.hh"
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+class SoundDevice;
+
+/** Records the register writes of the sound chips to a VGM file.
+  *
+  * The sound chips report their register writes (see
+  * SoundDevice::recordVGM()), while not recording this only costs a single
+  * test per write. The commands are streamed to the file through a memory
+  * buffer. The recording only starts at the first register write, so the
+  * file doesn't start with silence.
+  *
+  * Per chip type only one device is recorded (the first one that writes to
+  * its registers). For the MoonSound the FM and the wave part are separate
+  * sound devices, both are recorded as one YMF278B chip.
+  *
+  * When the recording is stopped, the recorded commands are searched for a
+  * loop (the last part of the recording is a repetition of the part before
+  * it). When found, the file is truncated after the first iteration of the
+  * loop and the loop point is stored in the header.
+  */
+class VGMRecorder
+{
+public:
+	enum class Chip { AY8910, YM2149, YM2413, Y8950, YMF262, YMF278B, YM2151, SCC, NUM_CHIPS };
+
+	/** One recorded register write. */
+	struct Event {
+		uint32_t ticks;  // time in 44100Hz samples since the start
+		uint32_t offset; // file position of the command (after the wait)
+		uint32_t key;    // chip, port, register and value
+
+		[[nodiscard]] static uint32_t makeKey(Chip chip, byte port, byte reg, byte value) {
+			return (uint32_t(chip) << 24) | (port << 16) | (reg << 8) | value;
+		}
+	};
+
+	/** A loop that covers 'length' events, starting at event 'start'. */
+	struct Loop {
+		size_t start;
+		size_t length;
+	};
+
+public:
+	explicit VGMRecorder(MSXMotherBoard& motherBoard);
+	~VGMRecorder();
+
+	[[nodiscard]] bool isRecording() const { return recording; }
+
+	/** Called by the sound devices (only while recording). */
+	void write(SoundDevice& device, Chip chip, byte port, byte reg, byte value,
+	           EmuTime::param time);
+
+	/** Must be called when a sound device is removed. */
+	void removeDevice(const SoundDevice& device);
+
+	/** Search the shortest prefix after which the remaining events are a
+	  * repetition (at least one full iteration) of a loop of at least
+	  * 'minTicks' long. Returns nothing when there's no such loop.
+	  * Takes linear time, for (very) long repetitive recordings the
+	  * search stops early and the result may not be the shortest prefix. */
+	[[nodiscard]] static std::optional<Loop> findLoop(
+		span<const Event> events, uint32_t minTicks);
+
+private:
+	void start(const std::string& filename);
+	[[nodiscard]] std::string stop(EmuTime::param time);
+	void abort();
+	void finish(uint32_t endTicks);
+	void writeHeader(uint32_t totalTicks, std::optional<std::pair<uint32_t, uint32_t>> loop);
+	void writeWait(uint32_t num);
+	void writeDataBlock(byte type, span<const byte> data);
+	void emit(std::initializer_list<byte> bytes);
+	void flush();
+	[[nodiscard]] uint32_t getTicks(EmuTime::param time) const;
+	[[nodiscard]] size_t getPosition() const { return filePos + buffer.size(); }
+
+private:
+	MSXMotherBoard& motherBoard;
+
+	struct Cmd final : Command {
+		explicit Cmd(CommandController& commandController);
+		void execute(span<const TclObject> tokens, TclObject& result) override;
+		[[nodiscard]] std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} recordCommand;
+
+	File file;
+	std::string filename;
+	std::vector<byte> buffer; // not yet written to the file
+	size_t filePos = 0; // number of bytes already written to the file
+	std::vector<Event> events;
+
+	// per chip the recorded device, the YMF278B wave part has its own entry
+	std::array<const SoundDevice*, size_t(Chip::NUM_CHIPS) + 1> owners;
+	std::array<bool, size_t(Chip::NUM_CHIPS)> used;
+	bool sccPlusUsed = false;
+
+	EmuTime startTime = EmuTime::zero();
+	uint32_t ticks = 0; // time of the last written command
+	bool recording = false;
+	bool started = false; // has the first register write happened?
+};
+
+} // namespace openmsx
+
+#endif
@@ -766,6 +766,11 @@ int Y8950::Slot::calc_slot_hat(int lfo_am, int a, int b, int whitenoise)
 	        dB2LinTab[egOut + b]) >> 2;
 }
 
+std::pair<byte, span<const byte>> Y8950::getVGMDataBlock() const
+{
+	return {0x88, adpcm.getRam()}; // Y8950 DELTA-T memory
+}
+
 float Y8950::getAmplificationFactorImpl() const
 {
 	return 1.0f / (1 << DB2LIN_AMP_BITS);
@@ -908,6 +913,7 @@ void Y8950::writeReg(byte rg, byte data, EmuTime::param time)
 		// update the output buffer before changing the register
 		updateStream(time);
 	//}
+	recordVGM(VGMRecorder::Chip::Y8950, 0, rg, data, time);
 
 	switch (rg & 0xe0) {
 	case 0x00: {
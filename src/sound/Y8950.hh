@@ -76,6 +76,7 @@ private:
 	// SoundDevice
 	[[nodiscard]] float getAmplificationFactorImpl() const override;
 	void generateChannels(float** bufs, unsigned num) override;
+	[[nodiscard]] std::pair<byte, span<const byte>> getVGMDataBlock() const override;
 
 	inline void keyOn_BD();
 	inline void keyOn_SD();
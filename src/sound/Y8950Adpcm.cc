@@ -330,6 +330,12 @@ byte Y8950Adpcm::peekReg(byte rg) const
 	}
 }
 
+span<const byte> Y8950Adpcm::getRam() const
+{
+	if (ram.getSize() == 0) return {};
+	return {&ram[0], ram.getSize()};
+}
+
 void Y8950Adpcm::resetStatus()
 {
 	// If the BUF_RDY mask is cleared (e.g. by writing the value 0x80 to
@@ -6,6 +6,7 @@
 #include "Clock.hh"
 #include "serialize_meta.hh"
 #include "openmsx.hh"
+#include "span.hh"
 
 namespace openmsx {
 
@@ -27,6 +28,7 @@ public:
 	[[nodiscard]] int calcSample();
 	void sync(EmuTime::param time);
 	void resetStatus();
+	[[nodiscard]] span<const byte> getRam() const;
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
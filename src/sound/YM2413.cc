@@ -80,6 +80,7 @@ void YM2413::reset(EmuTime::param time)
 {
 	updateStream(time);
 	core->reset();
+	registerLatch = 0;
 }
 
 void YM2413::writePort(bool port, byte value, EmuTime::param time)
@@ -92,12 +93,19 @@ void YM2413::writePort(bool port, byte value, EmuTime::param time)
 	assert(offset < 18);
 
 	core->writePort(port, value, offset);
+
+	if (!port) {
+		registerLatch = value;
+	} else {
+		recordVGM(VGMRecorder::Chip::YM2413, 0, registerLatch, value, time);
+	}
 }
 
 void YM2413::pokeReg(byte reg, byte value, EmuTime::param time)
 {
 	updateStream(time);
 	core->pokeReg(reg, value);
+	recordVGM(VGMRecorder::Chip::YM2413, 0, reg, value, time);
 }
 
 void YM2413::generateChannels(float** bufs, unsigned num)
@@ -110,11 +118,21 @@ float YM2413::getAmplificationFactorImpl() const
 	return core->getAmplificationFactor();
 }
 
+bool YM2413::isIdle() const
+{
+	return core->isIdle();
+}
+
 
+// version 1: initial version
+// version 2: added 'registerLatch'
 template<typename Archive>
-void YM2413::serialize(Archive& ar, unsigned /*version*/)
+void YM2413::serialize(Archive& ar, unsigned version)
 {
 	ar.serializePolymorphic("ym2413", *core);
+	if (ar.versionAtLeast(version, 2)) {
+		ar.serialize("registerLatch", registerLatch);
+	}
 }
 INSTANTIATE_SERIALIZE_METHODS(YM2413);
 
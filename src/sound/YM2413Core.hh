@@ -131,6 +131,14 @@ public:
 	 */
 	[[nodiscard]] virtual float getAmplificationFactor() const = 0;
 
+	/** Is the core in a silent steady state? IOW is the generated output
+	 * silent and will it remain silent until the next register write?
+	 * This allows to completely skip the emulation of an idle YM2413 (see
+	 * SoundDevice::isIdle()). Cores that can't easily detect this state
+	 * return false.
+	 */
+	[[nodiscard]] virtual bool isIdle() const { return false; }
+
 protected:
 	YM2413Core() = default;
 };
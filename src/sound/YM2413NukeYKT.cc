@@ -916,6 +916,20 @@ float YM2413::getAmplificationFactor() const
 	return 1.0f / 256.0f;
 }
 
+bool YM2413::isIdle() const
+{
+	// All slots are released and fully attenuated (they only leave that
+	// state on a key-on), there's no delayed rhythm output, and there are
+	// no pending (register) writes.
+	return !testmode && !test_mode_active && (allowed_offset == 0) &&
+	       !(delay6 | delay7 | delay10 | delay11 | delay12) &&
+	       (write_fm_cycle == uint8_t(-1)) &&
+	       ranges::all_of(writes, [](auto& w) { return w.port == uint8_t(-1); }) &&
+	       ranges::all_of(eg_level, [](auto l) { return l == 0x7f; }) &&
+	       ranges::all_of(eg_state, [](auto s) { return s == EgState::release; }) &&
+	       ranges::none_of(eg_dokon, [](auto d) { return d; });
+}
+
 } // namespace YM2413NukeYKT
 
 
@@ -74,6 +74,7 @@ public:
 	[[nodiscard]] uint8_t peekReg(uint8_t reg) const override;
 	void generateChannels(float* out[9 + 5], uint32_t n) override;
 	[[nodiscard]] float getAmplificationFactor() const override;
+	[[nodiscard]] bool isIdle() const override;
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
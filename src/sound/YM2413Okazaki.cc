@@ -1118,6 +1118,14 @@ ALWAYS_INLINE void YM2413::calcChannel(Channel& ch, float* buf, unsigned num)
 	} while (sample < num);
 }
 
+bool YM2413::isIdle() const
+{
+	// Slots in the FINISH state only leave that state on a key-on.
+	return ranges::none_of(channels, [](const Channel& ch) {
+		return ch.mod.isActive() || ch.car.isActive();
+	});
+}
+
 void YM2413::generateChannels(float* bufs[9 + 5], unsigned num)
 {
 	assert(num != 0);
@@ -142,6 +142,7 @@ public:
 	[[nodiscard]] uint8_t peekReg(uint8_t reg) const override;
 	void generateChannels(float* bufs[9 + 5], unsigned num) override;
 	[[nodiscard]] float getAmplificationFactor() const override;
+	[[nodiscard]] bool isIdle() const override;
 
 	[[nodiscard]] Patch& getPatch(unsigned instrument, bool carrier);
 
@@ -481,12 +481,6 @@ static constexpr SinTab getSinTab()
 constexpr SinTab sin = getSinTab();
 
 
-// TODO clean this up
-static int phase_modulation;  // phase modulation input (SLOT 2)
-static int phase_modulation2; // phase modulation input (SLOT 3
-                              // in 4 operator channels)
-
-
 YMF262::Slot::Slot()
 	: Cnt(0), Incr(0)
 {
@@ -675,7 +669,7 @@ inline int YMF262::Slot::op_calc(unsigned phase, unsigned lfo_am) const
 
 // calculate output of a standard 2 operator channel
 // (or 1st part of a 4-op channel)
-void YMF262::Channel::chan_calc(unsigned lfo_am)
+void YMF262::Channel::chan_calc(unsigned lfo_am, int& phase_modulation, int& phase_modulation2)
 {
 	// !! something is wrong with this, it caused bug
 	// !!    [2823673] moonsound 4 operator FM fail
@@ -714,7 +708,7 @@ void YMF262::Channel::chan_calc(unsigned lfo_am)
 }
 
 // calculate output of a 2nd part of 4-op channel
-void YMF262::Channel::chan_calc_ext(unsigned lfo_am)
+void YMF262::Channel::chan_calc_ext(unsigned lfo_am, int& phase_modulation, int phase_modulation2)
 {
 	// !! see remark in chan_cal(), something is wrong with this
 	// !! optimization disabled for now
@@ -1059,6 +1053,9 @@ void YMF262::writeReg(unsigned r, byte v, EmuTime::param time)
 void YMF262::writeReg512(unsigned r, byte v, EmuTime::param time)
 {
 	updateStream(time); // TODO optimize only for regs that directly influence sound
+	// the FM part of the YMF278 uses VGM ports 0 and 1 of that chip
+	recordVGM(isYMF278 ? VGMRecorder::Chip::YMF278B : VGMRecorder::Chip::YMF262,
+	          byte(r >> 8), byte(r), v, time);
 	writeRegDirect(r, v, time);
 }
 void YMF262::writeRegDirect(unsigned r, byte v, EmuTime::param time)
@@ -1503,7 +1500,7 @@ byte YMF262::peekStatus() const
 	return status | status2;
 }
 
-bool YMF262::checkMuteHelper()
+bool YMF262::checkMuteHelper() const
 {
 	// TODO this doesn't always mute when possible
 	for (auto& ch : channel) {
@@ -1540,6 +1537,12 @@ float YMF262::getAmplificationFactorImpl() const
 	return 1.0f / 4096.0f;
 }
 
+bool YMF262::isIdle() const
+{
+	// muted slots remain muted until the next key-on
+	return checkMuteHelper();
+}
+
 void YMF262::generateChannels(float** bufs, unsigned num)
 {
 	// TODO implement per-channel mute (instead of all-or-nothing)
@@ -1574,31 +1577,31 @@ void YMF262::generateChannels(float** bufs, unsigned num)
 				auto& ch0 = channel[k + i + 0];
 				auto& ch3 = channel[k + i + 3];
 				// extended 4op ch#0 part 1 or 2op ch#0
-				ch0.chan_calc(lfo_am);
+				ch0.chan_calc(lfo_am, phase_modulation, phase_modulation2);
 				if (ch0.extended) {
 					// extended 4op ch#0 part 2
-					ch3.chan_calc_ext(lfo_am);
+					ch3.chan_calc_ext(lfo_am, phase_modulation, phase_modulation2);
 				} else {
 					// standard 2op ch#3
-					ch3.chan_calc(lfo_am);
+					ch3.chan_calc(lfo_am, phase_modulation, phase_modulation2);
 				}
 			}
 		}
 
 		// channels 6,7,8 rhythm or 2op mode
 		if (!rhythmEnabled) {
-			channel[6].chan_calc(lfo_am);
-			channel[7].chan_calc(lfo_am);
-			channel[8].chan_calc(lfo_am);
+			channel[6].chan_calc(lfo_am, phase_modulation, phase_modulation2);
+			channel[7].chan_calc(lfo_am, phase_modulation, phase_modulation2);
+			channel[8].chan_calc(lfo_am, phase_modulation, phase_modulation2);
 		} else {
 			// Rhythm part
 			chan_calc_rhythm(lfo_am);
 		}
 
 		// channels 15,16,17 are fixed 2-operator channels only
-		channel[15].chan_calc(lfo_am);
-		channel[16].chan_calc(lfo_am);
-		channel[17].chan_calc(lfo_am);
+		channel[15].chan_calc(lfo_am, phase_modulation, phase_modulation2);
+		channel[16].chan_calc(lfo_am, phase_modulation, phase_modulation2);
+		channel[17].chan_calc(lfo_am, phase_modulation, phase_modulation2);
 
 		for (auto i : xrange(18)) {
 			bufs[i][2 * j + 0] += int(chanout[i] & pan[4 * i + 0]);
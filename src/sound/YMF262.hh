@@ -115,8 +115,8 @@ private:
 	class Channel {
 	public:
 		Channel();
-		void chan_calc(unsigned lfo_am);
-		void chan_calc_ext(unsigned lfo_am);
+		void chan_calc(unsigned lfo_am, int& phase_modulation, int& phase_modulation2);
+		void chan_calc_ext(unsigned lfo_am, int& phase_modulation, int phase_modulation2);
 
 		template<typename Archive>
 		void serialize(Archive& ar, unsigned version);
@@ -144,6 +144,7 @@ private:
 	// SoundDevice
 	[[nodiscard]] float getAmplificationFactorImpl() const override;
 	void generateChannels(float** bufs, unsigned num) override;
+	[[nodiscard]] bool isIdle() const override;
 
 	void callback(byte flag) override;
 
@@ -163,7 +164,7 @@ private:
 	void set_ksl_tl(unsigned sl, byte v);
 	void set_ar_dr(unsigned sl, byte v);
 	void set_sl_rr(unsigned sl, byte v);
-	bool checkMuteHelper();
+	[[nodiscard]] bool checkMuteHelper() const;
 
 	[[nodiscard]] inline bool isExtended(unsigned ch) const;
 	[[nodiscard]] inline Channel& getFirstOfPair(unsigned ch);
@@ -192,6 +193,9 @@ private:
 	IRQHelper irq;
 
 	int chanout[18]; // 18 channels
+	int phase_modulation;  // phase modulation input (SLOT 2)
+	int phase_modulation2; // phase modulation input (SLOT 3
+	                       // in 4 operator channels)
 
 	byte reg[512];
 	Channel channel[18];	// OPL3 chips have 18 channels
@@ -451,7 +451,7 @@ int16_t YMF278::getSample(Slot& op) const
 	}
 }
 
-bool YMF278::anyActive()
+bool YMF278::anyActive() const
 {
 	return ranges::any_of(slots, [](auto& op) { return op.state != EG_OFF; });
 }
@@ -483,6 +483,18 @@ void YMF278::setMixLevel(uint8_t x, EmuTime::param time)
 	setSoftwareVolume(level[x & 7], level[(x >> 3) & 7], time);
 }
 
+std::pair<byte, span<const byte>> YMF278::getVGMDataBlock() const
+{
+	if (ram.getSize() == 0) return {0x87, {}};
+	return {0x87, {&ram[0], ram.getSize()}}; // YMF278B RAM data
+}
+
+bool YMF278::isIdle() const
+{
+	// slots only leave the EG_OFF state on a key-on
+	return !anyActive();
+}
+
 void YMF278::generateChannels(float** bufs, unsigned num)
 {
 	if (!anyActive()) {
@@ -570,6 +582,7 @@ void YMF278::keyOnHelper(YMF278::Slot& slot)
 void YMF278::writeReg(byte reg, byte data, EmuTime::param time)
 {
 	updateStream(time); // TODO optimize only for regs that directly influence sound
+	recordVGM(VGMRecorder::Chip::YMF278B, 2, reg, data, time); // wave part is port 2
 	writeRegDirect(reg, data, time);
 }
 
@@ -89,12 +89,14 @@ private:
 
 	// SoundDevice
 	void generateChannels(float** bufs, unsigned num) override;
+	[[nodiscard]] bool isIdle() const override;
+	[[nodiscard]] std::pair<byte, span<const byte>> getVGMDataBlock() const override;
 
 	void writeRegDirect(byte reg, byte data, EmuTime::param time);
 	[[nodiscard]] unsigned getRamAddress(unsigned addr) const;
 	[[nodiscard]] int16_t getSample(Slot& op) const;
 	void advance();
-	[[nodiscard]] bool anyActive();
+	[[nodiscard]] bool anyActive() const;
 	void keyOnHelper(Slot& slot);
 
 	MSXMotherBoard& motherBoard;
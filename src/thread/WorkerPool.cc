@@ -0,0 +1,99 @@
+#include "WorkerPool.hh"
+#include "ranges.hh"
+#include "stl.hh"
+#include "xrange.hh"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace openmsx {
+
+WorkerPool::WorkerPool(unsigned numThreads)
+{
+	if (numThreads == 0) {
+		numThreads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	}
+	threads.reserve(numThreads);
+	repeat(numThreads, [&] {
+		threads.emplace_back([this]() { run(); });
+	});
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		exitLoop = true;
+	}
+	jobAvailable.notify_all();
+	for (auto& t : threads) t.join();
+}
+
+std::future<void> WorkerPool::submit(std::function<void()> job, const void* group)
+{
+	std::promise<void> done;
+	auto result = done.get_future();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({std::move(job), std::move(done), group});
+	}
+	jobAvailable.notify_one();
+	return result;
+}
+
+void WorkerPool::wait(const void* group)
+{
+	assert(group);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		auto it = ranges::find_if(jobs, [&](auto& j) { return j.group == group; });
+		if (it != jobs.end()) {
+			auto job = std::move(*it);
+			jobs.erase(it);
+			execute(job, lock);
+		} else if (contains(running, group)) {
+			groupDone.wait(lock);
+		} else {
+			return;
+		}
+	}
+}
+
+void WorkerPool::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [&] { return jobs.empty() && (busy == 0); });
+}
+
+void WorkerPool::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		jobAvailable.wait(lock, [&] { return exitLoop || !jobs.empty(); });
+		if (jobs.empty()) return; // exitLoop, and no more pending jobs
+
+		auto job = std::move(jobs.front());
+		jobs.pop_front();
+		execute(job, lock);
+	}
+}
+
+void WorkerPool::execute(Job& job, std::unique_lock<std::mutex>& lock)
+{
+	++busy;
+	if (job.group) running.push_back(job.group);
+	lock.unlock();
+	job.function();
+	// Release the resources held by the job before signaling its
+	// completion (also this must not hold the lock).
+	job.function = nullptr;
+	job.done.set_value();
+	lock.lock();
+	if (job.group) {
+		move_pop_back(running, rfind_unguarded(running, job.group));
+		groupDone.notify_all();
+	}
+	if ((--busy == 0) && jobs.empty()) idle.notify_all();
+}
+
+} // namespace openmsx
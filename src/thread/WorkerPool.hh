@@ -0,0 +1,77 @@
+#ifndef WORKERPOOL_HH
+#define WORKERPOOL_HH
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openmsx {
+
+/** A fixed set of background threads that execute submitted jobs.
+  *
+  * Jobs are started in the order they were submitted, but when there is
+  * more than one thread they may run (and finish) concurrently. Jobs must
+  * not throw. On destruction all still pending jobs are executed before
+  * the threads are joined.
+  *
+  * There's one pool for all of openMSX (see Reactor::getWorkerPool()), so a
+  * job may have to wait behind unrelated jobs. Code that needs the result
+  * right away should submit its jobs in a group and use wait(group).
+  */
+class WorkerPool
+{
+public:
+	/** @param numThreads The number of threads, 0 means: one less than
+	  *        the number of hardware threads (but at least one). */
+	explicit WorkerPool(unsigned numThreads = 0);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	/** Queue a job for execution on one of the worker threads. The
+	  * returned future can be used to wait for its completion.
+	  * @param group Optional, identifies the job for wait(). */
+	std::future<void> submit(std::function<void()> job,
+	                         const void* group = nullptr);
+
+	/** Wait till all jobs of the given group are finished. The jobs of
+	  * that group that didn't start yet are executed on the calling
+	  * thread. So this never waits behind jobs of other groups, and it's
+	  * also safe to call from within a job. */
+	void wait(const void* group);
+
+	/** Wait till all submitted jobs are finished. */
+	void waitIdle();
+
+	[[nodiscard]] unsigned getNumThreads() const { return unsigned(threads.size()); }
+
+private:
+	struct Job {
+		std::function<void()> function;
+		std::promise<void> done;
+		const void* group;
+	};
+
+	void run();
+	void execute(Job& job, std::unique_lock<std::mutex>& lock);
+
+private:
+	std::vector<std::thread> threads;
+	std::deque<Job> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable idle;
+	std::condition_variable groupDone;
+	std::vector<const void*> running; // groups of the executing jobs
+	unsigned busy = 0;
+	bool exitLoop = false;
+};
+
+} // namespace openmsx
+
+#endif
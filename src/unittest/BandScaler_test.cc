@@ -0,0 +1,203 @@
+#include "catch.hpp"
+#include "BandScaler.hh"
+#include "HQ2xScaler.hh"
+#include "HQ2xLiteScaler.hh"
+#include "HQ3xScaler.hh"
+#include "HQ3xLiteScaler.hh"
+#include "PixelOperations.hh"
+#include "RawFrame.hh"
+#include "SaI2xScaler.hh"
+#include "SaI3xScaler.hh"
+#include "Scale2xScaler.hh"
+#include "Scale3xScaler.hh"
+#include "Scaler1.hh"
+#include "ScalerOutput.hh"
+#include "WorkerPool.hh"
+#include "xrange.hh"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+
+// Scales to a memory buffer. Lines can be acquired and released concurrently.
+template<typename Pixel>
+class MemoryScalerOutput final : public ScalerOutput<Pixel>
+{
+public:
+	MemoryScalerOutput(unsigned width_, unsigned height_)
+		: width(width_), height(height_), pixels(size_t(width) * height) {}
+
+	[[nodiscard]] unsigned getWidth()  const override { return width; }
+	[[nodiscard]] unsigned getHeight() const override { return height; }
+	[[nodiscard]] Pixel* acquireLine(unsigned y) override {
+		return &pixels[size_t(y) * width];
+	}
+	void releaseLine(unsigned /*y*/, Pixel* /*buf*/) override {}
+	void fillLine(unsigned y, Pixel color) override {
+		for (auto x : xrange(width)) pixels[size_t(y) * width + x] = color;
+	}
+
+	[[nodiscard]] const std::vector<Pixel>& getPixels() const { return pixels; }
+
+private:
+	unsigned width, height;
+	std::vector<Pixel> pixels;
+};
+
+// PixelOperations and FrameSource keep a reference to the format.
+template<typename Pixel> static const PixelFormat& getPixelFormat();
+template<> const PixelFormat& getPixelFormat<uint16_t>()
+{
+	static const PixelFormat format(16, 0xF800, 11, 3, 0x07E0, 5, 2, 0x001F, 0, 3, 0, 0, 8);
+	return format;
+}
+template<> const PixelFormat& getPixelFormat<uint32_t>()
+{
+	static const PixelFormat format(32, 0xFF0000, 16, 0, 0x00FF00, 8, 0, 0x0000FF, 0, 0, 0xFF000000, 24, 0);
+	return format;
+}
+
+// A frame with regions of different widths (including blank lines). Only
+// a few colors are used, so that the edge detection of the scalers
+// actually triggers.
+template<typename Pixel>
+static std::unique_ptr<RawFrame> createFrame(unsigned height)
+{
+	auto frame = std::make_unique<RawFrame>(getPixelFormat<Pixel>(), 640, height);
+	std::minstd_rand rng(12345);
+	std::uniform_int_distribution<unsigned> dist(0, 3);
+	const Pixel colors[4] = {Pixel(0), Pixel(0x1234), Pixel(0x8421), Pixel(-1)};
+	for (auto y : xrange(height)) {
+		auto* line = frame->template getLinePtrDirect<Pixel>(y);
+		for (auto x : xrange(640)) line[x] = colors[dist(rng)];
+	}
+	return frame;
+}
+
+struct Region { unsigned srcStartY, srcEndY, width; };
+
+template<typename Pixel>
+static std::vector<Pixel> scale(Scaler<Pixel>& scaler, RawFrame& frame,
+                                unsigned factor, const std::vector<Region>& regions,
+                                WorkerPool* pool)
+{
+	MemoryScalerOutput<Pixel> output(320 * factor, frame.getHeight() * factor);
+	for (const auto& r : regions) {
+		for (auto y : xrange(r.srcStartY, r.srcEndY)) {
+			if (r.width == 1) {
+				frame.setBlank<Pixel>(y, Pixel(0x1234));
+			} else {
+				frame.setLineWidth(y, r.width);
+			}
+		}
+	}
+	for (const auto& r : regions) {
+		if (pool) {
+			scaleInBands(scaler, *pool, frame, nullptr,
+			             r.srcStartY, r.srcEndY, r.width,
+			             output, r.srcStartY * factor, r.srcEndY * factor,
+			             1, factor);
+		} else {
+			scaler.scaleImage(frame, nullptr,
+			                  r.srcStartY, r.srcEndY, r.width,
+			                  output, r.srcStartY * factor, r.srcEndY * factor);
+		}
+	}
+	return output.getPixels();
+}
+
+template<typename Pixel>
+using ScalerList = std::vector<std::pair<const char*, std::function<
+	std::unique_ptr<Scaler<Pixel>>(const PixelOperations<Pixel>&)>>>;
+
+template<typename Pixel>
+static ScalerList<Pixel> getScalers(unsigned factor)
+{
+	using P = const PixelOperations<Pixel>&;
+	switch (factor) {
+	case 1:
+		return {{"Scaler1", [](P p) { return std::make_unique<Scaler1<Pixel>>(p); }}};
+	case 2:
+		return {{"SaI2x",    [](P p) { return std::make_unique<SaI2xScaler   <Pixel>>(p); }},
+		        {"Scale2x",  [](P p) { return std::make_unique<Scale2xScaler <Pixel>>(p); }},
+		        {"HQ2x",     [](P p) { return std::make_unique<HQ2xScaler    <Pixel>>(p); }},
+		        {"HQ2xLite", [](P p) { return std::make_unique<HQ2xLiteScaler<Pixel>>(p); }}};
+	default:
+		return {{"SaI3x",    [](P p) { return std::make_unique<SaI3xScaler   <Pixel>>(p); }},
+		        {"Scale3x",  [](P p) { return std::make_unique<Scale3xScaler <Pixel>>(p); }},
+		        {"HQ3x",     [](P p) { return std::make_unique<HQ3xScaler    <Pixel>>(p); }},
+		        {"HQ3xLite", [](P p) { return std::make_unique<HQ3xLiteScaler<Pixel>>(p); }}};
+	}
+}
+
+template<typename Pixel>
+static void testBands(WorkerPool& pool)
+{
+	PixelOperations<Pixel> pixelOps(getPixelFormat<Pixel>());
+	auto frame = createFrame<Pixel>(240);
+	std::vector<Region> regions = {
+		{  0,  10,   1}, // blank
+		{ 10, 120, 320},
+		{120, 130, 640},
+		{130, 230, 320},
+		{230, 240,   1}, // blank
+	};
+	for (auto factor : {1, 2, 3}) {
+		for (auto& [name, create] : getScalers<Pixel>(factor)) {
+			INFO(name << " " << sizeof(Pixel) * 8 << "bpp");
+			auto scaler = create(pixelOps);
+			REQUIRE(scaler->canScaleInBands());
+			auto expected = scale(*scaler, *frame, factor, regions, nullptr);
+			auto banded   = scale(*scaler, *frame, factor, regions, &pool);
+			CHECK((banded == expected)); // don't print the whole images on failure
+		}
+	}
+}
+
+TEST_CASE("BandScaler: same output as sequential scaling")
+{
+	WorkerPool pool(3);
+	testBands<uint16_t>(pool);
+	testBands<uint32_t>(pool);
+}
+
+template<typename Pixel>
+static void benchBands(WorkerPool& pool)
+{
+	using clock = std::chrono::steady_clock;
+	static constexpr int REPEAT = 50;
+	PixelOperations<Pixel> pixelOps(getPixelFormat<Pixel>());
+	auto frame = createFrame<Pixel>(240);
+	std::vector<Region> regions = {{0, 240, 320}};
+	for (auto factor : {1, 2, 3}) {
+		for (auto& [name, create] : getScalers<Pixel>(factor)) {
+			auto scaler = create(pixelOps);
+			auto run = [&](WorkerPool* p) {
+				auto start = clock::now();
+				for (int i = 0; i < REPEAT; ++i) {
+					(void)scale(*scaler, *frame, factor, regions, p);
+				}
+				return std::chrono::duration<double, std::milli>(clock::now() - start).count() / REPEAT;
+			};
+			auto seq = run(nullptr);
+			auto par = run(&pool);
+			std::cout << name << ' ' << sizeof(Pixel) * 8 << "bpp: "
+			          << seq << "ms sequential, " << par << "ms in "
+			          << pool.getNumThreads() + 1 << " bands ("
+			          << seq / par << "x)\n";
+		}
+	}
+}
+
+// Not run by default, run it with:  unittest "[benchmark]"
+TEST_CASE("BandScaler: benchmark", "[.benchmark]")
+{
+	WorkerPool pool;
+	benchBands<uint16_t>(pool);
+	benchBands<uint32_t>(pool);
+}
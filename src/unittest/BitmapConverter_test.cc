@@ -0,0 +1,126 @@
+#include "catch.hpp"
+#include "BitmapConverter.hh"
+#include "xrange.hh"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+
+// Straightforward (one pixel at a time) versions of the BitmapConverter
+// line renderers. The optimized (SIMD) versions must give exactly the same
+// result.
+template<typename Pixel> struct Reference
+{
+	const Pixel* palette16;
+	const Pixel* palette256;
+	const Pixel* palette32768;
+
+	void graphic4(Pixel* out, const byte* vram) const {
+		for (auto i : xrange(128)) {
+			out[2 * i + 0] = palette16[vram[i] >> 4];
+			out[2 * i + 1] = palette16[vram[i] & 15];
+		}
+	}
+	void graphic5(Pixel* out, const byte* vram) const {
+		for (auto i : xrange(128)) {
+			out[4 * i + 0] = palette16[ 0 + ((vram[i] >> 6) & 3)];
+			out[4 * i + 1] = palette16[16 + ((vram[i] >> 4) & 3)];
+			out[4 * i + 2] = palette16[ 0 + ((vram[i] >> 2) & 3)];
+			out[4 * i + 3] = palette16[16 + ((vram[i] >> 0) & 3)];
+		}
+	}
+	void graphic6(Pixel* out, const byte* vram0, const byte* vram1) const {
+		for (auto i : xrange(128)) {
+			out[4 * i + 0] = palette16[vram0[i] >> 4];
+			out[4 * i + 1] = palette16[vram0[i] & 15];
+			out[4 * i + 2] = palette16[vram1[i] >> 4];
+			out[4 * i + 3] = palette16[vram1[i] & 15];
+		}
+	}
+	void graphic7(Pixel* out, const byte* vram0, const byte* vram1) const {
+		for (auto i : xrange(128)) {
+			out[2 * i + 0] = palette256[vram0[i]];
+			out[2 * i + 1] = palette256[vram1[i]];
+		}
+	}
+	void yjk(Pixel* out, const byte* vram0, const byte* vram1, bool yae) const {
+		for (auto i : xrange(64)) {
+			int p[4] = {vram0[2 * i], vram1[2 * i], vram0[2 * i + 1], vram1[2 * i + 1]};
+			int j = (p[2] & 7) + ((p[3] & 3) << 3) - ((p[3] & 4) << 3);
+			int k = (p[0] & 7) + ((p[1] & 3) << 3) - ((p[1] & 4) << 3);
+			for (auto n : xrange(4)) {
+				if (yae && (p[n] & 0x08)) {
+					out[4 * i + n] = palette16[p[n] >> 4];
+				} else {
+					int y = p[n] >> 3;
+					int r = std::clamp(y + j,                   0, 31);
+					int g = std::clamp(y + k,                   0, 31);
+					int b = std::clamp((5 * y - 2 * j - k) / 4, 0, 31);
+					out[4 * i + n] = palette32768[(r << 10) + (g << 5) + b];
+				}
+			}
+		}
+	}
+};
+
+template<typename Pixel> static void test()
+{
+	std::minstd_rand rng(42);
+	std::vector<Pixel> palette16(32), palette256(256), palette32768(32768);
+	auto fill = [&](auto& v) { for (auto& e : v) e = Pixel(rng()); };
+	fill(palette16);
+	fill(palette256);
+	fill(palette32768);
+
+	BitmapConverter<Pixel> converter(palette16.data(), palette256.data(), palette32768.data());
+	Reference<Pixel> ref{palette16.data(), palette256.data(), palette32768.data()};
+
+	// unaligned buffers, to also test the unaligned loads/stores
+	std::vector<byte> vram(1 + 2 * 128);
+	std::vector<Pixel> expected(1 + 512), actual(1 + 512);
+	const byte* vram0 = vram.data() + 1;
+	const byte* vram1 = vram0 + 128;
+	Pixel* exp = expected.data() + 1;
+	Pixel* act = actual.data() + 1;
+
+	auto check = [&](byte mode, bool planar, auto reference, int width) {
+		for (auto iteration : xrange(20)) {
+			(void)iteration;
+			for (auto& b : vram) b = byte(rng());
+			if (iteration == 10) {
+				// palette changes are picked up
+				fill(palette16);
+				converter.palette16Changed();
+			}
+			std::fill(expected.begin(), expected.end(), Pixel(0));
+			std::fill(actual.begin(), actual.end(), Pixel(0));
+			reference();
+			// (only bitmap modes, those don't use the M1 and M2 bits)
+			converter.setDisplayMode(DisplayMode(
+				byte((mode & 0x1C) >> 1), 0, byte((mode & 0x60) >> 2)));
+			if (planar) {
+				converter.convertLinePlanar(act, vram0, vram1);
+			} else {
+				converter.convertLine(act, vram0);
+			}
+			CHECK(std::equal(exp, exp + width, act));
+			CHECK(actual[1 + width] == 0); // no writes past the end
+		}
+	};
+	check(DisplayMode::GRAPHIC4, false, [&] { ref.graphic4(exp, vram0); }, 256);
+	check(DisplayMode::GRAPHIC5, false, [&] { ref.graphic5(exp, vram0); }, 512);
+	check(DisplayMode::GRAPHIC6, true,  [&] { ref.graphic6(exp, vram0, vram1); }, 512);
+	check(DisplayMode::GRAPHIC7, true,  [&] { ref.graphic7(exp, vram0, vram1); }, 256);
+	check(DisplayMode::GRAPHIC7 | DisplayMode::YJK, true,
+	      [&] { ref.yjk(exp, vram0, vram1, false); }, 256);
+	check(DisplayMode::GRAPHIC7 | DisplayMode::YJK | DisplayMode::YAE, true,
+	      [&] { ref.yjk(exp, vram0, vram1, true); }, 256);
+}
+
+TEST_CASE("BitmapConverter")
+{
+	SECTION("16bpp") { test<uint16_t>(); }
+	SECTION("32bpp") { test<uint32_t>(); }
+}
@@ -0,0 +1,81 @@
+#include "catch.hpp"
+#include "CPUProfiler.hh"
+#include <sstream>
+
+using namespace openmsx;
+
+TEST_CASE("CPUProfiler: location")
+{
+	auto loc = CPUProfiler::makeLocation(0x4123, 1, 2, 5);
+	CHECK(CPUProfiler::getAddress(loc) == 0x4123);
+	CHECK(CPUProfiler::getPrimarySlot(loc) == 1);
+	CHECK(CPUProfiler::getSecondarySlot(loc) == 2);
+	CHECK(CPUProfiler::getSegment(loc) == 5);
+	CHECK(CPUProfiler::getName(loc) == "0x4123 (slot 1-2, segment 5)");
+
+	auto loc2 = CPUProfiler::makeLocation(0xC000, 3, -1, -1);
+	CHECK(CPUProfiler::getSecondarySlot(loc2) == -1);
+	CHECK(CPUProfiler::getSegment(loc2) == -1);
+	CHECK(CPUProfiler::getName(loc2) == "0xc000 (slot 3)");
+	CHECK(loc != CPUProfiler::makeLocation(0x4123, 1, 2, 6));
+	CHECK(loc != CPUProfiler::makeLocation(0x4123, 1, -1, 5));
+}
+
+TEST_CASE("CPUProfiler: call graph")
+{
+	using T = CPUProfiler::Transfer;
+	CPUProfiler profiler; // no interface: everything is in slot 0
+
+	auto step = [&](word pc, word sp, uint64_t ticks,
+	                word newPc, word newSp, uint64_t newTicks, T transfer) {
+		profiler.begin(pc, sp, ticks);
+		profiler.end(newPc, newSp, newTicks, transfer);
+	};
+	step(0x4000, 0xF000,  0, 0x4001, 0xF000,  4, T::NONE); // nop
+	step(0x4001, 0xF000,  4, 0x5000, 0xEFFE, 21, T::CALL); // call 0x5000
+	step(0x5000, 0xEFFE, 21, 0x5001, 0xEFFE, 25, T::NONE); //   nop
+	step(0x5001, 0xEFFE, 25, 0x4004, 0xF000, 36, T::NONE); //   ret
+	step(0x4004, 0xF000, 36, 0x0038, 0xEFFE, 49, T::INTERRUPT);
+	step(0x0038, 0xEFFE, 49, 0x4004, 0xF000, 60, T::NONE); //   reti
+
+	auto flat = profiler.getFlatProfile();
+	REQUIRE(flat.size() == 5);
+	CHECK(CPUProfiler::getAddress(flat[0].location) == 0x0038);
+	CHECK(flat[0].cost.ticks == 24); // includes accepting the IRQ
+	CHECK(flat[0].cost.count == 1);
+	CHECK(CPUProfiler::getAddress(flat[1].location) == 0x4001);
+	CHECK(flat[1].cost.ticks == 17);
+	CHECK(CPUProfiler::getAddress(flat[2].location) == 0x5001);
+	CHECK(CPUProfiler::getAddress(flat[3].location) == 0x4000);
+	CHECK(CPUProfiler::getAddress(flat[4].location) == 0x5000);
+
+	std::ostringstream os;
+	profiler.writeCallgrind(os);
+	CHECK(os.str() ==
+		"# callgrind format\n"
+		"version: 1\n"
+		"creator: openMSX\n"
+		"positions: instr\n"
+		"events: Ticks\n"
+		"summary: 60\n"
+		"\n"
+		"fn=0x0038 (slot 0)\n"
+		"0x0038 24\n"
+		"\n"
+		"fn=0x5000 (slot 0)\n"
+		"0x5000 4\n"
+		"0x5001 11\n"
+		"\n"
+		"fn=<root>\n"
+		"0x4000 4\n"
+		"0x4001 17\n"
+		"cfn=0x5000 (slot 0)\n"
+		"calls=1 0x5000\n"
+		"0x4001 15\n"
+		"cfn=0x0038 (slot 0)\n"
+		"calls=1 0x0038\n"
+		"0x4004 24\n");
+
+	profiler.clear();
+	CHECK(profiler.getFlatProfile().empty());
+}
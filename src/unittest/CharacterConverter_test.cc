@@ -0,0 +1,92 @@
+#include "catch.hpp"
+#include "CharacterConverterDraw.hh"
+#include "xrange.hh"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace openmsx;
+
+// Straightforward (one pixel at a time) version of draw6() and draw8(). The
+// optimized (SIMD) versions must give exactly the same result.
+template<typename Pixel>
+static void reference(Pixel* out, Pixel fg, Pixel bg, byte pattern, int width)
+{
+	for (auto i : xrange(width)) {
+		out[i] = (pattern & (0x80 >> i)) ? fg : bg;
+	}
+}
+
+template<typename Pixel> static void test()
+{
+	std::minstd_rand rng(42);
+	std::vector<Pixel> palette(16);
+	auto fill = [&] { for (auto& e : palette) e = Pixel(rng()); };
+
+	// unaligned buffers, to also test the unaligned stores
+	std::vector<Pixel> expected(1 + 512 + 1), actual(1 + 512 + 1);
+	Pixel* exp = expected.data() + 1;
+
+	// Render one line the way the CharacterConverter modes do: 'chars'
+	// characters of 'width' (6 or 8) pixels wide, directly after each
+	// other. 'getChar(n)' returns the colors and pattern of character 'n'.
+	auto check = [&](int chars, int width, auto getChar) {
+		for (auto iteration : xrange(20)) {
+			(void)iteration;
+			fill();
+			std::fill(expected.begin(), expected.end(), Pixel(0));
+			std::fill(actual.begin(), actual.end(), Pixel(0));
+			Pixel* __restrict act = actual.data() + 1;
+			for (auto n : xrange(chars)) {
+				auto [fg, bg, pattern] = getChar(n);
+				reference(exp + n * width, fg, bg, pattern, width);
+				if (width == 6) {
+					draw6(act, fg, bg, pattern);
+				} else {
+					draw8(act, fg, bg, pattern);
+				}
+			}
+			CHECK(act == actual.data() + 1 + chars * width);
+			CHECK(std::equal(exp, exp + chars * width, actual.data() + 1));
+			CHECK(actual[1 + chars * width] == 0); // no writes past the end
+		}
+	};
+	auto randomColor = [&] { return palette[rng() & 15]; };
+	auto randomPattern = [&] { return byte(rng()); };
+
+	// all patterns, both widths
+	for (auto width : {6, 8}) {
+		for (auto base : {0, 64, 128, 192}) {
+			check(64, width, [&](int n) {
+				return std::tuple(randomColor(), randomColor(), byte(base + n));
+			});
+		}
+	}
+
+	// text1 and text1Q (screen 0, width 40)
+	check(40, 6, [&](int /*n*/) {
+		return std::tuple(palette[1], palette[2], randomPattern());
+	});
+	// text2 (screen 0, width 80), with a mix of blink and plain colors
+	check(80, 6, [&](int /*n*/) {
+		bool blink = rng() & 1;
+		return std::tuple(palette[blink ? 3 : 1], palette[blink ? 4 : 2],
+		                  randomPattern());
+	});
+	// graphic1, graphic2 and graphic3 (screen 1, 2 and 4)
+	check(32, 8, [&](int /*n*/) {
+		return std::tuple(randomColor(), randomColor(), randomPattern());
+	});
+	// multicolor and multiQ (screen 3): 4 left, 4 right pixels
+	check(32, 8, [&](int /*n*/) {
+		return std::tuple(randomColor(), randomColor(), byte(0xF0));
+	});
+}
+
+TEST_CASE("CharacterConverter")
+{
+	SECTION("16bpp") { test<uint16_t>(); }
+	SECTION("32bpp") { test<uint32_t>(); }
+}
@@ -0,0 +1,147 @@
+#include "catch.hpp"
+#include "CompiledCondition.hh"
+#include "CommandException.hh"
+#include "Interpreter.hh"
+#include "TclObject.hh"
+#include "one_of.hh"
+#include <optional>
+
+using namespace openmsx;
+
+// A machine with: HL=0xC012, IX=0x8001, A=0x42, PC=0x4321 (so page 1), page 1
+// is in slot 1-2 and memory contains (address * 7 + 3) & 255.
+struct TestContext final : CompiledCondition::Context
+{
+	byte readRegister(unsigned index) override
+	{
+		switch (index) {
+			case  0: return 0x42; // A
+			case  6: return 0xC0; // H
+			case  7: return 0x12; // L
+			case 16: return 0x80; // IXh
+			case 17: return 0x01; // IXl
+			case 20: return 0x43; // PCh
+			case 21: return 0x21; // PCl
+			default: return index;
+		}
+	}
+	byte peekMem(word address) override
+	{
+		return byte(address * 7 + 3);
+	}
+	bool isPCInSlot(int ps, int ss) override
+	{
+		return ((ps == -1) || (ps == 1)) && ((ss == -1) || (ss == 2));
+	}
+};
+
+// The same machine, but as seen from Tcl.
+static void defineProcs(Interpreter& interp)
+{
+	interp.execute(
+		"proc reg {name} {\n"
+		"  switch [string toupper $name] {\n"
+		"    A {return 0x42} H {return 0xC0} L {return 0x12} HL {return 0xC012}\n"
+		"    IX {return 0x8001} PC {return 0x4321} B {return 2} BC {return 0x0203}\n"
+		"  }\n"
+		"  error \"Unknown Z80 register: $name\"\n"
+		"}\n"
+		"proc peek {addr} {\n"
+		"  if {$addr < 0 || $addr >= 0x10000} {error \"Invalid address\"}\n"
+		"  expr {($addr * 7 + 3) & 255}\n"
+		"}\n"
+		"proc peek_s8 {addr} {\n"
+		"  set b [peek $addr]\n"
+		"  expr {($b < 128) ? $b : ($b - 256)}\n"
+		"}\n"
+		"proc peek16 {addr} {\n"
+		"  expr {[peek $addr] + 256 * [peek [expr {$addr + 1}]]}\n"
+		"}\n"
+		"proc peek16_BE {addr} {\n"
+		"  expr {256 * [peek $addr] + [peek [expr {$addr + 1}]]}\n"
+		"}\n"
+		"proc peek_s16 {addr} {\n"
+		"  set w [peek16 $addr]\n"
+		"  expr {($w < 32768) ? $w : ($w - 65536)}\n"
+		"}\n"
+		"proc pc_in_slot {ps {ss X} {mapper X}} {\n"
+		"  if {$ps ne \"X\" && $ps != 1} {return 0}\n"
+		"  if {$ss ne \"X\" && $ss != 2} {return 0}\n"
+		"  return true\n"
+		"}\n");
+}
+
+static std::optional<bool> evalTcl(Interpreter& interp, std::string_view expr)
+{
+	try {
+		return TclObject(expr).evalBool(interp);
+	} catch (CommandException&) {
+		return {};
+	}
+}
+
+TEST_CASE("CompiledCondition: same result as Tcl")
+{
+	Interpreter interp;
+	defineProcs(interp);
+	TestContext context;
+
+	for (std::string_view expr : {
+		"1", "0", "0x10 == 16", "0b101 == 5", "0o17 == 15",
+		"[reg A] == 0x42", "[reg a] == 66", "[reg HL] == 0xC012",
+		"[reg IX] != 0x8001", "[reg PC] >= 0x4000 && [reg PC] < 0x8000",
+		"[peek 0xC000] == 3", "[peek [reg HL]] == ((0xC012 * 7 + 3) & 255)",
+		"[peek16 0x1234] == 0x766f", "[peek16_BE 0x1234] - 0x6f76",
+		"[peek_s8 0x0013]", "[peek_s8 0x0013] < 0", "[peek_s16 0x1234] > 0",
+		"[peek [expr {[reg HL] + 1}]] == 0x88", "[peek 0xFFFF] == 0xFC",
+		"[peek 0x10000]", "[peek16 0xFFFF]", "[peek [expr {-1}]]",
+		"-7 / 2 == -4", "-7 % 2 == 1", "7 % -2 == -1", "7 / -2 == -4",
+		"1 / 0", "5 % 0", "~5 == -6", "!0", "!5", "- -3 == 3", "+3",
+		"1 << 62 > 0", "1 << 63", "1 << 64", "-8 >> 1 == -4", "1 >> 70",
+		"-1 >> 70", "3 << -1", "9223372036854775807 + 1 > 0",
+		"-1 << 63 < 0", "-3 << 62", "3 << 62", "-9223372036854775807 - 2",
+		"-9223372036854775807 - 1 < 0", "4611686018427387904 * 2",
+		"-4611686018427387904 * 2 < 0", "-4611686018427387904 * -2",
+		"3037000500 * 3037000500", "(-9223372036854775807 - 1) / -1",
+		"(-9223372036854775807 - 1) % -1 == 0", "7 / -1 == -7",
+		"(2 + 3) * 4 == 20", "2 + 3 * 4 == 14", "1 < 2 == 1",
+		"6 & 3 ^ 1 | 8", "1 | 2 & 0", "0 && 1 / 0", "1 || 1 / 0",
+		"5 && 7", "0 || 7", "1 ? 2 : 0", "0 ? 1 / 0 : 0",
+		"0 ? 1 : 0 ? 1 : 1", "[reg A] == 0x42 ? [peek 0] : 0",
+		"[pc_in_slot 1]", "[pc_in_slot 1 2]", "[pc_in_slot 1 3]",
+		"[pc_in_slot 0]", "[pc_in_slot X 2]", "[pc_in_slot 1 X X]",
+		" \t[reg B]\n== 2 ", "[reg   BC] == 0x0203",
+	}) {
+		INFO(expr);
+		auto compiled = CompiledCondition::compile(expr);
+		REQUIRE(compiled);
+		auto native = compiled->evaluate(context);
+		auto tcl = evalTcl(interp, expr);
+		if (native) {
+			CHECK(tcl == native);
+		} else {
+			// Either an error or a result that doesn't fit in 64
+			// bit. In both cases Tcl must handle it.
+			CHECK((!tcl || (expr == one_of(
+				"1 << 63", "1 << 64", "9223372036854775807 + 1 > 0",
+				"-3 << 62", "3 << 62", "-9223372036854775807 - 2",
+				"4611686018427387904 * 2", "-4611686018427387904 * -2",
+				"3037000500 * 3037000500",
+				"(-9223372036854775807 - 1) / -1"))));
+		}
+	}
+}
+
+TEST_CASE("CompiledCondition: unsupported expressions")
+{
+	for (std::string_view expr : {
+		"", "$x == 1", "[reg A] eq 1", "010 == 8", "1.5 > 1", "2 ** 3",
+		"abs(-1)", "\"1\" == 1", "{1} == 1", "[reg XY]", "[peek 0 VRAM]",
+		"[peek $addr]", "[peek 0x[reg A]]", "[reg A; reg B]",
+		"[pc_in_slot 1 2 3]", "[expr $x]", "1 +", "(1", "1 ? 2",
+		"[reg A] == 1 1", "[puts hello]",
+	}) {
+		INFO(expr);
+		CHECK(!CompiledCondition::compile(expr));
+	}
+}
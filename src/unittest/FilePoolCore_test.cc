@@ -4,8 +4,10 @@
 #include "File.hh"
 #include "FileOperations.hh"
 #include "one_of.hh"
+#include "ranges.hh"
 #include "StringOp.hh"
 #include "Timer.hh"
+#include "WorkerPool.hh"
 #include <iostream>
 #include <fstream>
 
@@ -42,12 +44,14 @@ TEST_CASE("FilePoolCore")
 		result.push_back(FilePoolCore::Dir{tmp, FileType::ROM});
 		return result;
 	};
+	WorkerPool workerPool;
 
 	{
 		// create pool
 		FilePoolCore pool(tmp + "/cache",
 				  getDirectories,
-				  [](std::string_view) { /* report progress: nothing */});
+				  [](std::string_view) { /* report progress: nothing */},
+				  workerPool);
 
 		// lookup, success
 		{
@@ -133,3 +137,63 @@ TEST_CASE("FilePoolCore")
 
 	FileOperations::deleteRecursive(tmp);
 }
+
+TEST_CASE("FilePoolCore: prefetch and unchanged directories")
+{
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest2";
+	auto poolDir = tmp + "/pool";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(poolDir + "/sub");
+	createFile(tmp + "/pool/a",     "aaa"); // 7e240de74fb1ed08fa08d38063f6a6a91462a815
+	createFile(tmp + "/pool/sub/b", "bbb"); // 5cb138284d431abd6a053a56625ec088bfb88912
+	// directories modified in the current second are not summarized
+	Timer::sleep(1'000'000);
+
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		result.push_back(FilePoolCore::Dir{poolDir, FileType::ROM});
+		return result;
+	};
+	auto noProgress = [](std::string_view) {};
+	WorkerPool workerPool;
+
+	{
+		FilePoolCore pool(tmp + "/cache", getDirectories, noProgress, workerPool);
+		pool.startPrefetch();
+		auto file = pool.getFile(FileType::ROM, Sha1Sum("5cb138284d431abd6a053a56625ec088bfb88912"));
+		CHECK(file.is_open());
+		CHECK(file.getURL() == tmp + "/pool/sub/b");
+	}
+	auto dirs = readLines(tmp + "/cache.dirs");
+	CHECK(dirs.size() == 5); // 2 directories, 1 subdirectory name, 2 files
+	CHECK(ranges::count_if(dirs, [](auto& l) { return l == "\tsub/"; }) == 1);
+	CHECK(ranges::count_if(dirs, [](auto& l) { return l == "\ta"; }) == 1);
+
+	{
+		FilePoolCore pool(tmp + "/cache", getDirectories, noProgress, workerPool);
+		auto file = pool.getFile(FileType::ROM, Sha1Sum("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
+		CHECK(!file.is_open());
+
+		// A new file does change the directory timestamp.
+		createFile(tmp + "/pool/sub/c", "ccc"); // f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2
+		file = pool.getFile(FileType::ROM, Sha1Sum("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
+		CHECK(file.is_open());
+		CHECK(file.getURL() == tmp + "/pool/sub/c");
+
+		// Files in unchanged directories are still found via the cache.
+		file = pool.getFile(FileType::ROM, Sha1Sum("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
+		CHECK(file.is_open());
+		CHECK(file.getURL() == tmp + "/pool/a");
+
+		// A file that's overwritten in-place doesn't change the
+		// directory timestamp, but it's still found.
+		createFile(tmp + "/pool/a", "ddd"); // 9c969ddf454079e3d439973bbab63ea6233e4087
+		file = pool.getFile(FileType::ROM, Sha1Sum("9c969ddf454079e3d439973bbab63ea6233e4087"));
+		CHECK(file.is_open());
+		CHECK(file.getURL() == tmp + "/pool/a");
+		file = pool.getFile(FileType::ROM, Sha1Sum("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
+		CHECK(!file.is_open());
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
@@ -0,0 +1,149 @@
+#include "catch.hpp"
+#include "InstructionTrace.hh"
+#include "CPURegs.hh"
+#include "xrange.hh"
+#include <chrono>
+#include <iostream>
+
+using namespace openmsx;
+
+TEST_CASE("InstructionTrace: round trip")
+{
+	using Kind = InstructionTrace::Kind;
+	InstructionTrace trace;
+	trace.setSize(1); // rounded up to one chunk
+	CHECK(trace.getSize() == InstructionTrace::CHUNK_SIZE);
+
+	CPURegs regs(false);
+	regs.setSP(0xF000);
+
+	const byte ld[] = {0x21, 0x34, 0x12}; // ld hl,#1234
+	trace.begin(0x4000, ld, Kind::INSTRUCTION, 100);
+	regs.setHL(0x1234);
+	trace.end(regs);
+
+	const byte ldi[] = {0xED, 0xA0}; // ldi
+	trace.begin(0x4003, ldi, Kind::INSTRUCTION, 111);
+	CHECK(trace.isPending());
+	trace.access(false, 0x1234, 0x56);
+	trace.access(true, 0x8000, 0x56);
+	trace.end(regs);
+	CHECK(!trace.isPending());
+	trace.access(true, 0x8000, 0x56); // ignored, not part of a record
+
+	trace.begin(0x4005, {}, Kind::IRQ, 127);
+	regs.setSP(0xEFFE);
+	for (auto i : xrange(InstructionTrace::MAX_ACCESSES + 1)) {
+		trace.access(true, word(0xEFFE + i), byte(i)); // last one is dropped
+	}
+	trace.end(regs);
+
+	const byte ix[] = {0xDD, 0x23}; // inc ix
+	trace.begin(0x0038, ix, Kind::INSTRUCTION, 140);
+	regs.setIX(1);
+	trace.end(regs);
+
+	InstructionTrace::Reader reader(trace);
+	InstructionTrace::Entry e;
+	REQUIRE(reader.next(e));
+	CHECK(e.ticks == 100);
+	CHECK(e.pc == 0x4000);
+	CHECK(e.kind == Kind::INSTRUCTION);
+	CHECK(e.length == 3);
+	CHECK(e.opcode[0] == 0x21);
+	CHECK(e.opcode[2] == 0x12);
+	CHECK(e.regs[3] == 0x1234); // HL
+	CHECK(e.regs[6] == 0xF000); // SP
+
+	CHECK(e.numAccesses == 0);
+
+	REQUIRE(reader.next(e));
+	CHECK(e.ticks == 111);
+	CHECK(e.pc == 0x4003);
+	CHECK(e.length == 2);
+	REQUIRE(e.numAccesses == 2);
+	CHECK(e.accesses[0].address == 0x1234);
+	CHECK(e.accesses[0].value == 0x56);
+	CHECK(!e.accesses[0].write);
+	CHECK(e.accesses[1].address == 0x8000);
+	CHECK(e.accesses[1].write);
+
+	REQUIRE(reader.next(e));
+	CHECK(e.ticks == 127);
+	CHECK(e.pc == 0x4005);
+	CHECK(e.kind == Kind::IRQ);
+	CHECK(e.length == 0);
+	CHECK(e.regs[6] == 0xEFFE);
+	REQUIRE(e.numAccesses == InstructionTrace::MAX_ACCESSES);
+	CHECK(e.accesses[7].address == 0xF005);
+	CHECK(e.accesses[7].value == 7);
+
+	REQUIRE(reader.next(e));
+	CHECK(e.ticks == 140);
+	CHECK(e.pc == 0x0038);
+	CHECK(e.length == 2);
+	CHECK(e.numAccesses == 0);
+	CHECK(e.regs[3] == 0x1234);
+	CHECK(e.regs[4] == 0x0001); // IX
+
+	CHECK(!reader.next(e));
+
+	trace.clear();
+	InstructionTrace::Reader reader2(trace);
+	CHECK(!reader2.next(e));
+}
+
+TEST_CASE("InstructionTrace: ring buffer")
+{
+	using Kind = InstructionTrace::Kind;
+	InstructionTrace trace;
+	trace.setSize(2 * InstructionTrace::CHUNK_SIZE);
+
+	// every instruction changes a register, so this fills several chunks
+	CPURegs regs(false);
+	const byte inc[] = {0x23}; // inc hl
+	unsigned num = 10000;
+	for (auto i : xrange(num)) {
+		trace.begin(word(i), inc, Kind::INSTRUCTION, 6 * i);
+		regs.setHL(i + 1);
+		trace.end(regs);
+	}
+
+	// only the most recent instructions are still available, in order
+	InstructionTrace::Reader reader(trace);
+	InstructionTrace::Entry e;
+	REQUIRE(reader.next(e));
+	unsigned first = e.pc;
+	CHECK(first > 0);
+	unsigned count = 1;
+	while (reader.next(e)) {
+		CHECK(e.pc == word(first + count));
+		CHECK(e.ticks == 6 * (first + count));
+		CHECK(e.regs[3] == word(first + count + 1));
+		++count;
+	}
+	CHECK(first + count == num);
+}
+
+// Not run by default, run it with:  unittest "[benchmark]"
+TEST_CASE("InstructionTrace: benchmark", "[.benchmark]")
+{
+	// The cost per instruction of recording in the CPU loop, with (on
+	// average) one register change and one memory access per instruction.
+	using Kind = InstructionTrace::Kind;
+	using clock = std::chrono::steady_clock;
+	InstructionTrace trace;
+	trace.setSize(size_t(16) << 20);
+	CPURegs regs(false);
+	const byte ld[] = {0x77}; // ld (hl),a
+	unsigned num = 10'000'000;
+	auto start = clock::now();
+	for (auto i : xrange(num)) {
+		trace.begin(word(i), ld, Kind::INSTRUCTION, 8 * uint64_t(i));
+		trace.access(true, word(i), byte(i));
+		regs.setHL(i);
+		trace.end(regs);
+	}
+	auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	std::cout << "record: " << ns / num << "ns/instruction\n";
+}
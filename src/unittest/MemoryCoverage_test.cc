@@ -0,0 +1,207 @@
+#include "catch.hpp"
+#include "MemoryCoverage.hh"
+#include "MSXException.hh"
+#include "xrange.hh"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace openmsx;
+
+TEST_CASE("MemoryCoverage: count")
+{
+	byte rom[16] = {};
+	byte ram[32] = {};
+	MemoryCoverage coverage;
+	coverage.registerMemory("rom", rom);
+	coverage.registerMemory("ram", ram);
+	coverage.setEnabled(true);
+
+	coverage.count(MemoryCoverage::EXEC, &rom[3]);
+	coverage.count(MemoryCoverage::EXEC, &rom[3]);
+	coverage.count(MemoryCoverage::READ, &ram[31]);
+	coverage.count(MemoryCoverage::WRITE, &ram[0]);
+	byte other = 0;
+	coverage.count(MemoryCoverage::READ, &other); // ignored
+
+	const auto& regions = coverage.getRegions();
+	REQUIRE(regions.size() == 2);
+	CHECK(regions[0].name == "rom");
+	CHECK(regions[0].counts[MemoryCoverage::EXEC][3] == 2);
+	CHECK(regions[0].counts[MemoryCoverage::READ][3] == 0);
+	CHECK(regions[1].counts[MemoryCoverage::READ][31] == 1);
+	CHECK(regions[1].counts[MemoryCoverage::WRITE][0] == 1);
+
+	// counters are kept when the memory is removed ...
+	coverage.unregisterMemory(rom);
+	REQUIRE(regions.size() == 2);
+	CHECK(regions[0].data == nullptr);
+	coverage.count(MemoryCoverage::EXEC, &rom[3]); // ignored
+	CHECK(regions[0].counts[MemoryCoverage::EXEC][3] == 2);
+	// ... and continue when it comes back
+	coverage.registerMemory("rom", rom);
+	coverage.count(MemoryCoverage::EXEC, &rom[3]);
+	CHECK(regions[0].counts[MemoryCoverage::EXEC][3] == 3);
+
+	coverage.unregisterMemory(rom);
+	coverage.clear();
+	REQUIRE(regions.size() == 1);
+	CHECK(regions[0].name == "ram");
+	CHECK(regions[0].counts[MemoryCoverage::READ][31] == 0);
+}
+
+TEST_CASE("MemoryCoverage: LineCache")
+{
+	// CPU address space: 'ram' at 0x8000-0xBFFF, 'small' at 0x4000-0x400F
+	std::vector<byte> ram(0x4000);
+	byte small[16] = {};
+	MemoryCoverage coverage;
+	coverage.registerMemory("ram", ram);
+	coverage.registerMemory("small", small);
+	coverage.setEnabled(true);
+	MemoryCoverage::LineCache lines(coverage);
+	const byte* ramLine = ram.data() - 0x8000;
+	const byte* smallLine = small - 0x4000;
+	byte other[256] = {};
+	const byte* otherLine = other - 0xC000;
+
+	lines.count(MemoryCoverage::EXEC, ramLine, 0x8000);
+	lines.count(MemoryCoverage::EXEC, ramLine, 0x8000);
+	lines.count(MemoryCoverage::READ, ramLine, 0xBFFF);
+	lines.count(MemoryCoverage::WRITE, ramLine, 0x9234);
+	lines.count(MemoryCoverage::READ, smallLine, 0x400F); // partly covered line
+	lines.count(MemoryCoverage::READ, otherLine, 0xC000); // ignored
+
+	const auto& regions = coverage.getRegions();
+	REQUIRE(regions.size() == 2);
+	CHECK(regions[0].counts[MemoryCoverage::EXEC][0] == 2);
+	CHECK(regions[0].counts[MemoryCoverage::READ][0x3FFF] == 1);
+	CHECK(regions[0].counts[MemoryCoverage::WRITE][0x1234] == 1);
+	CHECK(regions[0].counts[MemoryCoverage::READ][0x1234] == 0);
+	CHECK(regions[1].counts[MemoryCoverage::READ][15] == 1);
+
+	// the same CPU address now maps to another memory block
+	lines.count(MemoryCoverage::EXEC, small - 0x8000, 0x8000);
+	CHECK(regions[1].counts[MemoryCoverage::EXEC][0] == 1);
+	CHECK(regions[0].counts[MemoryCoverage::EXEC][0] == 2);
+
+	// and back, after the memory was removed and reinserted
+	coverage.unregisterMemory(ram.data());
+	lines.count(MemoryCoverage::EXEC, ramLine, 0x8000); // ignored
+	CHECK(regions[0].counts[MemoryCoverage::EXEC][0] == 2);
+	coverage.registerMemory("ram", ram);
+	lines.count(MemoryCoverage::EXEC, ramLine, 0x8000);
+	CHECK(regions[0].counts[MemoryCoverage::EXEC][0] == 3);
+}
+
+TEST_CASE("MemoryCoverage: save, load and merge")
+{
+	byte ram[8] = {};
+	MemoryCoverage coverage;
+	coverage.registerMemory("ram", ram);
+	coverage.setEnabled(true);
+	coverage.count(MemoryCoverage::EXEC, &ram[1]);
+	coverage.count(MemoryCoverage::WRITE, &ram[7]);
+
+	std::ostringstream os;
+	MemoryCoverage::save(os, coverage.getRegions());
+	auto str = os.str();
+	span<const uint8_t> buf(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+
+	auto loaded = MemoryCoverage::load(buf);
+	REQUIRE(loaded.size() == 1);
+	CHECK(loaded[0].name == "ram");
+	CHECK(loaded[0].size == 8);
+	CHECK(loaded[0].counts[MemoryCoverage::EXEC][1] == 1);
+	CHECK(loaded[0].counts[MemoryCoverage::WRITE][7] == 1);
+
+	std::vector<MemoryCoverage::Region> merged;
+	for (int i = 0; i < 2; ++i) {
+		for (const auto& r : MemoryCoverage::load(buf)) {
+			MemoryCoverage::merge(merged, r);
+		}
+	}
+	REQUIRE(merged.size() == 1);
+	CHECK(merged[0].counts[MemoryCoverage::EXEC][1] == 2);
+	CHECK(merged[0].counts[MemoryCoverage::WRITE][7] == 2);
+	CHECK(merged[0].counts[MemoryCoverage::READ][7] == 0);
+
+	MemoryCoverage::Region other{"ram", nullptr, 4, {}};
+	CHECK_THROWS_AS(MemoryCoverage::merge(merged, other), MSXException);
+	CHECK_THROWS_AS(MemoryCoverage::load(buf.first(20)), MSXException);
+	CHECK_THROWS_AS(MemoryCoverage::load(buf.subspan(1)), MSXException);
+}
+
+// Mimics the CPU memory access: per access one load via the cache line and
+// one store (that also prevents the compiler from hoisting the enabled check
+// out of the loop, like the register updates in the CPU emulation do).
+template<typename Count>
+static double benchAccess(const std::vector<const byte*>& cacheLines,
+                          const std::vector<uint16_t>& addresses,
+                          std::vector<byte>& out, Count count)
+{
+	using clock = std::chrono::steady_clock;
+	static constexpr int REPEAT = 20;
+	auto start = clock::now();
+	for (int r = 0; r < REPEAT; ++r) {
+		for (auto i : xrange(addresses.size())) {
+			unsigned address = addresses[i];
+			const byte* line = cacheLines[address >> CacheLine::BITS];
+			out[i & 255] = line[address];
+			count(line, address);
+		}
+	}
+	auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	return ns / (double(REPEAT) * addresses.size());
+}
+
+// Not run by default, run it with:  unittest "[benchmark]"
+TEST_CASE("MemoryCoverage: benchmark", "[.benchmark]")
+{
+	// 4 pages, each mapped to a different memory, plus some more
+	// registered memories that are not mapped
+	std::vector<std::vector<byte>> memories(12, std::vector<byte>(0x4000));
+	MemoryCoverage coverage;
+	for (auto i : xrange(memories.size())) {
+		coverage.registerMemory("mem" + std::to_string(i), memories[memories.size() - 1 - i]);
+	}
+	std::vector<const byte*> cacheLines(CacheLine::NUM);
+	for (auto i : xrange(CacheLine::NUM)) {
+		unsigned page = (i * CacheLine::SIZE) >> 14;
+		cacheLines[i] = memories[page].data() - 0x4000 * page;
+	}
+	std::minstd_rand rng(42);
+	std::vector<uint16_t> addresses(1 << 20);
+	// mostly sequential (code), sometimes a jump or a data access elsewhere
+	uint16_t pc = 0;
+	for (auto& a : addresses) {
+		pc = (rng() % 8) ? uint16_t(pc + 1) : uint16_t(rng());
+		a = pc;
+	}
+	std::vector<byte> out(256);
+	auto* cov = &coverage;
+
+	auto none = benchAccess(cacheLines, addresses, out, [](const byte*, unsigned) {});
+	auto hook = [&](auto slow) {
+		return [&, slow](const byte* line, unsigned address) {
+			if (cov->isEnabled()) slow(line, address);
+		};
+	};
+	MemoryCoverage::LineCache lines(coverage);
+	auto viaLines = [&](const byte* line, unsigned address) {
+		lines.count(MemoryCoverage::EXEC, line, address);
+	};
+	auto viaFind = [&](const byte* line, unsigned address) {
+		cov->count(MemoryCoverage::EXEC, &line[address]);
+	};
+	auto off = benchAccess(cacheLines, addresses, out, hook(viaLines));
+	coverage.setEnabled(true);
+	auto onLines = benchAccess(cacheLines, addresses, out, hook(viaLines));
+	auto onFind = benchAccess(cacheLines, addresses, out, hook(viaFind));
+	std::cout << "no hook:               " << none << "ns/access\n"
+	          << "coverage off:          " << off << "ns/access\n"
+	          << "coverage on (lines):   " << onLines << "ns/access\n"
+	          << "coverage on (find()):  " << onFind << "ns/access\n";
+}
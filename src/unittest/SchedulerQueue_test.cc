@@ -0,0 +1,225 @@
+#include "catch.hpp"
+#include "SchedulerHeap.hh"
+#include "SchedulerQueue.hh"
+#include "xrange.hh"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+
+// Both SchedulerQueue and SchedulerHeap are tested (and benchmarked) by
+// replaying the same sequence of operations. The sequence mimics the usage
+// pattern of the Scheduler: each 'device' has at most a few pending
+// syncpoints, it reschedules itself when its syncpoint is reached, and now
+// and then a device cancels its syncpoint (e.g. because of a register
+// write) and sets a new one.
+
+struct SP {
+	uint64_t time;
+	int device;
+	[[nodiscard]] uint64_t getTime() const { return time; }
+};
+struct LessSP {
+	bool operator()(const SP& x, const SP& y) const { return x.time < y.time; }
+};
+static const SP SENTINEL = {std::numeric_limits<uint64_t>::max(), -1};
+
+struct Op {
+	enum Type { INSERT, REMOVE, POP } type;
+	SP sp; // time only for INSERT, device for INSERT/REMOVE
+};
+
+// Generate a trace for a machine with 'numDevices' devices that each
+// reschedule themselves with a (device specific) period.
+static std::vector<Op> generateTrace(int numDevices, int numPops, unsigned seed)
+{
+	std::minstd_rand rng(seed);
+	std::vector<uint64_t> period(numDevices);
+	std::vector<uint64_t> pending(numDevices);
+	std::vector<int> insertOrder(numDevices); // to break ties
+	int counter = 0;
+	for (auto i : xrange(numDevices)) {
+		// mix of fast (sound chips, VDP lines) and slow (timers, FDC) devices
+		period[i] = (i % 4 == 0) ? 228 + rng() % 64 : 1000 + rng() % 100000;
+		pending[i] = period[i];
+		insertOrder[i] = counter++;
+	}
+
+	std::vector<Op> trace;
+	for (auto i : xrange(numDevices)) {
+		trace.push_back({Op::INSERT, {pending[i], i}});
+	}
+	for (auto i : xrange(numPops)) {
+		(void)i;
+		// the smallest pending time, in case of ties the one that was
+		// inserted first
+		int dev = 0;
+		for (auto d : xrange(1, numDevices)) {
+			if ((pending[d] < pending[dev]) ||
+			    ((pending[d] == pending[dev]) && (insertOrder[d] < insertOrder[dev]))) {
+				dev = d;
+			}
+		}
+		trace.push_back({Op::POP, {pending[dev], dev}});
+		pending[dev] += period[dev];
+		insertOrder[dev] = counter++;
+		trace.push_back({Op::INSERT, {pending[dev], dev}});
+
+		if ((rng() % 8) == 0) {
+			// some device cancels and reschedules its syncpoint
+			int other = rng() % numDevices;
+			trace.push_back({Op::REMOVE, {0, other}});
+			pending[other] = pending[dev] + rng() % 1000;
+			insertOrder[other] = counter++;
+			trace.push_back({Op::INSERT, {pending[other], other}});
+		}
+	}
+	return trace;
+}
+
+// Returns the number of popped elements that didn't match the trace.
+static int replayQueue(const std::vector<Op>& trace)
+{
+	SchedulerQueue<SP> queue;
+	int errors = 0;
+	for (const auto& op : trace) {
+		switch (op.type) {
+		case Op::INSERT:
+			queue.insert(op.sp, [](SP& s) { s = SENTINEL; }, LessSP());
+			break;
+		case Op::REMOVE: {
+			int dev = op.sp.device;
+			queue.remove([&](const SP& sp) { return sp.device == dev; });
+			break;
+		}
+		case Op::POP:
+			if ((queue.front().time   != op.sp.time) ||
+			    (queue.front().device != op.sp.device)) {
+				++errors;
+			}
+			queue.remove_front();
+			break;
+		}
+	}
+	return errors;
+}
+
+static int replayHeap(const std::vector<Op>& trace, int numDevices)
+{
+	SchedulerHeap<SP> heap(SENTINEL);
+	std::vector<SchedulerHeap<SP>::List> lists(numDevices);
+	int errors = 0;
+	for (const auto& op : trace) {
+		switch (op.type) {
+		case Op::INSERT:
+			heap.insert(op.sp, lists[op.sp.device]);
+			break;
+		case Op::REMOVE:
+			heap.remove(lists[op.sp.device]);
+			break;
+		case Op::POP:
+			if ((heap.front().time   != op.sp.time) ||
+			    (heap.front().device != op.sp.device)) {
+				++errors;
+			}
+			heap.remove_front();
+			break;
+		}
+	}
+	for (auto& l : lists) heap.remove_all(l);
+	return errors;
+}
+
+TEST_CASE("SchedulerHeap: same order as SchedulerQueue")
+{
+	for (int numDevices : {1, 3, 10, 40, 150}) {
+		auto trace = generateTrace(numDevices, 2000, numDevices);
+		CHECK(replayQueue(trace) == 0);
+		CHECK(replayHeap (trace, numDevices) == 0);
+	}
+}
+
+TEST_CASE("SchedulerHeap: equal elements in insertion order")
+{
+	SchedulerHeap<SP> heap(SENTINEL);
+	std::vector<SchedulerHeap<SP>::List> lists(5);
+	CHECK(heap.empty());
+	CHECK(heap.front().time == SENTINEL.time);
+	for (auto i : xrange(20)) {
+		heap.insert({uint64_t(100 - (i % 3)), i}, lists[i % 5]);
+	}
+	CHECK(heap.size() == 20);
+
+	heap.remove_all(lists[0]);
+	CHECK(heap.size() == 16);
+	CHECK(lists[0].empty());
+
+	std::vector<int> order;
+	while (!heap.empty()) {
+		order.push_back(heap.front().device);
+		heap.remove_front();
+	}
+	CHECK(order == std::vector{2, 8, 11, 14, 17, 1, 4, 7, 13, 16, 19, 3, 6, 9, 12, 18});
+	CHECK(heap.front().time == SENTINEL.time);
+	for (auto& l : lists) CHECK(l.empty());
+}
+
+TEST_CASE("SchedulerHeap: elements of one list")
+{
+	SchedulerHeap<SP> heap(SENTINEL);
+	SchedulerHeap<SP>::List a, b;
+	CHECK(heap.find(a) == nullptr);
+	CHECK(!heap.remove(a));
+
+	heap.insert({30, 0}, a);
+	heap.insert({10, 1}, b);
+	heap.insert({20, 2}, a);
+	heap.insert({20, 3}, a);
+	heap.insert({40, 4}, a);
+
+	// the earliest element of the list, equal times in insertion order
+	REQUIRE(heap.find(a));
+	CHECK(heap.find(a)->device == 2);
+	std::vector<int> devices;
+	heap.for_each(a, [&](const SP& sp) { devices.push_back(sp.device); });
+	CHECK(devices == std::vector{2, 3, 0, 4});
+
+	CHECK(heap.remove(a));
+	CHECK(heap.find(a)->device == 3);
+	CHECK(heap.size() == 4);
+	CHECK(heap.front().device == 1);
+
+	heap.remove_all(a);
+	CHECK(a.empty());
+	CHECK(heap.size() == 1);
+	CHECK(heap.front().device == 1);
+	heap.remove_front();
+	CHECK(b.empty());
+	CHECK(heap.empty());
+}
+
+// Not run by default, run it with:  unittest "[benchmark]"
+TEST_CASE("SchedulerQueue vs SchedulerHeap benchmark", "[.benchmark]")
+{
+	using Clock = std::chrono::steady_clock;
+	auto measure = [](auto f) {
+		auto start = Clock::now();
+		f();
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+	for (int numDevices : {8, 16, 32, 64, 128, 256, 512, 1024}) {
+		auto trace = generateTrace(numDevices, 200000, 12345);
+		int e1 = 0, e2 = 0;
+		auto t1 = measure([&] { e1 = replayQueue(trace); });
+		auto t2 = measure([&] { e2 = replayHeap (trace, numDevices); });
+		CHECK(e1 == 0);
+		CHECK(e2 == 0);
+		std::cout << numDevices << " devices, " << trace.size() << " ops: "
+		          << "SchedulerQueue " << t1 << "ms, "
+		          << "SchedulerHeap " << t2 << "ms\n";
+	}
+}
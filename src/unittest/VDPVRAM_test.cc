@@ -0,0 +1,152 @@
+#include "catch.hpp"
+#include "VDPVRAM.hh"
+#include "Ram.hh"
+#include "VDP.hh"
+#include "VRAMObserver.hh"
+#include "XMLElement.hh"
+#include "xrange.hh"
+#include <chrono>
+#include <iostream>
+
+using namespace openmsx;
+
+static constexpr auto VDP_TICK = EmuDuration::hz(VDP::TICKS_PER_SECOND);
+
+// Behaves like PixelRenderer in a bitmap mode (screen 5): only page 0 is
+// visible. Changes to the hidden pages don't matter, changes to the visible
+// page are reported once per display line.
+struct PageObserver final : VRAMObserver {
+	explicit PageObserver(VRAMWindow& window_) : window(window_) {}
+
+	EmuTime updateVRAM(unsigned offset, EmuTime::param time) override {
+		++calls;
+		if (offset & 0x18000) {
+			if (skipHidden) window.skipNotify(offset & 0x18000, 0x8000);
+			return time;
+		}
+		++syncs;
+		return time + VDP_TICK * VDP::TICKS_PER_LINE;
+	}
+	void updateWindow(bool /*enabled*/, EmuTime::param /*time*/) override {}
+
+	VRAMWindow& window;
+	bool skipHidden = true;
+	unsigned calls = 0;
+	unsigned syncs = 0;
+};
+
+// Write 'num' bytes at the speed of an OTIR (one byte per 18 Z80 cycles).
+static EmuTime upload(VRAMWindow& window, unsigned address, unsigned num, EmuTime time)
+{
+	for (auto i : xrange(num)) {
+		window.notify(address + i, time);
+		time += VDP_TICK * (18 * 6);
+	}
+	return time;
+}
+
+TEST_CASE("VRAMWindow: skip notify")
+{
+	XMLElement xml;
+	Ram ram(xml, 0x20000);
+	VRAMWindow window(ram);
+	EmuTime time = EmuTime::zero();
+	window.setSizeMask(0x1FFFF, time);
+	window.setMask(0x1FFFF, ~0u << 17, time);
+	PageObserver observer(window);
+	window.setObserver(&observer);
+
+	// Upload to a hidden page: only the first byte is reported.
+	time = upload(window, 0x08000, 0x1000, time);
+	CHECK(observer.calls == 1);
+	CHECK(observer.syncs == 0);
+
+	// The visible page is still reported (once per line), and that
+	// doesn't undo the skip of the hidden page.
+	time = upload(window, 0x00000, 100, time);
+	CHECK(observer.calls == 9);
+	CHECK(observer.syncs == 8);
+	time = upload(window, 0x08000, 100, time);
+	CHECK(observer.calls == 9);
+
+	// An other hidden page is reported (once).
+	time = upload(window, 0x10000, 100, time);
+	CHECK(observer.calls == 10);
+
+	// After a VDP state change, everything is reported again.
+	window.resetNotify();
+	time = upload(window, 0x10000, 100, time);
+	CHECK(observer.calls == 11);
+	time = upload(window, 0x08000, 100, time);
+	CHECK(observer.calls == 12);
+
+	window.resetObserver();
+}
+
+TEST_CASE("VRAMWindow: isNotified")
+{
+	XMLElement xml;
+	Ram ram(xml, 0x20000);
+	VRAMWindow window(ram);
+	EmuTime time = EmuTime::zero();
+	window.setSizeMask(0x1FFFF, time);
+	window.setMask(0x1FFFF, ~0u << 17, time);
+
+	// no observer
+	CHECK(!window.isNotified(0x00000, 0x100));
+
+	PageObserver observer(window);
+	window.setObserver(&observer);
+	CHECK(window.isNotified(0x08000, 0x100));
+
+	// After the first change on a hidden page, the rest of that page is
+	// skipped (e.g. the VDP command engine can then fill it at once).
+	upload(window, 0x08000, 1, time);
+	CHECK(!window.isNotified(0x08000, 0x8000));
+	CHECK(!window.isNotified(0x0C000, 0x100));
+	CHECK(window.isNotified(0x07F00, 0x200)); // also the visible page
+	CHECK(window.isNotified(0x0FF00, 0x200)); // also an other hidden page
+	CHECK(window.isNotified(0x00000, 0x100));
+
+	window.resetNotify();
+	CHECK(window.isNotified(0x0C000, 0x100));
+
+	window.disable(time);
+	CHECK(!window.isNotified(0x0C000, 0x100));
+
+	window.resetObserver();
+}
+
+// Not run by default, run it with:  unittest "[benchmark]"
+TEST_CASE("VRAMWindow: benchmark", "[.benchmark]")
+{
+	XMLElement xml;
+	Ram ram(xml, 0x20000);
+	VRAMWindow window(ram);
+	EmuTime time = EmuTime::zero();
+	window.setSizeMask(0x1FFFF, time);
+	window.setMask(0x1FFFF, ~0u << 17, time);
+	PageObserver observer(window);
+	window.setObserver(&observer);
+
+	// An OTIR or VDP command that fills a hidden page, repeated per frame
+	// (each frame resets the skip).
+	auto bench = [&](bool skipHidden) {
+		using clock = std::chrono::steady_clock;
+		static constexpr int FRAMES = 200;
+		observer.skipHidden = skipHidden;
+		auto start = clock::now();
+		for (int f = 0; f < FRAMES; ++f) {
+			window.resetNotify();
+			time = upload(window, 0x08000, 0x8000, time);
+		}
+		auto ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+		return ns / (double(FRAMES) * 0x8000);
+	};
+	auto without = bench(false);
+	auto with = bench(true);
+	std::cout << "hidden page upload, report every byte: " << without << "ns/byte\n"
+	          << "hidden page upload, skip the page:     " << with << "ns/byte\n";
+
+	window.resetObserver();
+}
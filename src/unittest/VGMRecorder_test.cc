@@ -0,0 +1,75 @@
+#include "catch.hpp"
+#include "VGMRecorder.hh"
+#include "xrange.hh"
+#include <vector>
+
+using namespace openmsx;
+
+using Chip = VGMRecorder::Chip;
+
+static void add(std::vector<VGMRecorder::Event>& events, uint32_t ticks, byte reg, byte value)
+{
+	auto offset = uint32_t(events.size() * 3);
+	events.push_back({ticks, offset, VGMRecorder::Event::makeKey(Chip::AY8910, 0, reg, value)});
+}
+
+TEST_CASE("VGMRecorder: findLoop")
+{
+	std::vector<VGMRecorder::Event> events;
+	uint32_t t = 0;
+	// intro
+	for (auto i : xrange(5)) {
+		add(events, t, 7, byte(i));
+		t += 1000;
+	}
+	// a loop of 10 events (10 x 882 ticks), played 2.5 times
+	for (auto n : xrange(25)) {
+		add(events, t, 8, byte(n % 10));
+		t += 882 + (n & 1); // small timing differences are allowed
+	}
+
+	auto loop = VGMRecorder::findLoop(events, 5000);
+	REQUIRE(loop);
+	CHECK(loop->start == 5);
+	CHECK(loop->length == 10);
+
+	// too short
+	CHECK(!VGMRecorder::findLoop(events, 10000));
+
+	// no repetition at the end
+	add(events, t, 9, 0);
+	CHECK(!VGMRecorder::findLoop(events, 5000));
+
+	CHECK(!VGMRecorder::findLoop({}, 5000));
+}
+
+TEST_CASE("VGMRecorder: findLoop timing")
+{
+	// same register writes, but a different rhythm is not a loop
+	std::vector<VGMRecorder::Event> events;
+	uint32_t t = 0;
+	for (auto n : xrange(30)) {
+		add(events, t, 8, byte(n % 10));
+		t += (n < 10) ? 2000 : 882;
+	}
+	auto loop = VGMRecorder::findLoop(events, 5000);
+	REQUIRE(loop);
+	CHECK(loop->start == 10);
+	CHECK(loop->length == 10);
+}
+
+TEST_CASE("VGMRecorder: findLoop long recording")
+{
+	// 10 minutes of writing the same register every frame, with a
+	// slightly late write halfway. This used to take quadratic time.
+	std::vector<VGMRecorder::Event> events;
+	uint32_t t = 0;
+	for (auto n : xrange(30000)) {
+		add(events, t, 8, 15);
+		t += (n == 15000) ? 900 : 882;
+	}
+	auto loop = VGMRecorder::findLoop(events, 5000);
+	REQUIRE(loop);
+	CHECK(loop->start == 15001);
+	CHECK(loop->length == 6);
+}
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+#include "WorkerPool.hh"
+#include "xrange.hh"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace openmsx;
+
+TEST_CASE("WorkerPool: wait for a group")
+{
+	WorkerPool pool(2);
+	int groupA, groupB; // only the addresses are used
+	std::atomic<int> countA = 0;
+	std::atomic<bool> releaseB = false;
+
+	// Occupy both threads (and queue more) with jobs of group B, group A
+	// must not wait for those.
+	repeat(4, [&] {
+		pool.submit([&] { while (!releaseB) std::this_thread::yield(); }, &groupB);
+	});
+	repeat(10, [&] { pool.submit([&] { ++countA; }, &groupA); });
+	pool.wait(&groupA);
+	CHECK(countA == 10);
+
+	releaseB = true;
+	pool.wait(&groupB);
+	pool.waitIdle();
+}
+
+TEST_CASE("WorkerPool: wait from within a job")
+{
+	// Only one thread, so the nested jobs can only run when the outer
+	// job executes them itself.
+	WorkerPool pool(1);
+	int outer, inner;
+	std::vector<int> result(8);
+	pool.submit([&] {
+		for (auto i : xrange(result.size())) {
+			pool.submit([&result, i] { result[i] = int(i); }, &inner);
+		}
+		pool.wait(&inner);
+		for (auto i : xrange(result.size())) result[i] *= 2;
+	}, &outer);
+	pool.wait(&outer);
+	for (auto i : xrange(result.size())) {
+		CHECK(result[i] == int(2 * i));
+	}
+}
@@ -0,0 +1,66 @@
+#include "catch.hpp"
+#include "ZMBVEncoder.hh"
+#include "PixelFormat.hh"
+#include "WorkerPool.hh"
+#include "xrange.hh"
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+
+// A scrolling background with a few moving objects on top, so that the
+// motion search finds a mix of (different) vectors and changed blocks.
+static std::vector<uint32_t> createImage(const std::vector<uint32_t>& background,
+                                         unsigned frameNum)
+{
+	std::vector<uint32_t> image(320 * 240);
+	for (auto y : xrange(240)) {
+		for (auto x : xrange(320)) {
+			image[y * 320 + x] = background[y * 640 + x + 3 * frameNum];
+		}
+	}
+	for (auto i : xrange(5u)) {
+		unsigned x0 = (40 * i + 7 * frameNum) % 300;
+		unsigned y0 = (45 * i + 5 * frameNum * (i + 1)) % 220;
+		for (auto y : xrange(y0, y0 + 20)) {
+			for (auto x : xrange(x0, x0 + 20)) {
+				image[y * 320 + x] = 0x00FFFFFF - i;
+			}
+		}
+	}
+	return image;
+}
+
+TEST_CASE("ZMBVEncoder: parallel motion search")
+{
+	static const PixelFormat format(32, 0xFF0000, 16, 0, 0x00FF00, 8, 0, 0x0000FF, 0, 0, 0xFF000000, 24, 0);
+
+	std::minstd_rand rng(12345);
+	std::uniform_int_distribution<uint32_t> dist(0, 3);
+	const uint32_t colors[4] = {0x000000, 0x204080, 0x80FF00, 0xFF0000};
+	std::vector<uint32_t> background(640 * 240);
+	for (auto y : xrange(240)) {
+		for (auto x : xrange(640)) {
+			// mostly flat areas, some noise
+			background[y * 640 + x] = ((x / 24 + y / 16) % 3)
+				? colors[(x / 24 + y / 16) % 4]
+				: colors[dist(rng)];
+		}
+	}
+
+	WorkerPool pool(3);
+	ZMBVEncoder sequential(320, 240, 32);
+	ZMBVEncoder parallel(320, 240, 32, &pool);
+	for (auto frameNum : xrange(12u)) {
+		auto image = createImage(background, frameNum);
+		span<const uint8_t> bytes(reinterpret_cast<const uint8_t*>(image.data()),
+		                          image.size() * sizeof(uint32_t));
+		bool keyFrame = (frameNum % 6) == 0;
+		auto expected = sequential.compressFrame(keyFrame, bytes, format);
+		auto result = parallel.compressFrame(keyFrame, bytes, format);
+		REQUIRE(result.size() == expected.size());
+		CHECK(memcmp(result.data(), expected.data(), result.size()) == 0);
+	}
+}
@@ -1,7 +1,10 @@
 #include "DeltaBlock.hh"
+#include "DirtyPages.hh"
+#include "WorkerPool.hh"
 #include "likely.hh"
 #include "ranges.hh"
 #include "lz4.hh"
+#include "span.hh"
 #include <cassert>
 #include <cstring>
 #include <tuple>
@@ -182,40 +185,52 @@ end:	return std::mismatch(p, p_end, q);
 //   n2 number of bytes are different, and here are the bytes
 //   n3 number of bytes are equal
 //   ...
+// Only the given ranges of the buffers can be different, the bytes outside
+// these ranges are known to be equal (and are not accessed). 'newData' only
+// contains the new content of the ranges, concatenated.
 [[nodiscard]] static vector<uint8_t> calcDelta(
-	const uint8_t* oldBuf, const uint8_t* newBuf, size_t size)
+	const uint8_t* oldBuf, const uint8_t* newData, size_t size,
+	span<const DeltaBlockDiff::Range> ranges)
 {
 	vector<uint8_t> result;
-
-	const auto* p = oldBuf;
-	const auto* q = newBuf;
-	const auto* p_end = p + size;
-	const auto* q_end = q + size;
-
-	// scan equal bytes (possibly zero)
-	const auto* q1 = q;
-	std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
-	auto n1 = q - q1;
-	storeUleb(result, n1);
-
-	while (q != q_end) {
-		assert(*p != *q);
-
-		const auto* q2 = q;
-	different:
-		std::tie(p, q) = scan_match(p + 1, p_end, q + 1, q_end);
-		auto n2 = q - q2;
-
-		const auto* q3 = q;
-		std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
-		auto n3 = q - q3;
-		if ((q != q_end) && (n3 <= 2)) goto different;
-
-		storeUleb(result, n2);
-		result.insert(result.end(), q2, q3);
-
-		if (n3 != 0) storeUleb(result, n3);
+	size_t equal = 0; // number of equal bytes not yet stored in 'result'
+	size_t pos = 0;
+	const auto* q = newData;
+
+	for (const auto& range : ranges) {
+		assert(pos <= range.offset);
+		equal += range.offset - pos;
+		pos = range.offset + range.size;
+
+		const auto* p = oldBuf + range.offset;
+		const auto* p_end = p + range.size;
+		const auto* q_end = q + range.size;
+		while (q != q_end) {
+			// scan equal bytes (possibly zero)
+			const auto* q1 = q;
+			std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
+			equal += q - q1;
+			if (q == q_end) break;
+			assert(*p != *q);
+
+			const auto* q2 = q;
+		different:
+			std::tie(p, q) = scan_match(p + 1, p_end, q + 1, q_end);
+
+			const auto* q3 = q;
+			std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
+			auto n3 = q - q3;
+			if ((q != q_end) && (n3 <= 2)) goto different;
+
+			storeUleb(result, equal);
+			storeUleb(result, q3 - q2);
+			result.insert(result.end(), q2, q3);
+			equal = n3;
+		}
 	}
+	assert(pos <= size);
+	equal += size - pos;
+	if (result.empty() || (equal != 0)) storeUleb(result, equal);
 
 	result.shrink_to_fit();
 	return result;
@@ -272,6 +287,7 @@ DeltaBlockCopy::DeltaBlockCopy(const uint8_t* data, size_t size)
 
 void DeltaBlockCopy::apply(uint8_t* dst, size_t size) const
 {
+	std::lock_guard<std::mutex> lock(mutex);
 	if (compressed()) {
 		LZ4::decompress(block.data(), dst, int(compressedSize), int(size));
 	} else {
@@ -284,6 +300,7 @@ void DeltaBlockCopy::apply(uint8_t* dst, size_t size) const
 
 void DeltaBlockCopy::compress(size_t size)
 {
+	std::lock_guard<std::mutex> lock(mutex);
 	if (compressed()) return;
 
 	size_t dstLen = LZ4::compressBound(int(size));
@@ -300,7 +317,7 @@ void DeltaBlockCopy::compress(size_t size)
 	assert(compressed());
 #ifdef DEBUG
 	MemBuffer<uint8_t> buf3(size);
-	apply(buf3.data(), size);
+	LZ4::decompress(block.data(), buf3.data(), int(compressedSize), int(size));
 	assert(memcmp(buf3.data(), buf2.data(), size) == 0);
 #endif
 #if STATISTICS
@@ -312,27 +329,52 @@ void DeltaBlockCopy::compress(size_t size)
 #endif
 }
 
-const uint8_t* DeltaBlockCopy::getData()
-{
-	assert(!compressed());
-	return block.data();
-}
-
 
 // class DeltaBlockDiff
 
 DeltaBlockDiff::DeltaBlockDiff(
 		std::shared_ptr<DeltaBlockCopy> prev_,
-		const uint8_t* data, size_t size)
+		const uint8_t* data, size_t size, vector<Range> ranges_)
 	: prev(std::move(prev_))
-	, delta(calcDelta(prev->getData(), data, size))
+	, ranges(std::move(ranges_))
 {
 #ifdef DEBUG
 	sha1 = SHA1::calc({data, size});
+#else
+	(void)size;
+#endif
+	size_t total = 0;
+	for (const auto& r : ranges) total += r.size;
+	newData.resize(total);
+	auto* dst = newData.data();
+	for (const auto& r : ranges) {
+		memcpy(dst, data + r.offset, r.size);
+		dst += r.size;
+	}
+}
 
+void DeltaBlockDiff::calculate(size_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(prev->mutex);
+		if (!prev->compressed()) {
+			delta = calcDelta(prev->block.data(), newData.data(), size, ranges);
+		}
+	}
+	if (delta.empty()) {
+		// 'prev' got compressed in the meantime (an empty 'delta' is
+		// never a valid result, it contains at least one length)
+		MemBuffer<uint8_t> buf(size);
+		prev->apply(buf.data(), size);
+		delta = calcDelta(buf.data(), newData.data(), size, ranges);
+	}
+	newData.clear();
+	vector<Range>().swap(ranges);
+#ifdef DEBUG
 	MemBuffer<uint8_t> buf(size);
-	apply(buf.data(), size);
-	assert(memcmp(buf.data(), data, size) == 0);
+	prev->apply(buf.data(), size);
+	applyDeltaInPlace(buf.data(), size, delta.data());
+	assert(SHA1::calc({buf.data(), size}) == sha1);
 #endif
 #if STATISTICS
 	allocSize = delta.size();
@@ -342,8 +384,16 @@ DeltaBlockDiff::DeltaBlockDiff(
 #endif
 }
 
+void DeltaBlockDiff::waitCalculated() const
+{
+	// If the calculation didn't start yet, it runs on this thread, so this
+	// never waits for other (unrelated) jobs in the pool.
+	if (workerPool) workerPool->wait(this);
+}
+
 void DeltaBlockDiff::apply(uint8_t* dst, size_t size) const
 {
+	waitCalculated();
 	prev->apply(dst, size);
 	applyDeltaInPlace(dst, size, delta.data());
 #ifdef DEBUG
@@ -353,14 +403,29 @@ void DeltaBlockDiff::apply(uint8_t* dst, size_t size) const
 
 size_t DeltaBlockDiff::getDeltaSize() const
 {
+	waitCalculated();
 	return delta.size();
 }
 
 
 // class LastDeltaBlocks
 
+LastDeltaBlocks::LastDeltaBlocks(WorkerPool& workerPool_)
+	: workerPool(workerPool_)
+{
+}
+
+void LastDeltaBlocks::compressInBackground(
+	std::shared_ptr<DeltaBlockCopy> block, size_t size)
+{
+	workerPool.submit([block = std::move(block), size] {
+		block->compress(size);
+	});
+}
+
 std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
-		const void* id, const uint8_t* data, size_t size)
+		const void* id, const uint8_t* data, size_t size,
+		const DirtyPages* dirty)
 {
 	auto it = ranges::lower_bound(infos, std::tuple(id, size),
 		[](const Info& info, const std::tuple<const void*, size_t>& info2) {
@@ -372,12 +437,21 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
 	assert(it->id   == id);
 	assert(it->size == size);
 
+	if (auto diff = it->pendingDiff.lock()) {
+		// The size of the previous diff is only known now.
+		it->accSize += diff->getDeltaSize();
+	}
+	it->pendingDiff.reset();
+
 	auto ref = it->ref.lock();
-	if (it->accSize >= size || !ref) {
+	// The dirty page administration can only be used when the reference
+	// block was also taken while tracking with the same DirtyPages.
+	bool useDirty = dirty && ref && (it->dirtyId == dirty->getId());
+	if (it->accSize >= size || !ref || (dirty && !useDirty)) {
 		if (ref) {
 			// We will switch to a new DeltaBlockCopy object. So
 			// now is a good time to compress the old one.
-			ref->compress(size);
+			compressInBackground(std::move(ref), size);
 		}
 		// Heuristic: create a new block when too many small
 		// differences have accumulated.
@@ -385,13 +459,42 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
 		it->ref = b;
 		it->last = b;
 		it->accSize = 0;
+		it->dirtyId  = dirty ? dirty->getId()    : 0;
+		it->refEpoch = dirty ? dirty->getEpoch() : 0;
 		return b;
 	} else {
+		vector<DeltaBlockDiff::Range> ranges;
+		if (useDirty) {
+			// Only look at the pages that were modified since the
+			// reference block was taken, merge adjacent pages.
+			constexpr auto PAGE_SIZE = DirtyPages::PAGE_SIZE;
+			for (size_t page = 0; (page * PAGE_SIZE) < size; ++page) {
+				if (!dirty->isDirtySince(page, it->refEpoch)) continue;
+				size_t begin = page * PAGE_SIZE;
+				size_t len = std::min(PAGE_SIZE, size - begin);
+				if (!ranges.empty() &&
+				    ((ranges.back().offset + ranges.back().size) == begin)) {
+					ranges.back().size += len;
+				} else {
+					ranges.push_back({begin, len});
+				}
+			}
+			if (ranges.empty()) {
+				// Nothing changed since the reference block.
+				it->last = ref;
+				return ref;
+			}
+		} else {
+			ranges.push_back({0, size});
+		}
 		// Create diff based on earlier reference block.
 		// Reference remains unchanged.
-		auto b = std::make_shared<DeltaBlockDiff>(ref, data, size);
+		auto b = std::make_shared<DeltaBlockDiff>(
+			ref, data, size, std::move(ranges));
+		b->workerPool = &workerPool;
+		workerPool.submit([b, size] { b->calculate(size); }, b.get());
 		it->last = b;
-		it->accSize += b->getDeltaSize();
+		it->pendingDiff = b;
 		return b;
 	}
 }
@@ -427,7 +530,7 @@ void LastDeltaBlocks::clear()
 {
 	for (const Info& info : infos) {
 		if (auto ref = info.ref.lock()) {
-			ref->compress(info.size);
+			compressInBackground(std::move(ref), info.size);
 		}
 	}
 	infos.clear();
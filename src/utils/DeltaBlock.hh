@@ -4,8 +4,10 @@
 #define STATISTICS 0
 
 #include "MemBuffer.hh"
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <vector>
 #ifdef DEBUG
 #include "sha1.hh"
@@ -13,6 +15,9 @@
 
 namespace openmsx {
 
+class DirtyPages;
+class WorkerPool;
+
 class DeltaBlock
 {
 public:
@@ -39,46 +44,79 @@ protected:
 };
 
 
+// Compression can run on a background thread (see LastDeltaBlocks), so all
+// access to 'block' is protected by a mutex.
 class DeltaBlockCopy final : public DeltaBlock
 {
 public:
 	DeltaBlockCopy(const uint8_t* data, size_t size);
 	void apply(uint8_t* dst, size_t size) const override;
 	void compress(size_t size);
-	[[nodiscard]] const uint8_t* getData();
 
 private:
+	friend class DeltaBlockDiff;
 	[[nodiscard]] bool compressed() const { return compressedSize != 0; }
 
 	MemBuffer<uint8_t> block;
 	size_t compressedSize;
+	mutable std::mutex mutex;
 };
 
 
+// The constructor only makes a copy of the data, the actual delta is
+// calculated by calculate(), normally on a background thread. Methods that
+// need the delta wait till it's available.
 class DeltaBlockDiff final : public DeltaBlock
 {
 public:
+	/** A part of the block that (possibly) differs from 'prev'. */
+	struct Range {
+		size_t offset;
+		size_t size;
+	};
+
+	/** Only the given (sorted, non-overlapping) ranges of 'data' are
+	  * read, the rest is known to be equal to 'prev'. */
 	DeltaBlockDiff(std::shared_ptr<DeltaBlockCopy> prev_,
-	               const uint8_t* data, size_t size);
+	               const uint8_t* data, size_t size,
+	               std::vector<Range> ranges_);
 	void apply(uint8_t* dst, size_t size) const override;
 	[[nodiscard]] size_t getDeltaSize() const;
 
 private:
+	friend class LastDeltaBlocks;
+	void calculate(size_t size);
+	void waitCalculated() const;
+
 	const std::shared_ptr<DeltaBlockCopy> prev;
-	const std::vector<uint8_t> delta; // TODO could be tweaked to use OutputBuffer
+	// only needed till the delta is calculated
+	std::vector<Range> ranges;
+	MemBuffer<uint8_t> newData; // content of 'ranges', concatenated
+	std::vector<uint8_t> delta; // TODO could be tweaked to use OutputBuffer
+	WorkerPool* workerPool = nullptr; // calculates 'delta', in group 'this'
 };
 
 
 class LastDeltaBlocks
 {
 public:
+	/** @param workerPool Compresses the blocks and calculates the diffs,
+	  *                   so that taking a snapshot is mostly reduced to
+	  *                   copying the data. */
+	explicit LastDeltaBlocks(WorkerPool& workerPool);
+
+	/** @param dirty If given, only the modified pages are examined. */
 	[[nodiscard]] std::shared_ptr<DeltaBlock> createNew(
-		const void* id, const uint8_t* data, size_t size);
+		const void* id, const uint8_t* data, size_t size,
+		const DirtyPages* dirty = nullptr);
 	[[nodiscard]] std::shared_ptr<DeltaBlock> createNullDiff(
 		const void* id, const uint8_t* data, size_t size);
 	void clear();
 
 private:
+	void compressInBackground(
+		std::shared_ptr<DeltaBlockCopy> block, size_t size);
+
 	struct Info {
 		Info(const void* id_, size_t size_)
 			: id(id_), size(size_), accSize(0) {}
@@ -87,9 +125,13 @@ private:
 		size_t size;
 		std::weak_ptr<DeltaBlockCopy> ref;
 		std::weak_ptr<DeltaBlock> last;
+		std::weak_ptr<DeltaBlockDiff> pendingDiff; // not yet in 'accSize'
 		size_t accSize;
+		unsigned dirtyId = 0; // DirtyPages::getId() of 'ref' (0 if none)
+		uint32_t refEpoch = 0; // DirtyPages::getEpoch() of 'ref'
 	};
 
+	WorkerPool& workerPool;
 	std::vector<Info> infos;
 };
 
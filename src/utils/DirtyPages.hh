@@ -0,0 +1,127 @@
+#ifndef DIRTYPAGES_HH
+#define DIRTYPAGES_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace openmsx {
+
+/** Keeps track of which (fixed size) pages of a memory block were written.
+  *
+  * Instead of a single dirty bit, each page remembers the 'epoch' in which
+  * it was last written. A consumer (the reverse snapshot code, see
+  * LastDeltaBlocks) remembers the epoch in which it made its last full copy
+  * of the memory block, and can later find the pages that were modified
+  * since then, without looking at the memory content itself. Because the
+  * administration isn't reset by the consumer, there can be several
+  * independent consumers.
+  *
+  * Pages can also be 'pinned': that means the memory is (possibly) being
+  * written without going through markDirty(), typically because the CPU
+  * got a direct pointer to it (see CacheLine). Pinned pages are always
+  * dirty. On flush() they become regular dirty pages and the owner is asked
+  * (via a callback) to revoke such direct pointers, so that the next write
+  * pins the page again.
+  *
+  * Tracking is disabled by default. The owner of the memory block must only
+  * enable it when it can guarantee that all writes are reported.
+  */
+class DirtyPages
+{
+public:
+	static constexpr unsigned PAGE_BITS = 8;
+	static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+
+	explicit DirtyPages(size_t size_)
+		: size(size_)
+	{
+	}
+
+	/** Start tracking. Until the first consumer has made a full copy, all
+	  * pages must anyway be considered dirty. That's ensured because the
+	  * consumer sees a new id.
+	  * @param unpin_ Called on flush(), must revoke all direct write
+	  *               pointers to pinned pages (can be empty).
+	  */
+	void enable(std::function<void()> unpin_ = {})
+	{
+		unpin = std::move(unpin_);
+		epochs.assign((size + PAGE_SIZE - 1) >> PAGE_BITS, epoch);
+		id = ++idCounter;
+	}
+	[[nodiscard]] bool isEnabled() const { return !epochs.empty(); }
+
+	// producer interface
+
+	void markDirty(size_t addr)
+	{
+		if (epochs.empty()) return;
+		auto& e = epochs[addr >> PAGE_BITS];
+		if (e != PINNED) e = epoch;
+	}
+	void markDirty(size_t addr, size_t num)
+	{
+		if (epochs.empty() || (num == 0)) return;
+		for (auto p = addr >> PAGE_BITS; p <= ((addr + num - 1) >> PAGE_BITS); ++p) {
+			if (epochs[p] != PINNED) epochs[p] = epoch;
+		}
+	}
+	void markAllDirty()
+	{
+		for (auto& e : epochs) {
+			if (e != PINNED) e = epoch;
+		}
+	}
+	void pin(size_t addr, size_t num)
+	{
+		if (epochs.empty() || (num == 0)) return;
+		std::fill(epochs.begin() + (addr >> PAGE_BITS),
+		          epochs.begin() + ((addr + num - 1) >> PAGE_BITS) + 1,
+		          PINNED);
+	}
+
+	// consumer interface
+
+	/** Must be called right before using isDirtySince(). */
+	void flush()
+	{
+		bool anyPinned = false;
+		for (auto& e : epochs) {
+			if (e == PINNED) {
+				e = epoch;
+				anyPinned = true;
+			}
+		}
+		if (anyPinned && unpin) unpin();
+	}
+	/** Must be called after the consumer took its copy (or diff). Later
+	  * writes then get a newer epoch. */
+	void nextEpoch() { ++epoch; }
+
+	/** Unique (per DirtyPages object and per enable() call) id. */
+	[[nodiscard]] unsigned getId() const { return id; }
+	[[nodiscard]] uint32_t getEpoch() const { return epoch; }
+	[[nodiscard]] size_t getNumPages() const { return epochs.size(); }
+	[[nodiscard]] bool isDirtySince(size_t page, uint32_t since) const
+	{
+		return epochs[page] > since;
+	}
+
+private:
+	static constexpr uint32_t PINNED = uint32_t(-1);
+	static inline unsigned idCounter = 0;
+
+	std::vector<uint32_t> epochs; // per page, empty when disabled
+	std::function<void()> unpin;
+	const size_t size;
+	uint32_t epoch = 1;
+	unsigned id = 0;
+};
+
+} // namespace openmsx
+
+#endif
@@ -2,7 +2,9 @@
 
 #include "AviWriter.hh"
 #include "FileOperations.hh"
+#include "FrameSource.hh"
 #include "MSXException.hh"
+#include "WorkerPool.hh"
 #include "build-info.hh"
 #include "Version.hh"
 #include "cstdiop.hh" // for snprintf
@@ -10,6 +12,7 @@
 #include <cstring>
 #include <ctime>
 #include <limits>
+#include <thread>
 
 namespace openmsx {
 
@@ -17,9 +20,11 @@ constexpr unsigned AVI_HEADER_SIZE = 500;
 
 AviWriter::AviWriter(const Filename& filename, unsigned width_,
                      unsigned height_, unsigned bpp, unsigned channels_,
-                     unsigned freq_)
+                     unsigned freq_, WorkerPool& workerPool_)
 	: file(filename, "wb")
-	, codec(width_, height_, bpp)
+	, workerPool(workerPool_)
+	, codec(width_, height_, bpp,
+	        (std::thread::hardware_concurrency() > 1) ? &workerPool : nullptr)
 	, fps(0.0f) // will be filled in later
 	, width(width_)
 	, height(height_)
@@ -38,6 +43,8 @@ AviWriter::AviWriter(const Filename& filename, unsigned width_,
 
 AviWriter::~AviWriter()
 {
+	workerPool.wait(this);
+
 	if (written == 0) {
 		// no data written yet (a recording less than one video frame)
 		std::string filename = file.getURL();
@@ -268,22 +275,80 @@ void AviWriter::addAviChunk(const char* tag, size_t size_, const void* data, uns
 
 void AviWriter::addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData)
 {
-	bool keyFrame = (frames++ % 300 == 0);
-	auto buffer = codec.compressFrame(keyFrame, frame);
-	addAviChunk("00dc", buffer.size(), buffer.data(), keyFrame ? 0x10 : 0x0);
-
-	if (samples) {
-		assert((samples % channels) == 0);
-		assert(audiorate != 0);
-		if (OPENMSX_BIGENDIAN) {
-			// See comment in WavWriter::write()
-			//VLA(Endian::L16, buf, samples); // doesn't work in clang
-			std::vector<Endian::L16> buf(sampleData, sampleData + samples);
-			addAviChunk("01wb", samples * sizeof(int16_t), buf.data(), 0);
-		} else {
-			addAviChunk("01wb", samples * sizeof(int16_t), sampleData, 0);
+	{
+		// When the encoder falls behind, wait till the oldest frame
+		// is written (not till the whole queue is written).
+		std::unique_lock<std::mutex> lock(mutex);
+		slotFree.wait(lock, [&] { return (frames - framesWritten) < queue.size(); });
+		if (!error.empty()) throw MSXException(error);
+	}
+
+	auto& queued = queue[frames % queue.size()];
+	queued.keyFrame = (frames % 300 == 0);
+	auto imageSize = codec.getImageSize();
+	if (!queued.image.data()) queued.image.resize(imageSize);
+	codec.copyFrame(*frame, {queued.image.data(), imageSize});
+	queued.pixelFormat = frame->getPixelFormat();
+	queued.samples.assign(sampleData, sampleData + samples);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	++frames;
+	if (!writing) {
+		writing = true;
+		workerPool.submit([this] { writeFrames(); }, this);
+	}
+}
+
+void AviWriter::writeFrames()
+{
+	while (true) {
+		QueuedFrame* frame;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (framesWritten == frames) {
+				writing = false;
+				return;
+			}
+			frame = &queue[framesWritten % queue.size()];
+		}
+		writeFrame(*frame);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++framesWritten;
+		}
+		slotFree.notify_one();
+	}
+}
+
+void AviWriter::writeFrame(QueuedFrame& frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!error.empty()) return;
+	}
+	try {
+		auto buffer = codec.compressFrame(
+			frame.keyFrame, {frame.image.data(), codec.getImageSize()},
+			frame.pixelFormat);
+		addAviChunk("00dc", buffer.size(), buffer.data(), frame.keyFrame ? 0x10 : 0x0);
+
+		auto samples = unsigned(frame.samples.size());
+		if (samples) {
+			assert((samples % channels) == 0);
+			assert(audiorate != 0);
+			if (OPENMSX_BIGENDIAN) {
+				// See comment in WavWriter::write()
+				//VLA(Endian::L16, buf, samples); // doesn't work in clang
+				std::vector<Endian::L16> buf(frame.samples.begin(), frame.samples.end());
+				addAviChunk("01wb", samples * sizeof(int16_t), buf.data(), 0);
+			} else {
+				addAviChunk("01wb", samples * sizeof(int16_t), frame.samples.data(), 0);
+			}
+			audiowritten += samples;
 		}
-		audiowritten += samples;
+	} catch (MSXException& e) {
+		std::lock_guard<std::mutex> lock(mutex);
+		error = e.getMessage();
 	}
 }
 
@@ -5,32 +5,67 @@
 
 #include "ZMBVEncoder.hh"
 #include "File.hh"
+#include "MemBuffer.hh"
+#include "PixelFormat.hh"
+#include "aligned.hh"
 #include "endian.hh"
+#include <array>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <string>
 #include <vector>
 
 namespace openmsx {
 
 class Filename;
 class FrameSource;
+class WorkerPool;
 
 class AviWriter
 {
 public:
+	/** @param workerPool Encodes and writes the frames. */
 	AviWriter(const Filename& filename, unsigned width, unsigned height,
-	          unsigned bpp, unsigned channels, unsigned freq);
+	          unsigned bpp, unsigned channels, unsigned freq,
+	          WorkerPool& workerPool);
 	~AviWriter();
+
+	/** Only the image of the frame is copied, encoding and writing
+	  * happens later on the worker pool. A write error is reported
+	  * (as MSXException) by a later call to this method. */
 	void addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData);
 	void setFps(float fps_) { fps = fps_; }
 
 private:
+	struct QueuedFrame {
+		MemBuffer<uint8_t, SSE_ALIGNMENT> image;
+		std::vector<int16_t> samples;
+		PixelFormat pixelFormat;
+		bool keyFrame;
+	};
+
+	void writeFrames();
+	void writeFrame(QueuedFrame& frame);
 	void addAviChunk(const char* tag, size_t size, const void* data, unsigned flags);
 
 private:
 	File file;
+	WorkerPool& workerPool;
 	ZMBVEncoder codec;
 	std::vector<Endian::L32> index;
 
+	/** Frames that are waiting to be encoded (or are being encoded). At
+	  * most one job (writeFrames()) at a time handles them, in order.
+	  * When the encoder falls behind, addFrame() waits till the oldest
+	  * one is written. So this also limits the used memory. */
+	std::array<QueuedFrame, 8> queue;
+	std::mutex mutex; // for the members below and 'frames'
+	unsigned framesWritten = 0;
+	bool writing = false; // is there a writeFrames() job?
+	std::condition_variable slotFree; // signaled when 'framesWritten' changes
+	std::string error; // not empty when writing failed
+
 	float fps;
 	const unsigned width;
 	const unsigned height;
@@ -7,6 +7,12 @@
 #include <algorithm>
 #include <cstdint>
 #include <tuple>
+#ifdef __SSE2__
+#include "emmintrin.h" // SSE2
+#ifdef __SSSE3__
+#include "tmmintrin.h" // SSSE3  (supplemental SSE3)
+#endif
+#endif
 
 namespace openmsx {
 
@@ -36,8 +42,64 @@ void BitmapConverter<Pixel>::calcDPalette()
 			dPalette[16 * i + j] = dp;
 		}
 	}
+#ifdef __SSSE3__
+	for (auto b : xrange(sizeof(Pixel))) {
+		for (auto i : xrange(16)) {
+			// graphic5: even pixels use entries 0-3, odd pixels 16-19
+			auto i5 = (i < 4) ? i : (i < 8) ? (i + 12) : 0;
+			palettePlanes [b][i] = reinterpret_cast<const byte*>(&palette16[i ])[b];
+			palette5Planes[b][i] = reinterpret_cast<const byte*>(&palette16[i5])[b];
+		}
+	}
+#endif
 }
 
+#ifdef __SSSE3__
+// Convert 16 palette indices (one per byte, values 0-15) to 16 host pixels.
+// The palette is stored as byte planes (see calcDPalette()), each plane
+// fits in one register, so the lookup is a single shuffle per plane.
+template<typename Pixel>
+static inline void lookup16(Pixel* __restrict out, __m128i idx,
+                            const byte (&planes)[sizeof(Pixel)][16])
+{
+	auto plane = [&](int b) {
+		auto p = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[b]));
+		return _mm_shuffle_epi8(p, idx);
+	};
+	auto* o = reinterpret_cast<__m128i*>(out);
+	if constexpr (sizeof(Pixel) == 2) {
+		__m128i b0 = plane(0);
+		__m128i b1 = plane(1);
+		_mm_storeu_si128(o + 0, _mm_unpacklo_epi8(b0, b1));
+		_mm_storeu_si128(o + 1, _mm_unpackhi_epi8(b0, b1));
+	} else {
+		__m128i b0 = plane(0);
+		__m128i b1 = plane(1);
+		__m128i b2 = plane(2);
+		__m128i b3 = plane(3);
+		__m128i lo01 = _mm_unpacklo_epi8(b0, b1);
+		__m128i hi01 = _mm_unpackhi_epi8(b0, b1);
+		__m128i lo23 = _mm_unpacklo_epi8(b2, b3);
+		__m128i hi23 = _mm_unpackhi_epi8(b2, b3);
+		_mm_storeu_si128(o + 0, _mm_unpacklo_epi16(lo01, lo23));
+		_mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo01, lo23));
+		_mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi01, hi23));
+		_mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi01, hi23));
+	}
+}
+
+// Split 16 bytes of 4bpp VRAM data in 32 palette indices (in pixel order,
+// the high nibble is the left pixel).
+static inline void unpack4bpp(__m128i data, __m128i& idx0, __m128i& idx1)
+{
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), mask);
+	__m128i lo = _mm_and_si128(data, mask);
+	idx0 = _mm_unpacklo_epi8(hi, lo);
+	idx1 = _mm_unpackhi_epi8(hi, lo);
+}
+#endif
+
 template<typename Pixel>
 void BitmapConverter<Pixel>::convertLine(
 	Pixel* linePtr, const byte* vramPtr)
@@ -127,6 +189,18 @@ void BitmapConverter<Pixel>::renderGraphic4(
 		calcDPalette();
 	}
 
+#ifdef __SSSE3__
+	// 32 pixels per iteration
+	for (auto i : xrange(128 / 16)) {
+		__m128i idx0, idx1;
+		unpack4bpp(_mm_loadu_si128(reinterpret_cast<const __m128i*>(vramPtr0 + 16 * i)),
+		           idx0, idx1);
+		lookup16(pixelPtr + 32 * i +  0, idx0, palettePlanes);
+		lookup16(pixelPtr + 32 * i + 16, idx1, palettePlanes);
+	}
+	return;
+#endif
+
 	if ((sizeof(Pixel) == 2) && ((uintptr_t(pixelPtr) & 1) == 1)) {
 		// Its 16 bit destination but currently not aligned on a word boundary
 		// First write one pixel to get aligned
@@ -207,6 +281,34 @@ void BitmapConverter<Pixel>::renderGraphic5(
 	Pixel*      __restrict pixelPtr,
 	const byte* __restrict vramPtr0)
 {
+#ifdef __SSSE3__
+	if (unlikely(!dPaletteValid)) {
+		calcDPalette();
+	}
+	// 64 pixels per iteration. Indices 0-3 select the even pixel colors,
+	// 4-7 the odd pixel colors (see palette5Planes).
+	const __m128i m3  = _mm_set1_epi8(3);
+	const __m128i odd = _mm_set1_epi8(4);
+	for (auto i : xrange(128 / 16)) {
+		__m128i data = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr0 + 16 * i));
+		__m128i p0 =              _mm_and_si128(_mm_srli_epi16(data, 6), m3);
+		__m128i p1 = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(data, 4), m3), odd);
+		__m128i p2 =              _mm_and_si128(_mm_srli_epi16(data, 2), m3);
+		__m128i p3 = _mm_or_si128(_mm_and_si128(data,                    m3), odd);
+		__m128i lo01 = _mm_unpacklo_epi8(p0, p1);
+		__m128i hi01 = _mm_unpackhi_epi8(p0, p1);
+		__m128i lo23 = _mm_unpacklo_epi8(p2, p3);
+		__m128i hi23 = _mm_unpackhi_epi8(p2, p3);
+		Pixel* out = pixelPtr + 64 * i;
+		lookup16(out +  0, _mm_unpacklo_epi16(lo01, lo23), palette5Planes);
+		lookup16(out + 16, _mm_unpackhi_epi16(lo01, lo23), palette5Planes);
+		lookup16(out + 32, _mm_unpacklo_epi16(hi01, hi23), palette5Planes);
+		lookup16(out + 48, _mm_unpackhi_epi16(hi01, hi23), palette5Planes);
+	}
+	return;
+#endif
+
 	for (auto i : xrange(128)) {
 		unsigned data = vramPtr0[i];
 		pixelPtr[4 * i + 0] = palette16[ 0 +  (data >> 6)     ];
@@ -233,6 +335,21 @@ void BitmapConverter<Pixel>::renderGraphic6(
 	if (unlikely(!dPaletteValid)) {
 		calcDPalette();
 	}
+
+#ifdef __SSSE3__
+	// 32 pixels per iteration, the bytes of both planes are interleaved
+	for (auto i : xrange(128 / 8)) {
+		__m128i data = _mm_unpacklo_epi8(
+			_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vramPtr0 + 8 * i)),
+			_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vramPtr1 + 8 * i)));
+		__m128i idx0, idx1;
+		unpack4bpp(data, idx0, idx1);
+		lookup16(pixelPtr + 32 * i +  0, idx0, palettePlanes);
+		lookup16(pixelPtr + 32 * i + 16, idx1, palettePlanes);
+	}
+	return;
+#endif
+
 	      auto* out = reinterpret_cast<DPixel*>(pixelPtr);
 	const auto* in0 = reinterpret_cast<const unsigned*>(vramPtr0);
 	const auto* in1 = reinterpret_cast<const unsigned*>(vramPtr1);
@@ -282,12 +399,78 @@ static constexpr std::tuple<int, int, int> yjk2rgb(int y, int j, int k)
 	return {r, g, b};
 }
 
+#ifdef __SSE2__
+// Calculate the (15-bit) V9958 color index, as in yjk2rgb(), for 16 YJK
+// pixels (4 groups of 4 pixels). 'p' contains the VRAM bytes in pixel order.
+static inline void yjk2rgbIndex16(__m128i p, uint16_t* __restrict idx)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c31  = _mm_set1_epi16(31);
+
+	// Each 16-bit word contains 2 consecutive pixels. The lower 3 bits of
+	// both bytes form (as a 6-bit signed value) the K component (even
+	// words) or the J component (odd words) of the group.
+	__m128i t = _mm_or_si128(_mm_and_si128(p,                     _mm_set1_epi16(0x0007)),
+	                         _mm_and_si128(_mm_srli_epi16(p, 5), _mm_set1_epi16(0x0038)));
+	__m128i s = _mm_srai_epi16(_mm_slli_epi16(t, 10), 10); // k0 j0 k1 j1 k2 j2 k3 j3
+	__m128i kj = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(s, 16), 16),
+	                             _mm_srai_epi32(s, 16)); // k0 k1 k2 k3 j0 j1 j2 j3
+	__m128i kk = _mm_unpacklo_epi16(kj, kj); // k0 k0 k1 k1 k2 k2 k3 k3
+	__m128i jj = _mm_unpackhi_epi16(kj, kj);
+
+	__m128i y = _mm_and_si128(_mm_srli_epi16(p, 3), _mm_set1_epi8(0x1F));
+
+	auto clamp = [&](__m128i x) {
+		return _mm_min_epi16(_mm_max_epi16(x, zero), c31);
+	};
+	auto calc = [&](__m128i y8, __m128i j8, __m128i k8) {
+		__m128i r = clamp(_mm_add_epi16(y8, j8));
+		__m128i g = clamp(_mm_add_epi16(y8, k8));
+		// The result is clamped, so it doesn't matter that the shift
+		// rounds down while the division in yjk2rgb() rounds towards zero.
+		__m128i y5 = _mm_add_epi16(_mm_slli_epi16(y8, 2), y8);
+		__m128i jk = _mm_add_epi16(_mm_add_epi16(j8, j8), k8);
+		__m128i b = clamp(_mm_srai_epi16(_mm_sub_epi16(y5, jk), 2));
+		return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 10),
+		                                 _mm_slli_epi16(g,  5)),
+		                    b);
+	};
+	auto* out = reinterpret_cast<__m128i*>(idx);
+	_mm_store_si128(out + 0, calc(_mm_unpacklo_epi8(y, zero),
+	                              _mm_unpacklo_epi32(jj, jj),
+	                              _mm_unpacklo_epi32(kk, kk)));
+	_mm_store_si128(out + 1, calc(_mm_unpackhi_epi8(y, zero),
+	                              _mm_unpackhi_epi32(jj, jj),
+	                              _mm_unpackhi_epi32(kk, kk)));
+}
+
+// Load 16 YJK pixels (the bytes of both planes interleaved).
+static inline __m128i loadYJK16(const byte* vramPtr0, const byte* vramPtr1)
+{
+	return _mm_unpacklo_epi8(
+		_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vramPtr0)),
+		_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vramPtr1)));
+}
+#endif
+
 template<typename Pixel>
 void BitmapConverter<Pixel>::renderYJK(
 	Pixel*      __restrict pixelPtr,
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
+#ifdef __SSE2__
+	// 16 pixels per iteration
+	for (auto i : xrange(128 / 8)) {
+		alignas(16) uint16_t idx[16];
+		yjk2rgbIndex16(loadYJK16(vramPtr0 + 8 * i, vramPtr1 + 8 * i), idx);
+		for (auto n : xrange(16)) {
+			pixelPtr[16 * i + n] = palette32768[idx[n]];
+		}
+	}
+	return;
+#endif
+
 	for (auto i : xrange(64)) {
 		unsigned p[4];
 		p[0] = vramPtr0[2 * i + 0];
@@ -313,6 +496,23 @@ void BitmapConverter<Pixel>::renderYAE(
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
+#ifdef __SSE2__
+	// 16 pixels per iteration
+	for (auto i : xrange(128 / 8)) {
+		__m128i data = loadYJK16(vramPtr0 + 8 * i, vramPtr1 + 8 * i);
+		alignas(16) uint16_t idx[16];
+		alignas(16) byte p[16];
+		yjk2rgbIndex16(data, idx);
+		_mm_store_si128(reinterpret_cast<__m128i*>(p), data);
+		for (auto n : xrange(16)) {
+			pixelPtr[16 * i + n] = (p[n] & 0x08)
+				? palette16[p[n] >> 4]     // YAE
+				: palette32768[idx[n]];    // YJK
+		}
+	}
+	return;
+#endif
+
 	for (auto i : xrange(64)) {
 		unsigned p[4];
 		p[0] = vramPtr0[2 * i + 0];
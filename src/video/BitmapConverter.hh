@@ -25,7 +25,8 @@ public:
 	  *   some internal optimizations, this class should be informed about
 	  *   changes in this array (not needed for the next two), see
 	  *   palette16Changed().
-	  *   Used for display modes Graphic4, Graphic5 and Graphic6.
+	  *   Used for display modes Graphic4, Graphic5 and Graphic6 (and
+	  *   for YAE).
 	  *   First 16 entries are for even pixels, next 16 are for odd pixels
 	  * @param palette256 Pointer to 256-entries array that specifies
 	  *   VDP color index to host pixel mapping.
@@ -95,6 +96,11 @@ private:
 
 	using DPixel = typename DoublePixel<sizeof(Pixel)>::type;
 	DPixel dPalette[16 * 16];
+#ifdef __SSSE3__
+	// palette16 split in byte planes, for in-register palette lookups
+	alignas(16) byte palettePlanes [sizeof(Pixel)][16]; // entries 0-15
+	alignas(16) byte palette5Planes[sizeof(Pixel)][16]; // entries 0-3, 16-19
+#endif
 	DisplayMode mode;
 	bool dPaletteValid;
 };
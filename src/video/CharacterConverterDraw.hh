@@ -0,0 +1,111 @@
+#ifndef CHARACTERCONVERTERDRAW_HH
+#define CHARACTERCONVERTERDRAW_HH
+
+// Helper functions for CharacterConverter: expand one row of a character
+// pattern to host pixels. These are in a header (instead of in
+// CharacterConverter.cc) so that the unittest can verify the SIMD versions.
+
+#include "openmsx.hh"
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include "emmintrin.h" // SSE2
+#endif
+
+namespace openmsx {
+
+#ifdef __SSE2__
+// Copied from Scale2xScaler.cc, TODO move to common location?
+inline __m128i select(__m128i a0, __m128i a1, __m128i mask)
+{
+	return _mm_xor_si128(_mm_and_si128(_mm_xor_si128(a0, a1), mask), a0);
+}
+
+// Expand the 8 pattern bits to 8 pixels: for 16bpp this fits in one
+// register, for 32bpp it takes two registers.
+inline __m128i expand8x16(uint16_t fg, uint16_t bg, byte pattern)
+{
+	const __m128i m70 = _mm_set_epi16(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+	__m128i pat = _mm_set1_epi16(pattern);
+	__m128i b70 = _mm_cmpeq_epi16(_mm_and_si128(pat, m70), _mm_setzero_si128());
+	return select(_mm_set1_epi16(fg), _mm_set1_epi16(bg), b70);
+}
+inline void expand8x32(uint32_t fg, uint32_t bg, byte pattern,
+                       __m128i& out0, __m128i& out1)
+{
+	const __m128i m74 = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+	const __m128i m30 = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i fg4 = _mm_set1_epi32(fg);
+	__m128i bg4 = _mm_set1_epi32(bg);
+	__m128i pat = _mm_set1_epi32(pattern);
+
+	__m128i b74 = _mm_cmpeq_epi32(_mm_and_si128(pat, m74), zero);
+	__m128i b30 = _mm_cmpeq_epi32(_mm_and_si128(pat, m30), zero);
+	out0 = select(fg4, bg4, b74);
+	out1 = select(fg4, bg4, b30);
+}
+#endif
+
+template<typename Pixel> inline void draw6(
+	Pixel* __restrict & pixelPtr, Pixel fg, Pixel bg, byte pattern)
+{
+#ifdef __SSE2__
+	if constexpr (sizeof(Pixel) == 2) {
+		__m128i p = expand8x16(fg, bg, pattern);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pixelPtr), p);
+		uint32_t p45 = _mm_cvtsi128_si32(_mm_srli_si128(p, 8));
+		memcpy(pixelPtr + 4, &p45, sizeof(p45));
+	} else {
+		__m128i p0, p1;
+		expand8x32(fg, bg, pattern, p0, p1);
+		_mm_storeu_si128 (reinterpret_cast<__m128i*>(pixelPtr + 0), p0);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pixelPtr + 4), p1);
+	}
+	pixelPtr += 6;
+	return;
+#endif
+
+	pixelPtr[0] = (pattern & 0x80) ? fg : bg;
+	pixelPtr[1] = (pattern & 0x40) ? fg : bg;
+	pixelPtr[2] = (pattern & 0x20) ? fg : bg;
+	pixelPtr[3] = (pattern & 0x10) ? fg : bg;
+	pixelPtr[4] = (pattern & 0x08) ? fg : bg;
+	pixelPtr[5] = (pattern & 0x04) ? fg : bg;
+	pixelPtr += 6;
+}
+
+template<typename Pixel> inline void draw8(
+	Pixel* __restrict & pixelPtr, Pixel fg, Pixel bg, byte pattern)
+{
+#ifdef __SSE2__
+	auto* out = reinterpret_cast<__m128i*>(pixelPtr);
+	if constexpr (sizeof(Pixel) == 2) {
+		_mm_storeu_si128(out, expand8x16(fg, bg, pattern));
+	} else {
+		__m128i p0, p1;
+		expand8x32(fg, bg, pattern, p0, p1);
+		_mm_storeu_si128(out + 0, p0);
+		_mm_storeu_si128(out + 1, p1);
+	}
+	pixelPtr += 8;
+	return;
+#endif
+
+	// C++ version
+	pixelPtr[0] = (pattern & 0x80) ? fg : bg;
+	pixelPtr[1] = (pattern & 0x40) ? fg : bg;
+	pixelPtr[2] = (pattern & 0x20) ? fg : bg;
+	pixelPtr[3] = (pattern & 0x10) ? fg : bg;
+	pixelPtr[4] = (pattern & 0x08) ? fg : bg;
+	pixelPtr[5] = (pattern & 0x04) ? fg : bg;
+	pixelPtr[6] = (pattern & 0x02) ? fg : bg;
+	pixelPtr[7] = (pattern & 0x01) ? fg : bg;
+	pixelPtr += 8;
+}
+
+} // namespace openmsx
+
+#endif
@@ -59,6 +59,8 @@ Display::Display(Reactor& reactor_)
 	EventDistributor& eventDistributor = reactor.getEventDistributor();
 	eventDistributor.registerEventListener(OPENMSX_FINISH_FRAME_EVENT,
 			*this);
+	eventDistributor.registerEventListener(OPENMSX_LAYER_READY_EVENT,
+			*this);
 	eventDistributor.registerEventListener(OPENMSX_SWITCH_RENDERER_EVENT,
 			*this);
 	eventDistributor.registerEventListener(OPENMSX_MACHINE_LOADED_EVENT,
@@ -73,6 +75,7 @@ Display::Display(Reactor& reactor_)
 	renderSettings.getFullScreenSetting().attach(*this);
 	renderSettings.getScaleFactorSetting().attach(*this);
 	renderFrozen = false;
+	repaintPending = false;
 }
 
 Display::~Display()
@@ -92,6 +95,8 @@ Display::~Display()
 			*this);
 	eventDistributor.unregisterEventListener(OPENMSX_SWITCH_RENDERER_EVENT,
 			*this);
+	eventDistributor.unregisterEventListener(OPENMSX_LAYER_READY_EVENT,
+			*this);
 	eventDistributor.unregisterEventListener(OPENMSX_FINISH_FRAME_EVENT,
 			*this);
 
@@ -184,11 +189,16 @@ int Display::signalEvent(const std::shared_ptr<const Event>& event)
 	if (event->getType() == OPENMSX_FINISH_FRAME_EVENT) {
 		const auto& ffe = checked_cast<const FinishFrameEvent&>(*event);
 		if (ffe.needRender()) {
-			videoSystem->repaint();
-			reactor.getEventDistributor().distributeEvent(
-				std::make_shared<SimpleEvent>(
-					OPENMSX_FRAME_DRAWN_EVENT));
+			if (isPreparing()) {
+				// Don't wait for it, let the emulation continue
+				// and repaint when the image is ready.
+				repaintPending = true;
+			} else {
+				repaintFrame();
+			}
 		}
+	} else if (event->getType() == OPENMSX_LAYER_READY_EVENT) {
+		if (repaintPending) repaintFrame();
 	} else if (event->getType() == OPENMSX_SWITCH_RENDERER_EVENT) {
 		doRendererSwitch();
 	} else if (event->getType() == OPENMSX_MACHINE_LOADED_EVENT) {
@@ -220,6 +230,19 @@ int Display::signalEvent(const std::shared_ptr<const Event>& event)
 	return 0;
 }
 
+void Display::repaintFrame()
+{
+	repaintPending = false;
+	videoSystem->repaint();
+	reactor.getEventDistributor().distributeEvent(
+		std::make_shared<SimpleEvent>(OPENMSX_FRAME_DRAWN_EVENT));
+}
+
+bool Display::isPreparing() const
+{
+	return ranges::any_of(layers, [](Layer* l) { return l->isPreparing(); });
+}
+
 string Display::getWindowTitle()
 {
 	string title = Version::full();
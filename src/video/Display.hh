@@ -77,6 +77,9 @@ private:
 	// Observer<Setting> interface
 	void update(const Setting& setting) override;
 
+	void repaintFrame();
+	[[nodiscard]] bool isPreparing() const;
+
 	void checkRendererSwitch();
 	void doRendererSwitch();
 	void doRendererSwitch2();
@@ -125,6 +128,7 @@ private:
 
 	bool renderFrozen;
 	bool switchInProgress;
+	bool repaintPending; // a finished frame waits for a preparing layer
 };
 
 } // namespace openmsx
@@ -77,7 +77,8 @@ void DummyRenderer::updateColorBase(int /*addr*/, EmuTime::param /*time*/) {
 void DummyRenderer::updateSpritesEnabled(bool /*enabled*/, EmuTime::param /*time*/) {
 }
 
-void DummyRenderer::updateVRAM(unsigned /*offset*/, EmuTime::param /*time*/) {
+EmuTime DummyRenderer::updateVRAM(unsigned /*offset*/, EmuTime::param /*time*/) {
+	return EmuTime::infinity();
 }
 
 void DummyRenderer::updateWindow(bool /*enabled*/, EmuTime::param /*time*/) {
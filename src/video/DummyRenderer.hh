@@ -36,7 +36,7 @@ public:
 	void updatePatternBase(int addr, EmuTime::param time) override;
 	void updateColorBase(int addr, EmuTime::param time) override;
 	void updateSpritesEnabled(bool enabled, EmuTime::param time) override;
-	void updateVRAM(unsigned offset, EmuTime::param time) override;
+	EmuTime updateVRAM(unsigned offset, EmuTime::param time) override;
 	void updateWindow(bool enabled, EmuTime::param time) override;
 
 	// Layer interface:
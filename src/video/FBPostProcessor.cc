@@ -1,21 +1,31 @@
 #include "FBPostProcessor.hh"
+#include "BandScaler.hh"
+#include "Event.hh"
+#include "EventDistributor.hh"
+#include "MSXMotherBoard.hh"
 #include "RawFrame.hh"
+#include "Reactor.hh"
 #include "StretchScalerOutput.hh"
 #include "ScalerOutput.hh"
 #include "RenderSettings.hh"
 #include "Scaler.hh"
 #include "ScalerFactory.hh"
+#include "SDLOffScreenSurface.hh"
 #include "SDLOutputSurface.hh"
+#include "WorkerPool.hh"
 #include "aligned.hh"
 #include "checked_cast.hh"
 #include "random.hh"
 #include "xrange.hh"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #include <numeric>
+#include <thread>
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif
@@ -236,6 +246,8 @@ FBPostProcessor<Pixel>::FBPostProcessor(MSXMotherBoard& motherBoard_,
 	: PostProcessor(
 		motherBoard_, display_, screen_, videoSource, maxWidth_, height_,
 		canDoInterlace_)
+	, workerPool((std::thread::hardware_concurrency() > 1)
+	             ? &motherBoard_.getReactor().getWorkerPool() : nullptr)
 	, noiseShift(screen.getLogicalHeight())
 	, pixelOps(screen.getPixelFormat())
 {
@@ -252,6 +264,7 @@ FBPostProcessor<Pixel>::FBPostProcessor(MSXMotherBoard& motherBoard_,
 template<typename Pixel>
 FBPostProcessor<Pixel>::~FBPostProcessor()
 {
+	waitScaled();
 	renderSettings.getNoiseSetting().detach(*this);
 }
 
@@ -268,6 +281,7 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output_)
 	}
 
 	if (!paintFrame) return;
+	waitScaled();
 
 	// New scaler algorithm selected? Or different horizontal stretch?
 	auto algo = renderSettings.getScaleAlgorithm();
@@ -284,11 +298,43 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output_)
 			renderSettings);
 		stretchScaler = StretchScalerOutputFactory<Pixel>::create(
 			output, pixelOps, inWidth);
+		backScaler.reset();
+		backValid = false;
 	}
 
-	// Scale image.
-	const unsigned srcHeight = paintFrame->getHeight();
-	const unsigned dstHeight = output.getLogicalHeight();
+	if (backValid && (&output == &screen) && !superImposeVideoFrame) {
+		// Image was already scaled by startScaling(), only copy it.
+		auto srcAccess = backSurface->getDirectPixelAccess();
+		auto dstAccess = output.getDirectPixelAccess();
+		auto size = sizeof(Pixel) * output.getLogicalWidth();
+		for (auto y : xrange(output.getLogicalHeight())) {
+			memcpy(dstAccess.getLinePtr<Pixel>(y),
+			       srcAccess.getLinePtr<Pixel>(y), size);
+		}
+	} else {
+		scaleFrame(*paintFrame, superImposeVideoFrame, *stretchScaler,
+		           workerPool);
+	}
+
+	drawNoise(output);
+
+	output.flushFrameBuffer();
+}
+
+template<typename Pixel>
+bool FBPostProcessor<Pixel>::isPreparing() const
+{
+	return backJob.valid() &&
+	       (backJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+}
+
+template<typename Pixel>
+void FBPostProcessor<Pixel>::scaleFrame(
+	FrameSource& frame, const RawFrame* superImpose,
+	ScalerOutput<Pixel>& dst, WorkerPool* pool)
+{
+	const unsigned srcHeight = frame.getHeight();
+	const unsigned dstHeight = dst.getHeight();
 
 	unsigned g = std::gcd(srcHeight, dstHeight);
 	unsigned srcStep = srcHeight / g;
@@ -304,11 +350,11 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output_)
 		assert(srcStartY < srcHeight);
 
 		// get region with equal lineWidth
-		unsigned lineWidth = getLineWidth(paintFrame, srcStartY, srcStep);
+		unsigned lineWidth = getLineWidth(&frame, srcStartY, srcStep);
 		unsigned srcEndY = srcStartY + srcStep;
 		unsigned dstEndY = dstStartY + dstStep;
 		while ((srcEndY < srcHeight) && (dstEndY < dstHeight) &&
-		       (getLineWidth(paintFrame, srcEndY, srcStep) == lineWidth)) {
+		       (getLineWidth(&frame, srcEndY, srcStep) == lineWidth)) {
 			srcEndY += srcStep;
 			dstEndY += dstStep;
 		}
@@ -316,32 +362,79 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output_)
 		// fill region
 		//fprintf(stderr, "post processing lines %d-%d: %d\n",
 		//        srcStartY, srcEndY, lineWidth);
-		currScaler->scaleImage(
-			*paintFrame, superImposeVideoFrame,
-			srcStartY, srcEndY, lineWidth, // source
-			*stretchScaler, dstStartY, dstEndY); // dest
+		if (pool) {
+			scaleInBands(*currScaler, *pool,
+				frame, superImpose,
+				srcStartY, srcEndY, lineWidth, // source
+				dst, dstStartY, dstEndY, // dest
+				srcStep, dstStep);
+		} else {
+			currScaler->scaleImage(
+				frame, superImpose,
+				srcStartY, srcEndY, lineWidth, // source
+				dst, dstStartY, dstEndY); // dest
+		}
 
 		// next region
 		srcStartY = srcEndY;
 		dstStartY = dstEndY;
 	}
+}
 
-	drawNoise(output);
+template<typename Pixel>
+void FBPostProcessor<Pixel>::startScaling()
+{
+	backValid = false;
+
+	// Only scalers that read nothing but the frame can run on another
+	// thread, the others read settings while scaling. Images with a
+	// superimposed video or VDP frame are scaled in paint().
+	if (!workerPool || !paintFrame || superImposeVideoFrame || superImposeVdpFrame ||
+	    (getCoverage() == COVER_NONE) || (lastOutput != &screen) ||
+	    !currScaler || !currScaler->canScaleInBands()) {
+		return;
+	}
 
-	output.flushFrameBuffer();
+	if (!backSurface) {
+		backSurface = std::make_unique<SDLOffScreenSurface>(
+			*checked_cast<SDLOutputSurface&>(screen).getSDLSurface());
+	}
+	if (!backScaler) {
+		backScaler = StretchScalerOutputFactory<Pixel>::create(
+			*backSurface, pixelOps, stretchWidth);
+	}
+
+	// (WorkerPool::wait() allows to also split this job in bands)
+	backJob = workerPool->submit([this, frame = paintFrame] {
+		scaleFrame(*frame, nullptr, *backScaler, workerPool);
+		getEventDistributor().distributeEvent(
+			std::make_shared<SimpleEvent>(OPENMSX_LAYER_READY_EVENT));
+	}, this);
+	backValid = true;
+}
+
+template<typename Pixel>
+void FBPostProcessor<Pixel>::waitScaled()
+{
+	// (when the job didn't start yet, this thread executes it)
+	if (backJob.valid()) workerPool->wait(this);
 }
 
 template<typename Pixel>
 std::unique_ptr<RawFrame> FBPostProcessor<Pixel>::rotateFrames(
 	std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time)
 {
+	waitScaled();
+
 	auto& generator = global_urng(); // fast (non-cryptographic) random numbers
 	std::uniform_int_distribution<int> distribution(0, NOISE_SHIFT / 16 - 1);
 	for (auto y : xrange(screen.getLogicalHeight())) {
 		noiseShift[y] = distribution(generator) * 16;
 	}
 
-	return PostProcessor::rotateFrames(std::move(finishedFrame), time);
+	auto result = PostProcessor::rotateFrames(std::move(finishedFrame), time);
+	startScaling();
+	return result;
 }
 
 
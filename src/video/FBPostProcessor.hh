@@ -5,12 +5,16 @@
 #include "RenderSettings.hh"
 #include "PixelOperations.hh"
 #include "ScalerOutput.hh"
+#include <future>
+#include <memory>
 #include <vector>
 
 namespace openmsx {
 
 class MSXMotherBoard;
 class Display;
+class SDLOffScreenSurface;
+class WorkerPool;
 template<typename Pixel> class Scaler;
 
 /** Rasterizer using SDL.
@@ -29,11 +33,17 @@ public:
 
 	// Layer interface:
 	void paint(OutputSurface& output) override;
+	[[nodiscard]] bool isPreparing() const override;
 
 	[[nodiscard]] std::unique_ptr<RawFrame> rotateFrames(
 		std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time) override;
 
 private:
+	void scaleFrame(FrameSource& frame, const RawFrame* superImpose,
+	                ScalerOutput<Pixel>& dst, WorkerPool* pool);
+	void startScaling();
+	void waitScaled();
+
 	void preCalcNoise(float factor);
 	void drawNoise(OutputSurface& output);
 	void drawNoiseLine(Pixel* buf, signed char* noise,
@@ -67,6 +77,23 @@ private:
 	  */
 	OutputSurface* lastOutput = nullptr;
 
+	/** Threads to scale large areas in bands, see scaleInBands().
+	  * nullptr on a single core host.
+	  */
+	WorkerPool* const workerPool;
+
+	/** Off-screen copy of the screen. When a new frame becomes available,
+	  * a worker thread scales it into this surface while the emulation
+	  * continues, paint() then only has to copy it. See startScaling().
+	  */
+	std::unique_ptr<SDLOffScreenSurface> backSurface;
+	std::unique_ptr<ScalerOutput<Pixel>> backScaler;
+	std::future<void> backJob;
+	/** Does 'backSurface' hold the current 'paintFrame' (once 'backJob'
+	  * is finished)?
+	  */
+	bool backValid = false;
+
 	/** Remember the noise values to get a stable image when paused.
 	 */
 	std::vector<unsigned> noiseShift;
@@ -45,6 +45,12 @@ public:
 	  */
 	virtual void paint(OutputSurface& output) = 0;
 
+	/** Is this layer still preparing its next image in the background?
+	  * In that case the Display postpones the repaint for a finished frame
+	  * until an OPENMSX_LAYER_READY_EVENT is received.
+	  */
+	[[nodiscard]] virtual bool isPreparing() const { return false; }
+
 	/** Query the Z-index of this layer.
 	  */
 	[[nodiscard]] ZIndex getZ() const { return z; }
@@ -511,7 +511,7 @@ inline bool PixelRenderer::checkSync(int offset, EmuTime::param time)
 	}
 }
 
-void PixelRenderer::updateVRAM(unsigned offset, EmuTime::param time)
+EmuTime PixelRenderer::updateVRAM(unsigned offset, EmuTime::param time)
 {
 	// Note: No need to sync if display is disabled, because then the
 	//       output does not depend on VRAM (only on background color).
@@ -519,6 +519,44 @@ void PixelRenderer::updateVRAM(unsigned offset, EmuTime::param time)
 		//fprintf(stderr, "vram sync @ line %d\n",
 		//	vdp.getTicksThisFrame(time) / VDP::TICKS_PER_LINE);
 		renderUntil(time);
+		// Rendering stopped at the position that corresponds to 'time',
+		// a renderUntil() for a later change that maps to the same
+		// position does nothing. So those changes can be skipped.
+		int ticks = vdp.getTicksThisFrame(time);
+		switch (accuracy) {
+		case RenderSettings::ACC_PIXEL:
+			return vdp.getTimeThisFrame(ticks + 1);
+		case RenderSettings::ACC_LINE:
+		case RenderSettings::ACC_SCREEN: {
+			// same rounding as in renderUntil()
+			int line = (ticks + VDP::TICKS_PER_LINE - 400) / VDP::TICKS_PER_LINE;
+			return vdp.getTimeThisFrame(line * VDP::TICKS_PER_LINE + 400);
+		}
+		default:
+			UNREACHABLE;
+			return time; // avoid warning
+		}
+	}
+	skipUnchecked(offset);
+	return time;
+}
+
+void PixelRenderer::skipUnchecked(unsigned offset)
+{
+	// The change doesn't influence the output. When that holds for a whole
+	// range of VRAM as long as the VDP state doesn't change, the following
+	// changes in that range don't have to be checked anymore. (E.g. an
+	// upload to a hidden page.) Any VDP state change resets this skip, see
+	// VDPVRAM::resetNotify().
+	auto& window = vram.bitmapVisibleWindow;
+	if (!renderFrame || !displayEnabled ||
+	    (accuracy == RenderSettings::ACC_SCREEN)) {
+		window.skipNotify(0, ~0u); // all of VRAM
+	} else if ((vdp.getDisplayMode().getBase() ==
+	            one_of(DisplayMode::GRAPHIC4, DisplayMode::GRAPHIC5)) &&
+	           !vdp.isFastBlinkEnabled()) {
+		// see checkSync(): only the visible page(s) matter
+		window.skipNotify(offset & 0x18000, 0x8000); // this page
 	}
 }
 
@@ -57,7 +57,7 @@ public:
 	void updatePatternBase(int addr, EmuTime::param time) override;
 	void updateColorBase(int addr, EmuTime::param time) override;
 	void updateSpritesEnabled(bool enabled, EmuTime::param time) override;
-	void updateVRAM(unsigned offset, EmuTime::param time) override;
+	EmuTime updateVRAM(unsigned offset, EmuTime::param time) override;
 	void updateWindow(bool enabled, EmuTime::param time) override;
 
 private:
@@ -86,6 +86,7 @@ private:
 		int clipL, int clipR, DrawType drawType);
 
 	[[nodiscard]] inline bool checkSync(int offset, EmuTime::param time);
+	void skipUnchecked(unsigned offset);
 
 	/** Update renderer state to specified moment in time.
 	  * @param time Moment in emulated time to update to.
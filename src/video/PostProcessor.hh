@@ -96,6 +96,8 @@ protected:
 	  */
 	[[nodiscard]] static unsigned getLineWidth(FrameSource* frame, unsigned y, unsigned step);
 
+	[[nodiscard]] EventDistributor& getEventDistributor() const { return eventDistributor; }
+
 	PostProcessor(
 		MSXMotherBoard& motherBoard, Display& display,
 		OutputSurface& screen, const std::string& videoSource,
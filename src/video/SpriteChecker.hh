@@ -247,8 +247,11 @@ public:
 
 	// VRAMObserver implementation:
 
-	void updateVRAM(unsigned /*offset*/, EmuTime::param time) override {
+	EmuTime updateVRAM(unsigned /*offset*/, EmuTime::param time) override {
 		checkUntil(time);
+		// Sprites are checked per line, changes before the next line
+		// are picked up when that line is checked.
+		return frameStartTime + (currentLine + 1) * VDP::TICKS_PER_LINE;
 	}
 
 	void updateWindow(bool /*enabled*/, EmuTime::param time) override {
@@ -637,6 +637,7 @@ void VDP::frameStart(EmuTime::param time)
 	// TODO: Do this via VDPVRAM?
 	renderer->frameStart(time);
 	spriteChecker->frameStart(time);
+	vram->resetNotify();
 
 	/*
 	   cout << "--> frameStart = " << frameStartTime
@@ -1015,6 +1016,7 @@ void VDP::changeRegister(byte reg, byte val, EmuTime::param time)
 		if (blinkState == ((val & 0xF0) == 0)) {
 			renderer->updateBlinkState(!blinkState, time);
 			blinkState = !blinkState;
+			vram->resetNotify(); // the visible page can change
 		}
 
 		if ((val & 0xF0) && (val & 0x0F)) {
@@ -1229,6 +1231,10 @@ void VDP::changeRegister(byte reg, byte val, EmuTime::param time)
 		}
 		break;
 	}
+
+	// VRAM changes that were skipped (see VDPVRAM::resetNotify()) can be
+	// relevant with the new state.
+	vram->resetNotify();
 }
 
 void VDP::syncAtNextLine(SyncBase& type, EmuTime::param time)
@@ -467,6 +467,13 @@ public:
 		return frameStartTime.getTime();
 	}
 
+	/** Gets the moment in emulated time that is the given number of VDP
+	  * clock ticks (21MHz) after the start of this frame.
+	  */
+	[[nodiscard]] inline EmuTime getTimeThisFrame(int ticks) const {
+		return frameStartTime + ticks;
+	}
+
 	/** Gets the sprite size in pixels (8/16).
 	  */
 	[[nodiscard]] inline int getSpriteSize() const {
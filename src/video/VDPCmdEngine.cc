@@ -41,6 +41,7 @@ TODO:
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <optional>
 
 using std::min;
 using std::max;
@@ -171,10 +172,11 @@ struct Graphic4Mode
 	static constexpr byte PIXELS_PER_BYTE = 2;
 	static constexpr byte PIXELS_PER_BYTE_SHIFT = 1;
 	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = false;
 	static inline unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static inline byte point(VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static inline void pset(EmuTime::param time, VDPVRAM& vram,
+	template<typename VRAM, typename LogOp>
+	static inline void pset(EmuTime::param time, VRAM& vram,
 		unsigned x, unsigned addr, byte src, byte color, LogOp op);
 	static inline byte duplicate(byte color);
 };
@@ -194,9 +196,9 @@ inline byte Graphic4Mode::point(
 		>> (((~x) & 1) << 2)) & 15;
 }
 
-template<typename LogOp>
+template<typename VRAM, typename LogOp>
 inline void Graphic4Mode::pset(
-	EmuTime::param time, VDPVRAM& vram, unsigned x, unsigned addr,
+	EmuTime::param time, VRAM& vram, unsigned x, unsigned addr,
 	byte src, byte color, LogOp op)
 {
 	byte sh = ((~x) & 1) << 2;
@@ -221,10 +223,11 @@ struct Graphic5Mode
 	static constexpr byte PIXELS_PER_BYTE = 4;
 	static constexpr byte PIXELS_PER_BYTE_SHIFT = 2;
 	static constexpr unsigned PIXELS_PER_LINE = 512;
+	static constexpr bool PLANAR = false;
 	static inline unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static inline byte point(VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static inline void pset(EmuTime::param time, VDPVRAM& vram,
+	template<typename VRAM, typename LogOp>
+	static inline void pset(EmuTime::param time, VRAM& vram,
 		unsigned x, unsigned addr, byte src, byte color, LogOp op);
 	static inline byte duplicate(byte color);
 };
@@ -244,9 +247,9 @@ inline byte Graphic5Mode::point(
 		>> (((~x) & 3) << 1)) & 3;
 }
 
-template<typename LogOp>
+template<typename VRAM, typename LogOp>
 inline void Graphic5Mode::pset(
-	EmuTime::param time, VDPVRAM& vram, unsigned x, unsigned addr,
+	EmuTime::param time, VRAM& vram, unsigned x, unsigned addr,
 	byte src, byte color, LogOp op)
 {
 	byte sh = ((~x) & 3) << 1;
@@ -273,10 +276,11 @@ struct Graphic6Mode
 	static constexpr byte PIXELS_PER_BYTE = 2;
 	static constexpr byte PIXELS_PER_BYTE_SHIFT = 1;
 	static constexpr unsigned PIXELS_PER_LINE = 512;
+	static constexpr bool PLANAR = true; // consecutive bytes alternate between two 64kB banks
 	static inline unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static inline byte point(VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static inline void pset(EmuTime::param time, VDPVRAM& vram,
+	template<typename VRAM, typename LogOp>
+	static inline void pset(EmuTime::param time, VRAM& vram,
 		unsigned x, unsigned addr, byte src, byte color, LogOp op);
 	static inline byte duplicate(byte color);
 };
@@ -296,9 +300,9 @@ inline byte Graphic6Mode::point(
 		>> (((~x) & 1) << 2)) & 15;
 }
 
-template<typename LogOp>
+template<typename VRAM, typename LogOp>
 inline void Graphic6Mode::pset(
-	EmuTime::param time, VDPVRAM& vram, unsigned x, unsigned addr,
+	EmuTime::param time, VRAM& vram, unsigned x, unsigned addr,
 	byte src, byte color, LogOp op)
 {
 	byte sh = ((~x) & 1) << 2;
@@ -323,10 +327,11 @@ struct Graphic7Mode
 	static constexpr byte PIXELS_PER_BYTE = 1;
 	static constexpr byte PIXELS_PER_BYTE_SHIFT = 0;
 	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = true; // consecutive bytes alternate between two 64kB banks
 	static inline unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static inline byte point(VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static inline void pset(EmuTime::param time, VDPVRAM& vram,
+	template<typename VRAM, typename LogOp>
+	static inline void pset(EmuTime::param time, VRAM& vram,
 		unsigned x, unsigned addr, byte src, byte color, LogOp op);
 	static inline byte duplicate(byte color);
 };
@@ -345,9 +350,9 @@ inline byte Graphic7Mode::point(
 	return vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM));
 }
 
-template<typename LogOp>
+template<typename VRAM, typename LogOp>
 inline void Graphic7Mode::pset(
-	EmuTime::param time, VDPVRAM& vram, unsigned /*x*/, unsigned addr,
+	EmuTime::param time, VRAM& vram, unsigned /*x*/, unsigned addr,
 	byte src, byte color, LogOp op)
 {
 	op(time, vram, addr, src, color, 0);
@@ -371,10 +376,11 @@ struct NonBitmapMode
 	static constexpr byte PIXELS_PER_BYTE = 1;
 	static constexpr byte PIXELS_PER_BYTE_SHIFT = 0;
 	static constexpr unsigned PIXELS_PER_LINE = 256;
+	static constexpr bool PLANAR = false;
 	static inline unsigned addressOf(unsigned x, unsigned y, bool extVRAM);
 	static inline byte point(VDPVRAM& vram, unsigned x, unsigned y, bool extVRAM);
-	template<typename LogOp>
-	static inline void pset(EmuTime::param time, VDPVRAM& vram,
+	template<typename VRAM, typename LogOp>
+	static inline void pset(EmuTime::param time, VRAM& vram,
 		unsigned x, unsigned addr, byte src, byte color, LogOp op);
 	static inline byte duplicate(byte color);
 };
@@ -393,9 +399,9 @@ inline byte NonBitmapMode::point(
 	return vram.cmdReadWindow.readNP(addressOf(x, y, extVRAM));
 }
 
-template<typename LogOp>
+template<typename VRAM, typename LogOp>
 inline void NonBitmapMode::pset(
-	EmuTime::param time, VDPVRAM& vram, unsigned /*x*/, unsigned addr,
+	EmuTime::param time, VRAM& vram, unsigned /*x*/, unsigned addr,
 	byte src, byte color, LogOp op)
 {
 	op(time, vram, addr, src, color, 0);
@@ -652,7 +658,8 @@ struct IncrShift7
 // Logical operations:
 
 struct DummyOp {
-	void operator()(EmuTime::param /*time*/, VDPVRAM& /*vram*/, unsigned /*addr*/,
+	template<typename VRAM>
+	void operator()(EmuTime::param /*time*/, VRAM& /*vram*/, unsigned /*addr*/,
 	                byte /*src*/, byte /*color*/, byte /*mask*/) const
 	{
 		// Undefined logical operations do nothing.
@@ -660,7 +667,8 @@ struct DummyOp {
 };
 
 struct ImpOp {
-	void operator()(EmuTime::param time, VDPVRAM& vram, unsigned addr,
+	template<typename VRAM>
+	void operator()(EmuTime::param time, VRAM& vram, unsigned addr,
 	                byte src, byte color, byte mask) const
 	{
 		vram.cmdWrite(addr, (src & mask) | color, time);
@@ -668,7 +676,8 @@ struct ImpOp {
 };
 
 struct AndOp {
-	void operator()(EmuTime::param time, VDPVRAM& vram, unsigned addr,
+	template<typename VRAM>
+	void operator()(EmuTime::param time, VRAM& vram, unsigned addr,
 	                byte src, byte color, byte mask) const
 	{
 		vram.cmdWrite(addr, src & (color | mask), time);
@@ -676,7 +685,8 @@ struct AndOp {
 };
 
 struct OrOp {
-	void operator()(EmuTime::param time, VDPVRAM& vram, unsigned addr,
+	template<typename VRAM>
+	void operator()(EmuTime::param time, VRAM& vram, unsigned addr,
 	                byte src, byte color, byte /*mask*/) const
 	{
 		vram.cmdWrite(addr, src | color, time);
@@ -684,7 +694,8 @@ struct OrOp {
 };
 
 struct XorOp {
-	void operator()(EmuTime::param time, VDPVRAM& vram, unsigned addr,
+	template<typename VRAM>
+	void operator()(EmuTime::param time, VRAM& vram, unsigned addr,
 	                byte src, byte color, byte /*mask*/) const
 	{
 		vram.cmdWrite(addr, src ^ color, time);
@@ -692,7 +703,8 @@ struct XorOp {
 };
 
 struct NotOp {
-	void operator()(EmuTime::param time, VDPVRAM& vram, unsigned addr,
+	template<typename VRAM>
+	void operator()(EmuTime::param time, VRAM& vram, unsigned addr,
 	                byte src, byte color, byte mask) const
 	{
 		vram.cmdWrite(addr, (src & mask) | ~(color | mask), time);
@@ -701,7 +713,8 @@ struct NotOp {
 
 template<typename Op>
 struct TransparentOp : Op {
-	void operator()(EmuTime::param time, VDPVRAM& vram, unsigned addr,
+	template<typename VRAM>
+	void operator()(EmuTime::param time, VRAM& vram, unsigned addr,
 	                byte src, byte color, byte mask) const
 	{
 		// TODO does this skip the write or re-write the original value
@@ -717,6 +730,76 @@ using TXorOp = TransparentOp<XorOp>;
 using TNotOp = TransparentOp<NotOp>;
 
 
+// Bulk execution of block commands:
+//
+// The block commands (HMMV, HMMM, YMMM and LMMV) normally access VRAM one
+// byte (or pixel) per access slot. When the remainder of such a command
+// finishes before the time till which the command engine is synced, and
+// when it doesn't write to VRAM that is observed by the renderer or the
+// sprite checker, nobody can see the intermediate states. Then all the
+// writes are done at once, without synchronizing the observers for each
+// byte. The finish time is still calculated per access slot, so the timing
+// of the command doesn't change.
+
+// Calculate the time of the last VRAM write of the remainder of a block
+// command, or nothing if that's not before the limit of the calculator.
+// The first line has 'anx' and the other 'ny - 1' lines have 'nx'
+// elements. Each element optionally does a read ('readDelta' before the
+// write, DELTA_0 means no read). The next element comes 'delta' after the
+// write, or 'lineDelta' for the first element of the next line.
+static std::optional<EmuTime> calcBlockFinishTime(
+	VDPAccessSlots::Calculator calculator, Delta readDelta, Delta delta,
+	Delta lineDelta, unsigned anx, unsigned nx, unsigned ny)
+{
+	while (true) {
+		if (readDelta != DELTA_0) {
+			if (calculator.limitReached()) return {};
+			calculator.next(readDelta);
+		}
+		if (calculator.limitReached()) return {};
+		if (--anx == 0) {
+			if (--ny == 0) return calculator.getTime();
+			anx = nx;
+			calculator.next(lineDelta);
+		} else {
+			calculator.next(delta);
+		}
+	}
+}
+
+// Is none of the VRAM written by the remainder of a block command observed?
+// The first line starts at 'x' and has 'anx' elements, the other 'ny - 1'
+// lines start at 'startX' and have 'nx' elements. Consecutive elements are
+// 'tx' pixels apart, consecutive lines 'ty'.
+template<typename Mode>
+static bool isUnobservedBlock(
+	const VDPVRAM& vram, unsigned x, unsigned anx, unsigned startX,
+	unsigned nx, unsigned y, unsigned ny, int tx, int ty)
+{
+	for (/**/; ny; --ny, y += ty, x = startX, anx = nx) {
+		unsigned first = Mode::addressOf(x,                  y, false);
+		unsigned last  = Mode::addressOf(x + tx * (anx - 1), y, false);
+		if (Mode::PLANAR) {
+			first &= 0xFFFF;
+			last  &= 0xFFFF;
+		}
+		unsigned start = min(first, last);
+		unsigned size = max(first, last) - start + 1;
+		if (!vram.isUnobserved(start, size)) return false;
+		if (Mode::PLANAR && !vram.isUnobserved(start | 0x10000, size)) return false;
+	}
+	return true;
+}
+
+// Used instead of VDPVRAM when the logical operations are applied in bulk.
+struct UnobservedVRAM {
+	void cmdWrite(unsigned address, byte value, EmuTime::param /*time*/) {
+		vram.cmdWriteUnobserved(address, value);
+	}
+	VDPVRAM& vram;
+};
+
+
 // Commands
 
 void VDPCmdEngine::setStatusChangeTime(EmuTime::param t)
@@ -973,6 +1056,28 @@ void VDPCmdEngine::executeLmmv(EmuTime::param limit)
 	unsigned addr = Mode::addressOf(ADX, DY, dstExt);
 	auto calculator = getSlotCalculator(limit);
 
+	if (!dstExt && (phase == 0) && (limit >= statusChangeTime) &&
+	    isUnobservedBlock<Mode>(vram, ADX, ANX, DX, tmpNX, DY, tmpNY, TX, TY)) {
+		if (auto finish = calcBlockFinishTime(
+			calculator, DELTA_24, DELTA_72, DELTA_136, ANX, tmpNX, tmpNY)) {
+			UnobservedVRAM unobserved{vram};
+			for (/**/; tmpNY; --tmpNY) {
+				for (/**/; ANX; --ANX) {
+					unsigned dstAddr = Mode::addressOf(ADX, DY, false);
+					tmpDst = vram.cmdWriteWindow.readNP(dstAddr);
+					Mode::pset(*finish, unobserved, ADX, dstAddr,
+					           tmpDst, CL, LogOp());
+					ADX += TX;
+				}
+				DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+			}
+			engineTime = *finish;
+			commandDone(engineTime);
+			return;
+		}
+	}
+
 	switch (phase) {
 	case 0:
 loop:		if (unlikely(calculator.limitReached())) { phase = 0; break; }
@@ -1350,6 +1455,32 @@ void VDPCmdEngine::executeHmmv(EmuTime::param limit)
 	bool doPset = !dstExt || hasExtendedVRAM;
 	auto calculator = getSlotCalculator(limit);
 
+	if (!dstExt && (limit >= statusChangeTime) &&
+	    isUnobservedBlock<Mode>(vram, ADX, ANX, DX, tmpNX, DY, tmpNY, TX, TY)) {
+		if (auto finish = calcBlockFinishTime(
+			calculator, DELTA_0, DELTA_48, DELTA_104, ANX, tmpNX, tmpNY)) {
+			for (/**/; tmpNY; --tmpNY) {
+				if (Mode::PLANAR) {
+					for (/**/; ANX; --ANX) {
+						vram.cmdWriteUnobserved(
+							Mode::addressOf(ADX, DY, false), COL);
+						ADX += TX;
+					}
+				} else {
+					// the bytes of a line are consecutive in VRAM
+					unsigned first = Mode::addressOf(ADX,                  DY, false);
+					unsigned last  = Mode::addressOf(ADX + TX * (ANX - 1), DY, false);
+					vram.cmdFillUnobserved(min(first, last), ANX, COL);
+				}
+				DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+			}
+			engineTime = *finish;
+			commandDone(engineTime);
+			return;
+		}
+	}
+
 	while (!calculator.limitReached()) {
 		if (likely(doPset)) {
 			vram.cmdWrite(Mode::addressOf(ADX, DY, dstExt),
@@ -1458,6 +1589,28 @@ void VDPCmdEngine::executeHmmm(EmuTime::param limit)
 	bool doPset  = !dstExt || hasExtendedVRAM;
 	auto calculator = getSlotCalculator(limit);
 
+	if (!srcExt && !dstExt && (phase == 0) && (limit >= statusChangeTime) &&
+	    isUnobservedBlock<Mode>(vram, ADX, ANX, DX, tmpNX, DY, tmpNY, TX, TY)) {
+		if (auto finish = calcBlockFinishTime(
+			calculator, DELTA_24, DELTA_64, DELTA_128, ANX, tmpNX, tmpNY)) {
+			// byte per byte, source and destination may overlap
+			for (/**/; tmpNY; --tmpNY) {
+				for (/**/; ANX; --ANX) {
+					tmpSrc = vram.cmdReadWindow.readNP(
+						Mode::addressOf(ASX, SY, false));
+					vram.cmdWriteUnobserved(
+						Mode::addressOf(ADX, DY, false), tmpSrc);
+					ASX += TX; ADX += TX;
+				}
+				SY += TY; DY += TY; --NY;
+				ASX = SX; ADX = DX; ANX = tmpNX;
+			}
+			engineTime = *finish;
+			commandDone(engineTime);
+			return;
+		}
+	}
+
 	switch (phase) {
 	case 0:
 loop:		if (unlikely(calculator.limitReached())) { phase = 0; break; }
@@ -1592,6 +1745,28 @@ void VDPCmdEngine::executeYmmm(EmuTime::param limit)
 	bool doPset  = !dstExt || hasExtendedVRAM;
 	auto calculator = getSlotCalculator(limit);
 
+	if (!dstExt && (phase == 0) && (limit >= statusChangeTime) &&
+	    isUnobservedBlock<Mode>(vram, ADX, ANX, DX, tmpNX, DY, tmpNY, TX, TY)) {
+		if (auto finish = calcBlockFinishTime(
+			calculator, DELTA_24, DELTA_40, DELTA_40, ANX, tmpNX, tmpNY)) {
+			// byte per byte, source and destination may overlap
+			for (/**/; tmpNY; --tmpNY) {
+				for (/**/; ANX; --ANX) {
+					tmpSrc = vram.cmdReadWindow.readNP(
+						Mode::addressOf(ADX, SY, false));
+					vram.cmdWriteUnobserved(
+						Mode::addressOf(ADX, DY, false), tmpSrc);
+					ADX += TX;
+				}
+				SY += TY; DY += TY; --NY;
+				ADX = DX; ANX = tmpNX;
+			}
+			engineTime = *finish;
+			commandDone(engineTime);
+			return;
+		}
+	}
+
 	switch (phase) {
 	case 0:
 loop:		if (unlikely(calculator.limitReached())) { phase = 0; break; }
@@ -126,6 +126,10 @@ VDPVRAM::VDPVRAM(VDP& vdp_, unsigned size, EmuTime::param time)
 {
 	(void)time;
 
+	// All writes go via writeCommon() or via the methods below that
+	// rearrange the whole VRAM.
+	data.getDirtyPages().enable();
+
 	vrMode = vdp.getVRMode();
 	setSizeMask(time);
 
@@ -148,12 +152,22 @@ void VDPVRAM::clear()
 	}
 }
 
+void VDPVRAM::cmdFillUnobserved(unsigned address, unsigned size, byte value)
+{
+	assert(isUnobserved(address, size));
+	if (address >= actualSize) return;
+	size = std::min(size, actualSize - address);
+	memset(&data[address], value, size);
+	data.getDirtyPages().markDirty(address, size);
+}
+
 void VDPVRAM::updateDisplayMode(DisplayMode mode, bool cmdBit, EmuTime::param time)
 {
 	assert(vdp.isInsideFrame(time));
 	cmdEngine->updateDisplayMode(mode, cmdBit, time);
 	renderer->updateDisplayMode(mode, time);
 	spriteChecker->updateDisplayMode(mode, time);
+	resetNotify();
 }
 
 void VDPVRAM::updateDisplayEnabled(bool enabled, EmuTime::param time)
@@ -162,6 +176,7 @@ void VDPVRAM::updateDisplayEnabled(bool enabled, EmuTime::param time)
 	cmdEngine->sync(time);
 	renderer->updateDisplayEnabled(enabled, time);
 	spriteChecker->updateDisplayEnabled(enabled, time);
+	resetNotify();
 }
 
 void VDPVRAM::updateSpritesEnabled(bool enabled, EmuTime::param time)
@@ -221,6 +236,7 @@ void VDPVRAM::updateVRMode(bool newVRmode, EmuTime::param time)
 			std::swap(data[i], data[swapAddr(i)]);
 		}
 	}
+	data.getDirtyPages().markAllDirty();
 }
 
 void VDPVRAM::setRenderer(Renderer* newRenderer, EmuTime::param time)
@@ -303,6 +319,7 @@ void VDPVRAM::change4k8kMapping(bool mapping8k)
 		}
 	}
 	memcpy(&data[0], tmp, sizeof(tmp));
+	data.getDirtyPages().markDirty(0, sizeof(tmp));
 }
 
 
@@ -327,7 +344,7 @@ void VDPVRAM::serialize(Archive& ar, unsigned /*version*/)
 		setSizeMask(static_cast<MSXDevice&>(vdp).getCurrentTime());
 	}
 
-	ar.serialize_blob("data", &data[0], actualSize);
+	ar.serialize_blob("data", &data[0], actualSize, data.getDirtyPages());
 	ar.serialize("cmdReadWindow",       cmdReadWindow,
 	             "cmdWriteWindow",      cmdWriteWindow,
 	             "nameTable",           nameTable,
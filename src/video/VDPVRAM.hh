@@ -9,6 +9,7 @@
 #include "Math.hh"
 #include "openmsx.hh"
 #include "likely.hh"
+#include <algorithm>
 #include <cassert>
 
 namespace openmsx {
@@ -118,7 +119,9 @@ can decide for itself how many bytes to read.
 class DummyVRAMOBserver final : public VRAMObserver
 {
 public:
-	void updateVRAM(unsigned /*offset*/, EmuTime::param /*time*/) override {}
+	EmuTime updateVRAM(unsigned /*offset*/, EmuTime::param /*time*/) override {
+		return EmuTime::infinity();
+	}
 	void updateWindow(bool /*enabled*/, EmuTime::param /*time*/) override {}
 };
 
@@ -135,6 +138,13 @@ public:
 class VRAMWindow
 {
 public:
+	/** Create a new window.
+	  * Initially, the window is disabled; use setMask to enable it.
+	  * Normally only VDPVRAM creates VRAMWindow objects (the unittests
+	  * also do).
+	  */
+	explicit VRAMWindow(Ram& vram);
+
 	VRAMWindow(const VRAMWindow&) = delete;
 	VRAMWindow& operator=(const VRAMWindow&) = delete;
 
@@ -170,6 +180,7 @@ public:
 			return;
 		}
 		observer->updateWindow(true, time);
+		resetNotify();
 		effectiveBaseMask = newBaseMask;
 		indexMask         = newIndexMask;
 		baseAddr  =  effectiveBaseMask & indexMask; // this enables window
@@ -181,6 +192,7 @@ public:
 	  */
 	inline void disable(EmuTime::param time) {
 		observer->updateWindow(false, time);
+		resetNotify();
 		baseAddr = -1;
 	}
 
@@ -279,12 +291,35 @@ public:
 	  */
 	inline void setObserver(VRAMObserver* newObserver) {
 		observer = newObserver;
+		resetNotify();
 	}
 
 	/** Unregister the observer of this VRAM window.
 	  */
 	inline void resetObserver() {
 		observer = &dummyObserver;
+		resetNotify();
+	}
+
+	/** Report all following changes inside this window to the observer
+	  * again, also the ones before the moment returned by the last
+	  * VRAMObserver::updateVRAM() call and the ones skipped by
+	  * skipNotify().
+	  */
+	inline void resetNotify() {
+		skipNotifyUntil = EmuTime::zero();
+		skipBegin = 0;
+		skipSize = 0;
+	}
+
+	/** Don't report changes at window offsets [begin, begin + size) to
+	  * the observer anymore, till the next resetNotify(). Can be used by
+	  * an observer for which these changes don't matter as long as the
+	  * VDP state doesn't change, see VDPVRAM::resetNotify().
+	  */
+	inline void skipNotify(unsigned begin, unsigned size) {
+		skipBegin = begin;
+		skipSize = size;
 	}
 
 	/** Test whether an address is inside this window.
@@ -298,14 +333,45 @@ public:
 		return (address & combiMask) == unsigned(baseAddr);
 	}
 
+	/** Test whether any address of the range [start, start + size) is
+	  * inside this window. This is a conservative test: a window that is
+	  * not continuous is treated as if it contains all addresses between
+	  * its lowest and its highest address.
+	  */
+	[[nodiscard]] inline bool isInside(unsigned start, unsigned size) const {
+		if (!isEnabled()) return false;
+		unsigned last = unsigned(baseAddr) | unsigned(~combiMask);
+		return (start <= last) && (unsigned(baseAddr) < (start + size));
+	}
+
+	/** Would a change at any address of the range [start, start + size)
+	  * be reported to the observer (see notify())? Changes that are skipped
+	  * via skipNotify() are not, but the ones skipped till the moment
+	  * returned by VRAMObserver::updateVRAM() are. Like isInside(start,
+	  * size), this is a conservative test.
+	  */
+	[[nodiscard]] inline bool isNotified(unsigned start, unsigned size) const {
+		if (!isInside(start, size) || !hasObserver()) return false;
+		unsigned base = unsigned(baseAddr);
+		unsigned first = std::max(start, base) - base;
+		unsigned last = std::min(start + size - 1, base | unsigned(~combiMask)) - base;
+		return ((first - skipBegin) >= skipSize) ||
+		       ((last  - skipBegin) >= skipSize);
+	}
+
 	/** Notifies the observer of this window of a VRAM change,
 	  * if the changes address is inside this window.
+	  * Consecutive changes that would have the same effect on the
+	  * observer (typically all changes during the same display line) are
+	  * only reported once, see VRAMObserver::updateVRAM().
 	  * @param address The address to test.
 	  * @param time The moment in emulated time the change occurs.
 	  */
 	inline void notify(unsigned address, EmuTime::param time) {
-		if (isInside(address)) {
-			observer->updateVRAM(address - baseAddr, time);
+		if ((time >= skipNotifyUntil) && isInside(address)) {
+			unsigned offset = address - baseAddr;
+			if ((offset - skipBegin) < skipSize) return;
+			skipNotifyUntil = observer->updateVRAM(offset, time);
 		}
 	}
 
@@ -329,15 +395,6 @@ private:
 	}
 
 private:
-	/** Only VDPVRAM may construct VRAMWindow objects.
-	  */
-	friend class VDPVRAM;
-
-	/** Create a new window.
-	  * Initially, the window is disabled; use setRange to enable it.
-	  */
-	explicit VRAMWindow(Ram& vram);
-
 	/** Pointer to the entire VRAM data.
 	  */
 	byte* data;
@@ -376,6 +433,18 @@ private:
 	  */
 	int sizeMask;
 
+	/** Changes inside this window before this moment are not reported to
+	  * the observer, see notify(). Not serialized: after loadstate all
+	  * changes are reported again.
+	  */
+	EmuTime skipNotifyUntil = EmuTime::zero();
+
+	/** Changes at offsets [skipBegin, skipBegin + skipSize) are not
+	  * reported to the observer, see skipNotify(). Not serialized.
+	  */
+	unsigned skipBegin = 0;
+	unsigned skipSize = 0;
+
 	static inline DummyVRAMOBserver dummyObserver;
 };
 
@@ -404,6 +473,18 @@ public:
 		cmdEngine->sync(time);
 	}
 
+	/** Report all following changes inside the observed windows again.
+	  * Called by the VDP at the start of each frame (the observers restart
+	  * at the top of the frame) and right after its state changed (a
+	  * control register write, display mode or display enabled change),
+	  * because that can make changes that were skipped relevant again.
+	  */
+	inline void resetNotify() {
+		bitmapVisibleWindow.resetNotify();
+		spriteAttribTable.resetNotify();
+		spritePatternTable.resetNotify();
+	}
+
 	/** Write a byte from the command engine.
 	  * Synchronisation with reads by the command engine is skipped.
 	  * TODO: Replace by "cmdSync ; VRAMWindow::write".
@@ -430,6 +511,39 @@ public:
 		writeCommon(address, value, time);
 	}
 
+	/** Would none of the changes in the range [start, start + size) be
+	  * reported to an observer (the renderer or the sprite checker)? E.g.
+	  * because the renderer skips changes to a hidden page, see
+	  * VRAMWindow::skipNotify(). If so, and if nothing else can look at
+	  * VRAM in the mean time, the command engine can write to this range
+	  * without synchronizing with the observers, see cmdWriteUnobserved()
+	  * and cmdFillUnobserved().
+	  */
+	[[nodiscard]] inline bool isUnobserved(unsigned start, unsigned size) const {
+		if ((start + size - 1) & ~sizeMask) return false; // mirrored
+		return !bitmapVisibleWindow.isNotified(start, size) &&
+		       !spriteAttribTable  .isNotified(start, size) &&
+		       !spritePatternTable .isNotified(start, size);
+	}
+
+	/** Write a byte from the command engine, without synchronizing the
+	  * observers. Only allowed for addresses for which isUnobserved()
+	  * returns true.
+	  */
+	inline void cmdWriteUnobserved(unsigned address, byte value) {
+		assert(isUnobserved(address, 1));
+		if (unlikely(address >= actualSize)) return;
+		if (data[address] == value) return;
+		data[address] = value;
+		data.getDirtyPages().markDirty(address);
+	}
+
+	/** Fill a block of VRAM from the command engine, without synchronizing
+	  * the observers. Only allowed when isUnobserved() returns true for
+	  * this block.
+	  */
+	void cmdFillUnobserved(unsigned address, unsigned size, byte value);
+
 	/** Write a byte to VRAM through the CPU interface.
 	  * @param address The address to write.
 	  * @param value The value to write.
@@ -570,6 +684,7 @@ private:
 		spritePatternTable.notify(address, time);
 
 		data[address] = value;
+		data.getDirtyPages().markDirty(address);
 
 		// Cache dirty marking should happen after the commit,
 		// otherwise the cache could be re-validated based on old state.
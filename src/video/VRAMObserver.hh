@@ -17,8 +17,16 @@ public:
 	  * @param offset Offset of byte that will change,
 	  *               relative to window base address.
 	  * @param time The moment in emulated time this change occurs.
+	  * @return Changes inside the window before this moment won't be
+	  *         reported anymore (any offset): they would have the same
+	  *         effect as this one. Usually the observer has already
+	  *         updated itself up to a point (e.g. the current display
+	  *         line) that these changes can no longer influence. Return
+	  *         'time' itself to receive all following updates.
+	  *         VRAMWindow forgets this moment when the window changes
+	  *         and at the start of each frame.
 	  */
-	virtual void updateVRAM(unsigned offset, EmuTime::param time) = 0;
+	virtual EmuTime updateVRAM(unsigned offset, EmuTime::param time) = 0;
 
 	/** Informs the observer that the entire VRAM window will change.
 	  * This update is sent just before the change,
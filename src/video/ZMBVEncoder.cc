@@ -3,10 +3,13 @@
 #include "ZMBVEncoder.hh"
 #include "FrameSource.hh"
 #include "PixelOperations.hh"
+#include "WorkerPool.hh"
 #include "cstd.hh"
 #include "endian.hh"
 #include "ranges.hh"
 #include "unreachable.hh"
+#include "xrange.hh"
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
@@ -14,6 +17,7 @@
 #include <cstring>
 #include <cmath>
 #include <tuple>
+#include <vector>
 
 namespace openmsx {
 
@@ -121,8 +125,10 @@ static inline void writePixel(
 }
 
 
-ZMBVEncoder::ZMBVEncoder(unsigned width_, unsigned height_, unsigned bpp)
-	: width(width_)
+ZMBVEncoder::ZMBVEncoder(unsigned width_, unsigned height_, unsigned bpp,
+                         WorkerPool* workerPool_)
+	: workerPool(workerPool_)
+	, width(width_)
 	, height(height_)
 {
 	setupBuffers(bpp);
@@ -184,6 +190,7 @@ void ZMBVEncoder::setupBuffers(unsigned bpp)
 	unsigned xBlocks = width / BLOCK_WIDTH;
 	unsigned yBlocks = height / BLOCK_HEIGHT;
 	blockOffsets.resize(xBlocks * yBlocks);
+	blockVectors.resize(xBlocks * yBlocks);
 	for (auto y : xrange(yBlocks)) {
 		for (auto x : xrange(xBlocks)) {
 			blockOffsets[y * xBlocks + x] =
@@ -251,6 +258,54 @@ void ZMBVEncoder::addXorBlock(
 	});
 }
 
+template<typename P>
+ZMBVEncoder::BlockVector ZMBVEncoder::findVector(int vx, int vy, unsigned offset)
+{
+	// first try the given vector (the best vector of the previous block)
+	unsigned bestchange = compareBlock<P>(vx, vy, offset);
+	if (bestchange >= 4) {
+		int possibles = 64;
+		for (const auto& v : vectorTable) {
+			if (possibleBlock<P>(v.x, v.y, offset) < 4) {
+				unsigned testchange = compareBlock<P>(v.x, v.y, offset);
+				if (testchange < bestchange) {
+					bestchange = testchange;
+					vx = v.x;
+					vy = v.y;
+					if (bestchange < 4) break;
+				}
+				--possibles;
+				if (possibles == 0) break;
+			}
+		}
+	}
+	return {int8_t(vx), int8_t(vy), bestchange != 0};
+}
+
+template<typename P>
+void ZMBVEncoder::findVectors(unsigned firstBlock, unsigned lastBlock, int vx, int vy)
+{
+	for (auto b : xrange(firstBlock, lastBlock)) {
+		auto& v = blockVectors[b];
+		v = findVector<P>(vx, vy, blockOffsets[b]);
+		vx = v.x;
+		vy = v.y;
+	}
+}
+
+template<typename P>
+void ZMBVEncoder::addXorBlocks(
+	const PixelOperations<P>& pixelOps, unsigned firstBlock,
+	unsigned lastBlock, unsigned workUsed)
+{
+	for (auto b : xrange(firstBlock, lastBlock)) {
+		const auto& v = blockVectors[b];
+		if (v.changed) {
+			addXorBlock<P>(pixelOps, v.x, v.y, blockOffsets[b], workUsed);
+		}
+	}
+}
+
 template<typename P>
 void ZMBVEncoder::addXorFrame(const PixelFormat& pixelFormat, unsigned& workUsed)
 {
@@ -264,35 +319,65 @@ void ZMBVEncoder::addXorFrame(const PixelFormat& pixelFormat, unsigned& workUsed
 	// Align the following xor data on 4 byte boundary
 	workUsed = (workUsed + blockcount * 2 + 3) & ~3;
 
-	int bestVx = 0;
-	int bestVy = 0;
-	for (auto b : xrange(blockcount)) {
-		unsigned offset = blockOffsets[b];
-		// first try best vector of previous block
-		unsigned bestchange = compareBlock<P>(bestVx, bestVy, offset);
-		if (bestchange >= 4) {
-			int possibles = 64;
-			for (const auto& v : vectorTable) {
-				if (possibleBlock<P>(v.x, v.y, offset) < 4) {
-					unsigned testchange = compareBlock<P>(v.x, v.y, offset);
-					if (testchange < bestchange) {
-						bestchange = testchange;
-						bestVx = v.x;
-						bestVy = v.y;
-						if (bestchange < 4) break;
-					}
-					--possibles;
-					if (possibles == 0) break;
-				}
-			}
+	// Split the blocks in ranges, one per thread. The first range is
+	// handled by the calling thread.
+	unsigned numRanges = workerPool
+		? std::min(workerPool->getNumThreads() + 1, blockcount)
+		: 1;
+	std::vector<unsigned> rangeStart(numRanges + 1);
+	for (auto i : xrange(numRanges + 1)) {
+		rangeStart[i] = i * blockcount / numRanges;
+	}
+
+	// The search for a block starts with the best vector of the previous
+	// block. So all ranges, except the first, are first searched
+	// speculatively, starting with the zero vector ...
+	for (auto i : xrange(1u, numRanges)) {
+		workerPool->submit([&, i] {
+			findVectors<P>(rangeStart[i], rangeStart[i + 1], 0, 0);
+		}, this);
+	}
+	findVectors<P>(rangeStart[0], rangeStart[1], 0, 0);
+	if (workerPool) workerPool->wait(this);
+
+	// ... and then corrected, in order, starting from the real vector of
+	// the previous block. As soon as a block gets the same starting vector
+	// as in the speculative search, the rest of the range is correct. So
+	// the result is the same as for a sequential search.
+	for (auto i : xrange(1u, numRanges)) {
+		int startVx = 0; // start vector used in the speculative search
+		int startVy = 0;
+		for (auto b : xrange(rangeStart[i], rangeStart[i + 1])) {
+			const auto& prev = blockVectors[b - 1];
+			if ((prev.x == startVx) && (prev.y == startVy)) break;
+			auto& v = blockVectors[b];
+			startVx = v.x;
+			startVy = v.y;
+			v = findVector<P>(prev.x, prev.y, blockOffsets[b]);
 		}
-		vectors[b * 2 + 0] = (bestVx << 1);
-		vectors[b * 2 + 1] = (bestVy << 1);
-		if (bestchange) {
-			vectors[b * 2 + 0] |= 1;
-			addXorBlock<P>(pixelOps, bestVx, bestVy, offset, workUsed);
+	}
+
+	// Store the vectors, this also gives the position of the xor data of
+	// each range, so that data can be stored in parallel again.
+	std::vector<unsigned> xorStart(numRanges);
+	for (auto i : xrange(numRanges)) {
+		xorStart[i] = workUsed;
+		for (auto b : xrange(rangeStart[i], rangeStart[i + 1])) {
+			const auto& v = blockVectors[b];
+			vectors[b * 2 + 0] = (v.x << 1) | (v.changed ? 1 : 0);
+			vectors[b * 2 + 1] = (v.y << 1);
+			if (v.changed) {
+				workUsed += BLOCK_WIDTH * BLOCK_HEIGHT * sizeof(P);
+			}
 		}
 	}
+	for (auto i : xrange(1u, numRanges)) {
+		workerPool->submit([&, i] {
+			addXorBlocks<P>(pixelOps, rangeStart[i], rangeStart[i + 1], xorStart[i]);
+		}, this);
+	}
+	addXorBlocks<P>(pixelOps, rangeStart[0], rangeStart[1], xorStart[0]);
+	if (workerPool) workerPool->wait(this);
 }
 
 template<typename P>
@@ -350,8 +435,23 @@ const void* ZMBVEncoder::getScaledLine(FrameSource* frame, unsigned y, void* wor
 	return nullptr; // avoid warning
 }
 
-span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame)
+void ZMBVEncoder::copyFrame(FrameSource& frame, span<uint8_t> image) const
+{
+	assert(image.size() == getImageSize());
+	unsigned lineWidth = width * pixelSize;
+	uint8_t* dest = image.data();
+	for (auto i : xrange(height)) {
+		const auto* scaled = getScaledLine(&frame, i, dest);
+		if (scaled != dest) memcpy(dest, scaled, lineWidth);
+		dest += lineWidth;
+	}
+}
+
+span<const uint8_t> ZMBVEncoder::compressFrame(
+	bool keyFrame, span<const uint8_t> image, const PixelFormat& pixelFormat)
 {
+	assert(image.size() == getImageSize());
+
 	std::swap(newframe, oldframe); // replace oldframe with newframe
 
 	// Reset the work buffer
@@ -379,11 +479,12 @@ span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame
 	unsigned lineWidth = width * pixelSize;
 	uint8_t* dest =
 		&newframe[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
-	for (auto i : xrange(height)) {
-		const auto* scaled = getScaledLine(frame, i, dest);
-		if (scaled != dest) memcpy(dest, scaled, lineWidth);
+	const uint8_t* src = image.data();
+	repeat(height, [&] {
+		memcpy(dest, src, lineWidth);
+		src += lineWidth;
 		dest += linePitch;
-	}
+	});
 
 	// Add the frame data.
 	if (keyFrame) {
@@ -391,12 +492,12 @@ span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame
 		switch (pixelSize) {
 #if HAVE_16BPP
 		case 2:
-			addFullFrame<uint16_t>(frame->getPixelFormat(), workUsed);
+			addFullFrame<uint16_t>(pixelFormat, workUsed);
 			break;
 #endif
 #if HAVE_32BPP
 		case 4:
-			addFullFrame<uint32_t>(frame->getPixelFormat(), workUsed);
+			addFullFrame<uint32_t>(pixelFormat, workUsed);
 			break;
 #endif
 		default:
@@ -407,12 +508,12 @@ span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame
 		switch (pixelSize) {
 #if HAVE_16BPP
 		case 2:
-			addXorFrame<uint16_t>(frame->getPixelFormat(), workUsed);
+			addXorFrame<uint16_t>(pixelFormat, workUsed);
 			break;
 #endif
 #if HAVE_32BPP
 		case 4:
-			addXorFrame<uint32_t>(frame->getPixelFormat(), workUsed);
+			addXorFrame<uint32_t>(pixelFormat, workUsed);
 			break;
 #endif
 		default:
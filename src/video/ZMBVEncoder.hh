@@ -13,6 +13,7 @@
 namespace openmsx {
 
 class FrameSource;
+class WorkerPool;
 template<typename P> class PixelOperations;
 
 class ZMBVEncoder
@@ -20,9 +21,22 @@ class ZMBVEncoder
 public:
 	static constexpr const char CODEC_4CC[5] = "ZMBV"; // 4 + zero-terminator
 
-	ZMBVEncoder(unsigned width, unsigned height, unsigned bpp);
+	/** @param workerPool When not nullptr, the motion search of a frame
+	  *        is split over the threads of this pool. This doesn't
+	  *        change the encoded data. */
+	ZMBVEncoder(unsigned width, unsigned height, unsigned bpp,
+	            WorkerPool* workerPool = nullptr);
 
-	[[nodiscard]] span<const uint8_t> compressFrame(bool keyFrame, FrameSource* frame);
+	/** Size (in bytes) of an image as stored by copyFrame(). */
+	[[nodiscard]] size_t getImageSize() const { return size_t(width) * height * pixelSize; }
+
+	/** Store the (scaled) image of the given frame in 'image'. This is
+	  * the only step that reads from the FrameSource, so compressFrame()
+	  * can be called later, e.g. from another thread. */
+	void copyFrame(FrameSource& frame, span<uint8_t> image) const;
+
+	[[nodiscard]] span<const uint8_t> compressFrame(
+		bool keyFrame, span<const uint8_t> image, const PixelFormat& pixelFormat);
 
 private:
 	enum Format {
@@ -30,10 +44,23 @@ private:
 		ZMBV_FORMAT_32BPP = 8
 	};
 
+	/** Motion vector of a block, and does the block differ from the
+	  * (moved) block in the previous frame? */
+	struct BlockVector {
+		int8_t x;
+		int8_t y;
+		bool changed;
+	};
+
 	void setupBuffers(unsigned bpp);
 	[[nodiscard]] unsigned neededSize() const;
 	template<typename P> void addFullFrame(const PixelFormat& pixelFormat, unsigned& workUsed);
 	template<typename P> void addXorFrame (const PixelFormat& pixelFormat, unsigned& workUsed);
+	template<typename P> void findVectors(unsigned firstBlock, unsigned lastBlock, int vx, int vy);
+	template<typename P> void addXorBlocks(
+		const PixelOperations<P>& pixelOps, unsigned firstBlock,
+		unsigned lastBlock, unsigned workUsed);
+	template<typename P> [[nodiscard]] BlockVector findVector(int vx, int vy, unsigned offset);
 	template<typename P> [[nodiscard]] unsigned possibleBlock(int vx, int vy, unsigned offset);
 	template<typename P> [[nodiscard]] unsigned compareBlock(int vx, int vy, unsigned offset);
 	template<typename P> void addXorBlock(
@@ -47,6 +74,8 @@ private:
 	MemBuffer<uint8_t, SSE_ALIGNMENT> work;
 	MemBuffer<uint8_t> output;
 	MemBuffer<unsigned> blockOffsets;
+	MemBuffer<BlockVector> blockVectors;
+	WorkerPool* workerPool;
 	unsigned outputSize;
 
 	z_stream zstream;
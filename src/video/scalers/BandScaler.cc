@@ -0,0 +1,63 @@
+#include "BandScaler.hh"
+#include "Scaler.hh"
+#include "WorkerPool.hh"
+#include "xrange.hh"
+#include "build-info.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace openmsx {
+
+// Minimal number of destination lines per band, for smaller bands the
+// synchronization costs more than what is gained.
+static constexpr unsigned MIN_BAND_LINES = 32;
+
+template<typename Pixel>
+void scaleInBands(Scaler<Pixel>& scaler, WorkerPool& pool,
+	FrameSource& src, const RawFrame* superImpose,
+	unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
+	ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY,
+	unsigned srcStep, unsigned dstStep)
+{
+	assert(((srcEndY - srcStartY) % srcStep) == 0);
+	assert(((dstEndY - dstStartY) % dstStep) == 0);
+	unsigned numGroups = (dstEndY - dstStartY) / dstStep;
+	unsigned numBands = std::min({pool.getNumThreads() + 1, numGroups,
+	                              (dstEndY - dstStartY) / MIN_BAND_LINES});
+	// Blank lines (width 1) are not split: some scalers handle the last
+	// blank line together with the next (non-blank) region.
+	if ((srcWidth == 1) || (numBands <= 1) || !scaler.canScaleInBands()) {
+		scaler.scaleImage(src, superImpose, srcStartY, srcEndY, srcWidth,
+		                  dst, dstStartY, dstEndY);
+		return;
+	}
+
+	auto scaleBand = [&](unsigned band) {
+		unsigned g1 = (numGroups * (band + 0)) / numBands;
+		unsigned g2 = (numGroups * (band + 1)) / numBands;
+		scaler.scaleImage(src, superImpose,
+		                  srcStartY + g1 * srcStep, srcStartY + g2 * srcStep, srcWidth,
+		                  dst, dstStartY + g1 * dstStep, dstStartY + g2 * dstStep);
+	};
+	for (auto band : xrange(1u, numBands)) {
+		pool.submit([=] { scaleBand(band); }, &scaler);
+	}
+	scaleBand(0); // this thread also does its share
+	pool.wait(&scaler);
+}
+
+// Force template instantiation.
+#if HAVE_16BPP
+template void scaleInBands<uint16_t>(Scaler<uint16_t>&, WorkerPool&,
+	FrameSource&, const RawFrame*, unsigned, unsigned, unsigned,
+	ScalerOutput<uint16_t>&, unsigned, unsigned, unsigned, unsigned);
+#endif
+#if HAVE_32BPP
+template void scaleInBands<uint32_t>(Scaler<uint32_t>&, WorkerPool&,
+	FrameSource&, const RawFrame*, unsigned, unsigned, unsigned,
+	ScalerOutput<uint32_t>&, unsigned, unsigned, unsigned, unsigned);
+#endif
+
+} // namespace openmsx
@@ -0,0 +1,30 @@
+#ifndef BANDSCALER_HH
+#define BANDSCALER_HH
+
+namespace openmsx {
+
+class FrameSource;
+class RawFrame;
+class WorkerPool;
+template<typename Pixel> class Scaler;
+template<typename Pixel> class ScalerOutput;
+
+/** Same as Scaler::scaleImage(), but for scalers that support it (see
+  * Scaler::canScaleInBands()) large areas are split in horizontal bands
+  * that are scaled concurrently on the threads of the given pool (and on
+  * the calling thread). Returns when the whole area is scaled.
+  *
+  * A band always contains a whole number of groups of 'srcStep' source
+  * lines that are scaled to 'dstStep' destination lines. The output must
+  * support concurrent calls for different lines.
+  */
+template<typename Pixel>
+void scaleInBands(Scaler<Pixel>& scaler, WorkerPool& pool,
+	FrameSource& src, const RawFrame* superImpose,
+	unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
+	ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY,
+	unsigned srcStep, unsigned dstStep);
+
+} // namespace openmsx
+
+#endif
@@ -30,6 +30,7 @@ public:
 	void scale4x1to3x3(FrameSource& src,
 		unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY) override;
+	[[nodiscard]] bool canScaleInBands() const override { return true; }
 
 private:
 	PixelOperations<Pixel> pixelOps;
@@ -19,6 +19,7 @@ public:
 	void scale1x1to1x2(FrameSource& src,
 		unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY) override;
+	[[nodiscard]] bool canScaleInBands() const override { return true; }
 
 private:
 	void scaleLine_1on2(Pixel* dst0, Pixel* dst1,
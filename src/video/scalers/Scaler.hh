@@ -30,6 +30,14 @@ public:
 	virtual void scaleImage(FrameSource& src, const RawFrame* superImpose,
 		unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY) = 0;
+
+	/** Can scaleImage() be called concurrently for different bands
+	  * (groups of lines) of the same area? This requires that scaleImage()
+	  * doesn't modify any state of the scaler, and that the output for a
+	  * line doesn't depend on where the band starts or ends (neighbouring
+	  * source lines outside the band may be read). See scaleInBands().
+	  */
+	[[nodiscard]] virtual bool canScaleInBands() const { return false; }
 };
 
 } // namespace openmsx
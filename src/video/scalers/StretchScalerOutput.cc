@@ -6,6 +6,7 @@
 #include "build-info.hh"
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 using std::unique_ptr;
@@ -28,14 +29,15 @@ public:
 	void fillLine(unsigned y, Pixel color) override;
 
 protected:
-	[[nodiscard]] Pixel* releasePre(unsigned y, Pixel* buf);
-	void releasePost(unsigned y, Pixel* dstLine);
+	[[nodiscard]] Pixel* releasePre(unsigned y);
+	void releasePost(unsigned y, Pixel* buf, Pixel* dstLine);
 
 	const PixelOperations<Pixel> pixelOps;
 
 private:
 	DirectScalerOutput<Pixel> output;
 	std::vector<Pixel*> pool;
+	std::mutex poolMutex; // lines can be scaled concurrently, see scaleInBands()
 };
 
 template<typename Pixel>
@@ -131,27 +133,30 @@ unsigned StretchScalerOutputBase<Pixel>::getHeight() const
 template<typename Pixel>
 Pixel* StretchScalerOutputBase<Pixel>::acquireLine(unsigned /*y*/)
 {
+	std::unique_lock lock(poolMutex);
 	if (!pool.empty()) {
 		Pixel* buf = pool.back();
 		pool.pop_back();
 		return buf;
 	} else {
+		lock.unlock();
 		unsigned size = sizeof(Pixel) * output.getWidth();
 		return static_cast<Pixel*>(MemoryOps::mallocAligned(64, size));
 	}
 }
 
 template<typename Pixel>
-Pixel* StretchScalerOutputBase<Pixel>::releasePre(unsigned y, Pixel* buf)
+Pixel* StretchScalerOutputBase<Pixel>::releasePre(unsigned y)
 {
-	pool.push_back(buf);
 	return output.acquireLine(y);
 }
 
 template<typename Pixel>
-void StretchScalerOutputBase<Pixel>::releasePost(unsigned y, Pixel* dstLine)
+void StretchScalerOutputBase<Pixel>::releasePost(unsigned y, Pixel* buf, Pixel* dstLine)
 {
 	output.releaseLine(y, dstLine);
+	std::lock_guard lock(poolMutex);
+	pool.push_back(buf);
 }
 
 template<typename Pixel>
@@ -179,7 +184,7 @@ StretchScalerOutput<Pixel>::StretchScalerOutput(
 template<typename Pixel>
 void StretchScalerOutput<Pixel>::releaseLine(unsigned y, Pixel* buf)
 {
-	Pixel* dstLine = this->releasePre(y, buf);
+	Pixel* dstLine = this->releasePre(y);
 
 	unsigned dstWidth = StretchScalerOutputBase<Pixel>::getWidth();
 	unsigned srcWidth = (dstWidth / 320) * inWidth;
@@ -187,7 +192,7 @@ void StretchScalerOutput<Pixel>::releaseLine(unsigned y, Pixel* buf)
 	ZoomLine<Pixel> zoom(this->pixelOps);
 	zoom(buf + srcOffset, srcWidth, dstLine, dstWidth);
 
-	this->releasePost(y, dstLine);
+	this->releasePost(y, buf, dstLine);
 }
 
 
@@ -204,7 +209,7 @@ StretchScalerOutputN<Pixel, IN_WIDTH, SCALE>::StretchScalerOutputN(
 template<typename Pixel, unsigned IN_WIDTH, typename SCALE>
 void StretchScalerOutputN<Pixel, IN_WIDTH, SCALE>::releaseLine(unsigned y, Pixel* buf)
 {
-	Pixel* dstLine = this->releasePre(y, buf);
+	Pixel* dstLine = this->releasePre(y);
 
 	unsigned dstWidth = StretchScalerOutputBase<Pixel>::getWidth();
 	unsigned srcWidth = (dstWidth / 320) * IN_WIDTH;
@@ -212,7 +217,7 @@ void StretchScalerOutputN<Pixel, IN_WIDTH, SCALE>::releaseLine(unsigned y, Pixel
 	SCALE scale(this->pixelOps);
 	scale(buf + srcOffset, dstLine, dstWidth);
 
-	this->releasePost(y, dstLine);
+	this->releasePost(y, buf, dstLine);
 }
 
 